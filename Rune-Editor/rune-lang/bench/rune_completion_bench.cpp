@@ -0,0 +1,141 @@
+// Completion queries against an index of 500k generated identifiers,
+// against the linear prefix scan showSuggestions used to do
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "RuneCompletion.hpp"
+
+using namespace RuneLang;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kSymbols = 500000;
+constexpr int kQueries = 20000;
+constexpr size_t kTopK = 10;
+
+double since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void printLatency(const char* name, std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    std::printf("%-28s p50 %8.2f us  p99 %8.2f us  max %8.2f us\n", name,
+                samples[samples.size() / 2] * 1e6, samples[samples.size() * 99 / 100] * 1e6, samples.back() * 1e6);
+}
+
+constexpr size_t kVocabulary = 3000;
+
+// Pronounceable words of one to three syllables, standing in for the
+// vocabulary of a large code base
+std::vector<std::string> generateVocabulary(std::mt19937_64& random) {
+    static const char* const onsets[] = {"b", "c", "d", "f", "g", "h", "l", "m", "n", "p", "r", "s", "t", "v",
+                                         "w", "st", "tr", "pr", "ch", "sh", "bl", "cr", "gr", "sp"};
+    static const char* const vowels[] = {"a", "e", "i", "o", "u", "ea", "ou", "io"};
+    static const char* const codas[] = {"", "", "n", "r", "t", "s", "l", "x", "nd", "ck", "ng"};
+    std::vector<std::string> words;
+    for (size_t i = 0; i < kVocabulary; i++) {
+        std::string word;
+        const size_t syllables = 1 + random() % 3;
+        for (size_t s = 0; s < syllables; s++) {
+            word += onsets[random() % (sizeof(onsets) / sizeof(onsets[0]))];
+            word += vowels[random() % (sizeof(vowels) / sizeof(vowels[0]))];
+        }
+        word += codas[random() % (sizeof(codas) / sizeof(codas[0]))];
+        words.push_back(word);
+    }
+    return words;
+}
+
+// camelCase, snake_case and PascalCase names of two to four words. Words
+// are drawn with a skew towards the start of the vocabulary, as common
+// words like `get` and `size` are in real code.
+std::string generateIdentifier(std::mt19937_64& random, const std::vector<std::string>& vocabulary) {
+    const size_t words = 2 + random() % 3;
+    const int style = static_cast<int>(random() % 3);
+    std::string name;
+    for (size_t i = 0; i < words; i++) {
+        const size_t rank = random() % (1 + random() % vocabulary.size());
+        std::string word = vocabulary[rank];
+        if (style == 1 && i > 0) name += '_';
+        if ((style == 0 && i > 0) || style == 2) word[0] = static_cast<char>(word[0] - 'a' + 'A');
+        name += word;
+    }
+    return name;
+}
+
+// What someone types to reach `name` without spelling it out: the first
+// letters of its words, and sometimes one more letter of the first word
+std::string abbreviate(const std::string& name, std::mt19937_64& random) {
+    std::string query(1, name[0]);
+    if (random() % 2) query += name[1];
+    for (size_t i = 1; i < name.size() && query.size() < 4; i++) {
+        if (name[i] >= 'A' && name[i] <= 'Z') query += name[i];
+        if (name[i - 1] == '_') query += name[i];
+    }
+    return query;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 random(42);
+    const std::vector<std::string> vocabulary = generateVocabulary(random);
+    std::vector<std::string> names;
+    names.reserve(kSymbols);
+    while (names.size() < kSymbols) names.push_back(generateIdentifier(random, vocabulary));
+
+    Clock::time_point start = Clock::now();
+    RuneCompletionIndex index;
+    for (const std::string& name : names) index.add(name, 1 + random() % 8);
+    std::printf("index: %zu symbols in %.2f ms\n", index.size(), since(start) * 1e3);
+
+    // Feeding a buffer line by line, as the editor does after an edit
+    std::string line;
+    for (int i = 0; i < 8; i++) line += names[random() % names.size()] + (i % 2 ? " = " : "(");
+    std::vector<double> harvestSamples;
+    for (int i = 0; i < kQueries; i++) {
+        start = Clock::now();
+        index.removeIdentifiers(line);
+        index.addIdentifiers(line);
+        harvestSamples.push_back(since(start));
+    }
+
+    // Queries are a prefix of a real name, or an abbreviation of one
+    std::vector<double> prefixSamples;
+    std::vector<double> fuzzySamples;
+    std::vector<double> linearSamples;
+    size_t checksum = 0;
+    for (int i = 0; i < kQueries; i++) {
+        const std::string& name = names[random() % names.size()];
+        const std::string prefix = name.substr(0, 1 + random() % 6);
+        const std::string fuzzy = abbreviate(name, random);
+
+        start = Clock::now();
+        checksum += index.complete(prefix, kTopK).size();
+        prefixSamples.push_back(since(start));
+
+        start = Clock::now();
+        checksum += index.complete(fuzzy, kTopK).size();
+        fuzzySamples.push_back(since(start));
+
+        if (i < 200) {
+            start = Clock::now();
+            size_t matches = 0;
+            for (const std::string& candidate : names) matches += candidate.find(prefix) == 0;
+            checksum += matches;
+            linearSamples.push_back(since(start));
+        }
+    }
+
+    printLatency("linear prefix scan", linearSamples);
+    printLatency("prefix top-10", prefixSamples);
+    printLatency("fuzzy top-10", fuzzySamples);
+    printLatency("re-harvest one line", harvestSamples);
+    std::printf("checksum %zu\n", checksum);
+    return 0;
+}
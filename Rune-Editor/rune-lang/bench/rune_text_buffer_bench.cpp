@@ -0,0 +1,135 @@
+// Random edits and line lookups on a large document, RuneTextBuffer against
+// editing a std::string in place
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "RuneTextBuffer.hpp"
+
+using namespace RuneLang;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kDocumentBytes = 50u << 20;
+constexpr int kEdits = 200000;
+constexpr int kStringEdits = 200;
+constexpr int kLookups = 100000;
+
+double since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void printLatency(const char* name, std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    std::printf("%-28s p50 %8.2f us  p99 %8.2f us  max %8.2f us\n", name,
+                samples[samples.size() / 2] * 1e6, samples[samples.size() * 99 / 100] * 1e6, samples.back() * 1e6);
+}
+
+std::string generateDocument() {
+    std::string text;
+    text.reserve(kDocumentBytes + 64);
+    for (size_t line = 0; text.size() < kDocumentBytes; line++) {
+        switch (line % 4) {
+            case 0: text += "ᛤ function" + std::to_string(line) + " ᛒ\n"; break;
+            case 1: text += "    ᚠ \"Hello from line " + std::to_string(line) + "\\n\"\n"; break;
+            case 2: text += "    ᛏ 0\n"; break;
+            default: text += "ᛘ\n"; break;
+        }
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string text;
+    if (argc > 1) {
+        std::ifstream file(argv[1], std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+    } else {
+        text = generateDocument();
+    }
+    std::printf("document: %.1f MB\n", text.size() / 1048576.0);
+
+    std::mt19937_64 random(42);
+    const std::string alphabet = "abcdefghij ᚠᛒᛘ\n";
+
+    // Baseline: the same kind of edit on a std::string
+    std::string flat = text;
+    std::vector<double> flatSamples;
+    for (int edit = 0; edit < kStringEdits; edit++) {
+        const size_t offset = random() % flat.size();
+        const Clock::time_point start = Clock::now();
+        if (edit % 3 == 2) {
+            flat.erase(offset, std::min<size_t>(1 + random() % 32, flat.size() - offset));
+        } else {
+            flat.insert(offset, alphabet.substr(0, 1 + random() % 16));
+        }
+        flatSamples.push_back(since(start));
+    }
+    flat.clear();
+    flat.shrink_to_fit();
+
+    Clock::time_point start = Clock::now();
+    RuneTextBuffer buffer(std::move(text));
+    std::printf("open: %.2f ms, %zu lines, %zu pieces\n", since(start) * 1e3, buffer.lineCount(), buffer.pieceCount());
+
+    std::vector<double> editSamples;
+    editSamples.reserve(kEdits);
+    for (int edit = 0; edit < kEdits; edit++) {
+        const size_t offset = random() % buffer.size();
+        start = Clock::now();
+        if (edit % 3 == 2) {
+            buffer.erase(offset, std::min<size_t>(1 + random() % 32, buffer.size() - offset));
+        } else {
+            buffer.insert(offset, alphabet.substr(0, 1 + random() % 16));
+        }
+        editSamples.push_back(since(start));
+    }
+
+    // Typing: consecutive single characters extend one piece
+    std::vector<double> typingSamples;
+    size_t cursor = buffer.snapshot().lineStart(buffer.lineCount() / 2);
+    const size_t piecesBefore = buffer.pieceCount();
+    for (int key = 0; key < 10000; key++) {
+        start = Clock::now();
+        buffer.insert(cursor++, key % 40 == 39 ? "\n" : "x");
+        typingSamples.push_back(since(start));
+    }
+    const size_t typingPieces = buffer.pieceCount() - piecesBefore;
+
+    std::vector<double> lookupSamples;
+    size_t checksum = 0;
+    for (int lookup = 0; lookup < kLookups; lookup++) {
+        const size_t line = random() % buffer.lineCount();
+        start = Clock::now();
+        checksum += buffer.snapshot().line(line).size();
+        lookupSamples.push_back(since(start));
+    }
+
+    std::vector<double> snapshotSamples;
+    for (int copy = 0; copy < 1000; copy++) {
+        start = Clock::now();
+        RuneTextSnapshot snapshot = buffer.snapshot();
+        checksum += snapshot.size();
+        snapshotSamples.push_back(since(start));
+    }
+
+    std::printf("after edits: %zu lines, %zu pieces (typing added %zu for 10000 keys)\n",
+                buffer.lineCount(), buffer.pieceCount(), typingPieces);
+    printLatency("std::string edit", flatSamples);
+    printLatency("RuneTextBuffer edit", editSamples);
+    printLatency("RuneTextBuffer typing", typingSamples);
+    printLatency("line lookup", lookupSamples);
+    printLatency("snapshot", snapshotSamples);
+    std::printf("checksum %zu\n", checksum);
+    return 0;
+}
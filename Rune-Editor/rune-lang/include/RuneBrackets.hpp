@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include "RuneHighlighter.hpp"
+
+namespace RuneLang {
+
+enum class BracketKind : uint8_t {
+    Brace,    // { }
+    Paren,    // ( )
+    Square,   // [ ]
+    RuneBlock // ᛒ ᛘ
+};
+
+struct BracketPosition {
+    size_t line;
+    size_t column; // Byte offset into the line
+    BracketKind kind;
+    bool open;
+};
+
+namespace BracketDetail {
+struct Node;
+} // namespace BracketDetail
+
+// Bracket nesting of a document, kept up to date line by line. Each line
+// is a leaf of a balanced tree holding its net depth change and the lowest
+// depth it reaches; inner nodes combine those, so an edit costs O(log n)
+// per changed line and both queries descend the tree once instead of
+// scanning the text. Depth counts all kinds together: a partner of another
+// kind, as in `(]`, is a nesting error for the caller to report. Brackets
+// inside strings and comments are ignored, using the highlighter's state
+// at the start of each line.
+class RuneBracketIndex {
+public:
+    using LineSource = RuneHighlighter::LineSource;
+
+    RuneBracketIndex();
+    ~RuneBracketIndex();
+
+    void reset(const RuneHighlighter& highlighter, const LineSource& lines);
+
+    // Same arguments as the RuneHighlighter::update that was just applied.
+    // Lines after the edit are rescanned while their start state differs
+    // from the one they were scanned with.
+    void update(size_t first, size_t removed, size_t inserted, const RuneHighlighter& highlighter,
+                const LineSource& lines);
+
+    // The first closing bracket with nothing to close or, when there is
+    // none, the first opening bracket that is never closed
+    std::optional<BracketPosition> firstUnmatched() const;
+
+    // Partner of the bracket at `line`, `column`; none when there is no
+    // bracket there or it is unmatched
+    std::optional<BracketPosition> matching(size_t line, size_t column) const;
+
+    size_t lineCount() const;
+
+private:
+    std::unique_ptr<BracketDetail::Node> root_;
+    uint32_t seed_ = 0x2545F491u; // Treap priorities
+
+    uint32_t nextPriority();
+};
+
+} // namespace RuneLang
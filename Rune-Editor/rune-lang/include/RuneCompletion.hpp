@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace RuneLang {
+
+struct Completion {
+    std::string_view text; // Valid as long as the index
+    int score;             // Use count of a prefix match, fuzzy score otherwise
+    bool prefix;           // Starts with the query, case included
+};
+
+namespace CompletionDetail {
+
+constexpr uint32_t kNoSymbol = UINT32_MAX;
+
+struct Symbol {
+    const char* name; // In the index's blocks, never moved
+    uint32_t length;
+    uint32_t uses;
+};
+
+// Node of a compressed trie. The edge label is a slice of a symbol's name,
+// so labels cost no storage of their own.
+struct TrieNode {
+    uint32_t labelSymbol = kNoSymbol;
+    uint32_t labelStart = 0;
+    uint32_t labelLength = 0;
+    uint32_t symbol = kNoSymbol; // Ending exactly here
+    uint32_t best = 0;           // Highest use count in the subtree
+    std::vector<uint32_t> children; // Sorted by first label byte
+};
+
+// A symbol filed under a pair of characters a match can begin with, with
+// enough of its shape to reject or bound most queries without reading the
+// name, and the name itself so that reading it is a single cache miss
+struct Candidate {
+    uint64_t starts;   // Folded characters that start a word
+    uint64_t adjacent[2]; // Bloom filter of adjacent folded pairs
+    const char* name;
+    uint32_t symbol;
+    uint16_t length;   // Capped; names are scored on their first 64 bytes
+    int16_t pairScore; // Best score of the bucket's two characters
+};
+
+} // namespace CompletionDetail
+
+// Completion candidates for the editor: keywords plus the identifiers of
+// open buffers, counted by how often they occur. Prefix matches come from
+// a compressed trie whose nodes know the highest count below them, so the
+// top K are found best-first without visiting the rest of the subtree.
+//
+// Fuzzy matches ignore case. The first query character starts a word of
+// the symbol and each later one follows the previous match or starts a
+// later word, so `gb`, `gbu` and `getb` find `getBuffer` and `get_buffer`.
+// Symbols are filed under every pair of characters a match can begin
+// with; a query scans only its pair's bucket and checks the rest of its
+// characters against each candidate's word starts and adjacent pairs
+// before reading any name.
+//
+// Names, ids and trie nodes are never freed: a symbol whose count drops
+// to zero just stops matching, and comes back for free when it is typed
+// again.
+class RuneCompletionIndex {
+public:
+    RuneCompletionIndex();
+
+    void add(std::string_view word, uint32_t uses = 1);
+    void remove(std::string_view word, uint32_t uses = 1);
+
+    // Every identifier in `text`, comments and strings included, so that
+    // removing the old text of an edited line undoes exactly what adding
+    // it did without needing lexer state
+    void addIdentifiers(std::string_view text);
+    void removeIdentifiers(std::string_view text);
+
+    uint32_t uses(std::string_view word) const;
+    // Highest count among symbols starting with `prefix`, as the trie
+    // keeps it for best-first search
+    uint32_t bestUse(std::string_view prefix) const;
+    // Symbols with a count above zero
+    size_t size() const { return live_; }
+
+    // Up to `limit` results: prefix matches by count, then fuzzy matches
+    // by score. An empty query lists the most used symbols.
+    std::vector<Completion> complete(std::string_view query, size_t limit = 10) const;
+
+private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_; // Names, packed
+    size_t used_ = kBlockSize;                    // Of blocks_.back()
+    std::vector<CompletionDetail::Symbol> symbols_;
+    // Per symbol, the score its count adds to a fuzzy match, or kUnused.
+    // At a byte each it stays in cache while a bucket is bounded.
+    std::vector<uint8_t> bonus_;
+    std::unordered_map<std::string_view, uint32_t> ids_;
+    std::vector<CompletionDetail::TrieNode> nodes_; // nodes_[0] is the root
+    // One per word-start character, then one per pair a match can begin with
+    std::vector<std::vector<CompletionDetail::Candidate>> buckets_;
+    size_t live_ = 0;
+
+    const char* store(std::string_view word);
+    uint32_t intern(std::string_view word);
+    std::string_view name(uint32_t symbol) const;
+    std::string_view label(const CompletionDetail::TrieNode& node) const;
+    void insertIntoTrie(uint32_t symbol);
+    // Nodes from the root to where `symbol` ends
+    std::vector<uint32_t> pathTo(uint32_t symbol) const;
+    // Node whose subtree holds the words starting with `prefix`, or kNoSymbol
+    uint32_t subtreeOf(std::string_view prefix) const;
+    void prefixMatches(std::string_view prefix, size_t limit, std::vector<Completion>& out) const;
+    void fuzzyMatches(std::string_view query, size_t limit, std::vector<Completion>& out) const;
+};
+
+} // namespace RuneLang
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "RuneBrackets.hpp"
+#include "RuneHighlighter.hpp"
+#include "RuneTextBuffer.hpp"
+
+namespace RuneLang {
+
+// Lines [first, first + removed) of the text before an edit became lines
+// [first, first + inserted) of the text after it
+struct EditedLines {
+    size_t first;
+    size_t removed;
+    size_t inserted;
+};
+
+// An open buffer and the state live error checking reads from it. Each
+// edit re-lexes and re-indexes only the lines it touched, so a check costs
+// what the index queries cost instead of a pass over the buffer.
+class RuneDocument {
+public:
+    explicit RuneDocument(const std::string& text = {});
+
+    // Replaces `length` bytes at `offset` with `inserted`
+    EditedLines edit(size_t offset, size_t length, const std::string& inserted);
+
+    const RuneTextBuffer& text() const { return text_; }
+    const RuneHighlighter& highlighter() const { return highlighter_; }
+    const RuneBracketIndex& brackets() const { return brackets_; }
+    // ';' characters anywhere in the text
+    size_t semicolons() const { return semicolons_; }
+
+private:
+    RuneTextBuffer text_;
+    RuneHighlighter highlighter_;
+    RuneBracketIndex brackets_;
+    size_t semicolons_;
+
+    RuneHighlighter::LineSource lines() const;
+};
+
+} // namespace RuneLang
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RuneLang {
+
+// What a stretch of source text is, for styling
+enum class TokenKind : uint8_t {
+    Plain,
+    Keyword, // if, while, int, ...
+    Rune,    // Any character of the Runic block, e.g. ᚠ or ᛒ
+    String,
+    Comment,
+    Number
+};
+
+// Lexer state carried from the end of one line into the next. Only block
+// comments span lines; strings and // comments end with their line.
+enum class LexState : uint8_t {
+    Code,
+    BlockComment
+};
+
+struct HighlightSpan {
+    size_t start;  // Byte offset into the line
+    size_t length; // In bytes
+    TokenKind kind;
+};
+
+// Lexes one line (without its newline) starting in `state` and returns the
+// state the next line starts in. Spans other than Plain are appended to
+// `spans` when it is given.
+LexState lexLine(std::string_view line, LexState state, std::vector<HighlightSpan>* spans = nullptr);
+
+// Keeps the lexer state at the end of every line so an edit only re-lexes
+// from the edited line until the state matches the previous run again;
+// lines after that point style exactly as before. Styling itself is not
+// stored: highlight() re-lexes a single line on demand, which costs about
+// as much as copying it.
+class RuneHighlighter {
+public:
+    // Text of line `index` without its newline
+    using LineSource = std::function<std::string(size_t index)>;
+
+    void reset(size_t lineCount, const LineSource& lines);
+
+    // Lines [first, first + removed) were replaced by `inserted` new lines.
+    // Returns how many lines, starting at `first`, were re-lexed and may
+    // now style differently; the caller repaints those.
+    size_t update(size_t first, size_t removed, size_t inserted, const LineSource& lines);
+
+    size_t lineCount() const { return endStates_.size(); }
+    LexState stateBefore(size_t line) const;
+    std::vector<HighlightSpan> highlight(size_t line, std::string_view text) const;
+
+private:
+    std::vector<LexState> endStates_; // One per line
+};
+
+} // namespace RuneLang
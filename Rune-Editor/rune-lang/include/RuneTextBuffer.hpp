@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace RuneLang {
+
+namespace TextBufferDetail {
+
+// A run of text in one of the buffer's blocks
+struct Piece {
+    const char* text;
+    size_t length;
+    size_t newlines;
+};
+
+// Node of a persistent treap over pieces in document order. Nodes are
+// never modified once built; an edit copies the O(log n) nodes on its path
+// and shares the rest, so every old root stays a valid document.
+struct Node {
+    Piece piece;
+    size_t totalLength;   // Of the whole subtree
+    size_t totalNewlines; // Of the whole subtree
+    size_t totalPieces;   // Of the whole subtree
+    uint32_t priority;
+    std::shared_ptr<const Node> left;
+    std::shared_ptr<const Node> right;
+};
+
+using NodePtr = std::shared_ptr<const Node>;
+
+// Owns the bytes pieces point into: the text the buffer was opened with
+// and append-only blocks for everything typed since. Blocks never move or
+// shrink, so snapshots can read them while the editor keeps appending.
+struct Storage {
+    std::string original;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t used = 0; // Of blocks.back()
+};
+
+} // namespace TextBufferDetail
+
+// Immutable view of a RuneTextBuffer at one point in time. Copying one is
+// two reference count increments, and it stays readable from any thread
+// however the buffer is edited afterwards.
+class RuneTextSnapshot {
+public:
+    RuneTextSnapshot() = default;
+
+    size_t size() const;
+    // Lines are separated by '\n'; an empty document has one empty line
+    size_t lineCount() const;
+    // Byte offset of the first character of `line`
+    size_t lineStart(size_t line) const;
+    // Line containing byte `offset`
+    size_t lineOf(size_t offset) const;
+    // Text of `line` without its newline
+    std::string line(size_t line) const;
+    std::string text(size_t offset, size_t length) const;
+    std::string toString() const;
+
+private:
+    friend class RuneTextBuffer;
+
+    TextBufferDetail::NodePtr root_;
+    std::shared_ptr<const TextBufferDetail::Storage> storage_;
+
+    RuneTextSnapshot(TextBufferDetail::NodePtr root, std::shared_ptr<const TextBufferDetail::Storage> storage)
+        : root_(std::move(root)), storage_(std::move(storage)) {}
+};
+
+// Editable document as a piece table: the text is a sequence of pieces of
+// the original file and of appended blocks, kept in a balanced tree that
+// also counts bytes and newlines per subtree. Inserts, deletes and line
+// lookups are O(log n) in the number of pieces; no edit copies the text.
+class RuneTextBuffer {
+public:
+    // Pieces are kept at most this long, so splitting one or finding a
+    // line inside it scans a bounded amount of text
+    static constexpr size_t kMaxPiece = 16 * 1024;
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    explicit RuneTextBuffer(std::string text = {});
+
+    void insert(size_t offset, const std::string& text);
+    void erase(size_t offset, size_t length);
+
+    const RuneTextSnapshot& snapshot() const { return current_; }
+    size_t size() const { return current_.size(); }
+    size_t lineCount() const { return current_.lineCount(); }
+    size_t pieceCount() const;
+
+private:
+    std::shared_ptr<TextBufferDetail::Storage> storage_;
+    RuneTextSnapshot current_;
+    uint32_t seed_ = 0x9E3779B9u; // Treap priorities
+
+    uint32_t nextPriority();
+    const char* append(const char* text, size_t length);
+    // Pieces for `text`, appending it to the blocks first unless it is
+    // already in storage
+    TextBufferDetail::NodePtr buildPieces(const char* text, size_t length, bool stored);
+};
+
+} // namespace RuneLang
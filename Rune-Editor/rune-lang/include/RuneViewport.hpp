@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "RuneHighlighter.hpp"
+#include "RuneTextBuffer.hpp"
+
+namespace RuneLang {
+
+struct StyledLine {
+    std::string text; // Without its newline
+    std::vector<HighlightSpan> spans;
+};
+
+// Highlights only the lines on screen. The lexer state is remembered at
+// the start of every kCheckpointInterval-th line, so showing a viewport
+// lexes at most one interval of hidden lines before it, wherever it is in
+// the document. Checkpoints are found by lexing forward on demand, from
+// the last one known; advance() does that ahead of time, a bounded step
+// per call, so an idle loop can make even the first jump to the end of a
+// huge file cost no more than scrolling at the top.
+class RuneViewport {
+public:
+    static constexpr size_t kCheckpointInterval = 256;
+
+    RuneViewport();
+
+    // Lines [first, first + count) of `text`, clipped to the document
+    std::vector<StyledLine> render(const RuneTextSnapshot& text, size_t first, size_t count);
+
+    // Finds checkpoints past the known ones, lexing at most `lines` lines.
+    // Returns false once the whole document is covered.
+    bool advance(const RuneTextSnapshot& text, size_t lines);
+
+    // The document changed at `line`; checkpoints below it are dropped
+    void invalidateFrom(size_t line);
+
+    size_t checkpointCount() const { return checkpoints_.size(); }
+
+private:
+    // checkpoints_[k] is the state line k * kCheckpointInterval starts in
+    std::vector<LexState> checkpoints_;
+
+    void extendTo(const RuneTextSnapshot& text, size_t checkpoint);
+};
+
+} // namespace RuneLang
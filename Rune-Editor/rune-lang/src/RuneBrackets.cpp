@@ -0,0 +1,328 @@
+#include "../include/RuneBrackets.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace RuneLang {
+
+namespace BracketDetail {
+
+// No bracket, so no depth reached
+constexpr long kNone = std::numeric_limits<long>::max();
+
+struct Bracket {
+    uint32_t column;
+    BracketKind kind;
+    bool open;
+};
+
+struct Line {
+    LexState start; // What the line was scanned with
+    std::vector<Bracket> brackets;
+    long delta = 0;
+    long minAfter = kNone; // Lowest depth right after one of its brackets, from the line start
+};
+
+// Implicit treap over lines: a node's index is the number of lines before
+// it, never stored
+struct Node {
+    Line line;
+    uint32_t priority;
+    size_t lines = 1;
+    long delta = 0;
+    long minAfter = kNone;
+    std::unique_ptr<Node> left;
+    std::unique_ptr<Node> right;
+};
+
+} // namespace BracketDetail
+
+using namespace BracketDetail;
+
+namespace {
+
+using NodePtr = std::unique_ptr<Node>;
+
+size_t linesOf(const NodePtr& node) { return node ? node->lines : 0; }
+long deltaOf(const NodePtr& node) { return node ? node->delta : 0; }
+
+long lowest(long current, long base, long minAfter) {
+    return minAfter == kNone ? current : std::min(current, base + minAfter);
+}
+
+void pull(Node& node) {
+    node.lines = linesOf(node.left) + 1 + linesOf(node.right);
+    const long before = deltaOf(node.left);
+    node.delta = before + node.line.delta + deltaOf(node.right);
+    node.minAfter = node.left ? node.left->minAfter : kNone;
+    node.minAfter = lowest(node.minAfter, before, node.line.minAfter);
+    if (node.right) node.minAfter = lowest(node.minAfter, before + node.line.delta, node.right->minAfter);
+}
+
+// The first `count` lines go to the first half
+std::pair<NodePtr, NodePtr> split(NodePtr node, size_t count) {
+    if (!node) return {nullptr, nullptr};
+    if (count <= linesOf(node->left)) {
+        auto [left, rest] = split(std::move(node->left), count);
+        node->left = std::move(rest);
+        pull(*node);
+        return {std::move(left), std::move(node)};
+    }
+    auto [rest, right] = split(std::move(node->right), count - linesOf(node->left) - 1);
+    node->right = std::move(rest);
+    pull(*node);
+    return {std::move(node), std::move(right)};
+}
+
+NodePtr merge(NodePtr left, NodePtr right) {
+    if (!left) return right;
+    if (!right) return left;
+    if (left->priority > right->priority) {
+        left->right = merge(std::move(left->right), std::move(right));
+        pull(*left);
+        return left;
+    }
+    right->left = merge(std::move(left), std::move(right->left));
+    pull(*right);
+    return right;
+}
+
+// ᛒ and ᛘ, U+16D2 and U+16D8
+constexpr std::string_view kRuneOpen = "\xE1\x9B\x92";
+constexpr std::string_view kRuneClose = "\xE1\x9B\x98";
+
+Line scanLine(std::string_view text, LexState state) {
+    Line line;
+    line.start = state;
+    std::vector<HighlightSpan> spans;
+    lexLine(text, state, &spans);
+
+    size_t span = 0;
+    size_t pos = 0;
+    auto add = [&line](size_t column, BracketKind kind, bool open) {
+        line.brackets.push_back({static_cast<uint32_t>(column), kind, open});
+        line.delta += open ? 1 : -1;
+        line.minAfter = std::min(line.minAfter, line.delta);
+    };
+    while (pos < text.size()) {
+        // Skip strings and comments
+        while (span < spans.size() && spans[span].start + spans[span].length <= pos) span++;
+        if (span < spans.size() && spans[span].start <= pos &&
+            (spans[span].kind == TokenKind::String || spans[span].kind == TokenKind::Comment)) {
+            pos = spans[span].start + spans[span].length;
+            continue;
+        }
+        switch (text[pos]) {
+            case '{': add(pos, BracketKind::Brace, true); break;
+            case '}': add(pos, BracketKind::Brace, false); break;
+            case '(': add(pos, BracketKind::Paren, true); break;
+            case ')': add(pos, BracketKind::Paren, false); break;
+            case '[': add(pos, BracketKind::Square, true); break;
+            case ']': add(pos, BracketKind::Square, false); break;
+            default:
+                if (text.compare(pos, 3, kRuneOpen) == 0) {
+                    add(pos, BracketKind::RuneBlock, true);
+                    pos += 2;
+                } else if (text.compare(pos, 3, kRuneClose) == 0) {
+                    add(pos, BracketKind::RuneBlock, false);
+                    pos += 2;
+                }
+                break;
+        }
+        pos++;
+    }
+    return line;
+}
+
+// Bracket `index` of line `line`
+struct Hit {
+    size_t line;
+    const Line* content;
+    size_t index;
+};
+
+BracketPosition positionOf(const Hit& hit) {
+    const Bracket& bracket = hit.content->brackets[hit.index];
+    return {hit.line, bracket.column, bracket.kind, bracket.open};
+}
+
+// First bracket in a line at or after `fromLine` that leaves the depth at
+// or below `target`. `firstLine` and `depth` are the index and the depth
+// at the start of `node`'s subtree.
+std::optional<Hit> findFirst(const Node* node, size_t firstLine, long depth, size_t fromLine, long target) {
+    if (!node || node->minAfter == kNone || depth + node->minAfter > target) return std::nullopt;
+    if (firstLine + node->lines <= fromLine) return std::nullopt;
+    if (auto hit = findFirst(node->left.get(), firstLine, depth, fromLine, target)) return hit;
+
+    const size_t here = firstLine + linesOf(node->left);
+    depth += deltaOf(node->left);
+    const Line& line = node->line;
+    if (here >= fromLine && line.minAfter != kNone && depth + line.minAfter <= target) {
+        for (size_t i = 0; i < line.brackets.size(); i++) {
+            depth += line.brackets[i].open ? 1 : -1;
+            if (depth <= target) return Hit{here, &line, i};
+        }
+    }
+    return findFirst(node->right.get(), here + 1, depth + line.delta, fromLine, target);
+}
+
+// Last bracket in a line before `beforeLine` that leaves the depth at or
+// below `target`
+std::optional<Hit> findLast(const Node* node, size_t firstLine, long depth, size_t beforeLine, long target) {
+    if (!node || node->minAfter == kNone || depth + node->minAfter > target) return std::nullopt;
+    if (firstLine >= beforeLine) return std::nullopt;
+
+    const size_t here = firstLine + linesOf(node->left);
+    const long lineDepth = depth + deltaOf(node->left);
+    const Line& line = node->line;
+    if (auto hit = findLast(node->right.get(), here + 1, lineDepth + line.delta, beforeLine, target)) return hit;
+    if (here < beforeLine && line.minAfter != kNone && lineDepth + line.minAfter <= target) {
+        std::optional<Hit> last;
+        long after = lineDepth;
+        for (size_t i = 0; i < line.brackets.size(); i++) {
+            after += line.brackets[i].open ? 1 : -1;
+            if (after <= target) last = Hit{here, &line, i};
+        }
+        return last;
+    }
+    return findLast(node->left.get(), firstLine, depth, beforeLine, target);
+}
+
+// The bracket right after `hit`, or the first one of the document
+std::optional<Hit> nextBracket(const Node* root, const std::optional<Hit>& hit) {
+    if (hit && hit->index + 1 < hit->content->brackets.size()) {
+        return Hit{hit->line, hit->content, hit->index + 1};
+    }
+    return findFirst(root, 0, 0, hit ? hit->line + 1 : 0, kNone);
+}
+
+const Line& lineAt(const Node* node, size_t index, long& depth) {
+    depth = 0;
+    while (true) {
+        const size_t before = linesOf(node->left);
+        if (index < before) {
+            node = node->left.get();
+        } else if (index == before) {
+            depth += deltaOf(node->left);
+            return node->line;
+        } else {
+            depth += deltaOf(node->left) + node->line.delta;
+            index -= before + 1;
+            node = node->right.get();
+        }
+    }
+}
+
+void assign(Node& node, size_t index, Line&& line) {
+    const size_t before = linesOf(node.left);
+    if (index < before) {
+        assign(*node.left, index, std::move(line));
+    } else if (index == before) {
+        node.line = std::move(line);
+    } else {
+        assign(*node.right, index - before - 1, std::move(line));
+    }
+    pull(node);
+}
+
+} // namespace
+
+RuneBracketIndex::RuneBracketIndex() = default;
+RuneBracketIndex::~RuneBracketIndex() = default;
+
+uint32_t RuneBracketIndex::nextPriority() {
+    // xorshift32
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+}
+
+size_t RuneBracketIndex::lineCount() const {
+    return linesOf(root_);
+}
+
+void RuneBracketIndex::reset(const RuneHighlighter& highlighter, const LineSource& lines) {
+    root_.reset();
+    update(0, 0, highlighter.lineCount(), highlighter, lines);
+}
+
+void RuneBracketIndex::update(size_t first, size_t removed, size_t inserted, const RuneHighlighter& highlighter,
+                              const LineSource& lines) {
+    if (first > lineCount() || removed > lineCount() - first) {
+        throw std::out_of_range("RuneBracketIndex::update: edited lines out of range");
+    }
+    auto [left, rest] = split(std::move(root_), first);
+    auto [erased, right] = split(std::move(rest), removed);
+    NodePtr middle;
+    for (size_t line = first; line < first + inserted; line++) {
+        auto node = std::make_unique<Node>();
+        node->line = scanLine(lines(line), highlighter.stateBefore(line));
+        node->priority = nextPriority();
+        pull(*node);
+        middle = merge(std::move(middle), std::move(node));
+    }
+    root_ = merge(merge(std::move(left), std::move(middle)), std::move(right));
+
+    // A line whose start state is unchanged has the same brackets, and so
+    // does everything below it
+    for (size_t line = first + inserted; line < lineCount(); line++) {
+        const LexState state = highlighter.stateBefore(line);
+        long depth;
+        if (lineAt(root_.get(), line, depth).start == state) break;
+        assign(*root_, line, scanLine(lines(line), state));
+    }
+}
+
+std::optional<BracketPosition> RuneBracketIndex::firstUnmatched() const {
+    if (!root_ || root_->minAfter == kNone) return std::nullopt;
+    if (root_->minAfter < 0) {
+        return positionOf(*findFirst(root_.get(), 0, 0, 0, -1));
+    }
+    if (root_->delta > 0) {
+        // Everything after the last return to depth 0 stays open
+        const std::optional<Hit> lastClosed = findLast(root_.get(), 0, 0, lineCount(), 0);
+        return positionOf(*nextBracket(root_.get(), lastClosed));
+    }
+    return std::nullopt;
+}
+
+std::optional<BracketPosition> RuneBracketIndex::matching(size_t line, size_t column) const {
+    if (line >= lineCount()) return std::nullopt;
+    long lineDepth;
+    const Line& content = lineAt(root_.get(), line, lineDepth);
+    long depth = lineDepth;
+    size_t index = 0;
+    while (index < content.brackets.size() && content.brackets[index].column != column) {
+        depth += content.brackets[index++].open ? 1 : -1;
+    }
+    if (index == content.brackets.size()) return std::nullopt;
+
+    // `depth` is the depth right before the bracket
+    if (content.brackets[index].open) {
+        long after = depth + 1;
+        for (size_t i = index + 1; i < content.brackets.size(); i++) {
+            after += content.brackets[i].open ? 1 : -1;
+            if (after <= depth) return positionOf({line, &content, i});
+        }
+        if (auto hit = findFirst(root_.get(), 0, 0, line + 1, depth)) return positionOf(*hit);
+        return std::nullopt;
+    }
+
+    // The partner is the bracket after the last point back at depth - 1;
+    // the document start counts as such a point when depth - 1 >= 0
+    std::optional<Hit> closed;
+    long after = lineDepth;
+    for (size_t i = 0; i < index; i++) {
+        after += content.brackets[i].open ? 1 : -1;
+        if (after <= depth - 1) closed = Hit{line, &content, i};
+    }
+    if (!closed) closed = findLast(root_.get(), 0, 0, line, depth - 1);
+    if (!closed && depth < 1) return std::nullopt;
+    return positionOf(*nextBracket(root_.get(), closed));
+}
+
+} // namespace RuneLang
@@ -0,0 +1,528 @@
+#include "../include/RuneCompletion.hpp"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+namespace RuneLang {
+
+using namespace CompletionDetail;
+
+namespace {
+
+// Characters folded for fuzzy matching: letters without case, then digits
+// and '_'; anything else shares the last slot
+constexpr uint8_t kWordChars = 37;
+constexpr uint8_t kOther = 63;
+
+constexpr std::array<uint8_t, 256> makeFoldTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 0; c < 256; c++) {
+        if (c >= 'a' && c <= 'z') table[c] = static_cast<uint8_t>(c - 'a');
+        else if (c >= 'A' && c <= 'Z') table[c] = static_cast<uint8_t>(c - 'A');
+        else if (c >= '0' && c <= '9') table[c] = static_cast<uint8_t>(26 + c - '0');
+        else if (c == '_') table[c] = 36;
+        else table[c] = kOther;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> kFold = makeFoldTable();
+
+uint8_t fold(char c) { return kFold[static_cast<unsigned char>(c)]; }
+bool isLower(char c) { return c >= 'a' && c <= 'z'; }
+bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+bool isWordChar(char c) { return fold(c) != kOther; }
+
+// Start of a word inside an identifier: `get_buffer`, `getBuffer`, `utf8`
+bool isWordStart(std::string_view text, size_t i) {
+    if (!isWordChar(text[i])) return false;
+    if (i == 0) return true;
+    const char before = text[i - 1];
+    const char here = text[i];
+    return (before == '_' && here != '_') || (isLower(before) && isUpper(here)) ||
+           (isDigit(here) && !isDigit(before));
+}
+
+// Bit of the adjacent-pair filter, 0 to 127
+unsigned adjacentBit(uint8_t first, uint8_t second) {
+    return static_cast<unsigned>((first * kWordChars + second) * 0x9E3779B97F4A7C15ull >> 57);
+}
+
+size_t pairBucket(uint8_t first, uint8_t second) {
+    return kWordChars + first * kWordChars + second;
+}
+
+// Identifiers of at least two characters; a run starting with a digit is
+// a number
+template <typename F>
+void forEachIdentifier(std::string_view text, F&& f) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (!isWordChar(text[pos])) {
+            pos++;
+            continue;
+        }
+        const size_t start = pos;
+        while (pos < text.size() && isWordChar(text[pos])) pos++;
+        if (!isDigit(text[start]) && pos - start >= 2) f(text.substr(start, pos - start));
+    }
+}
+
+constexpr int kNoMatch = std::numeric_limits<int>::min();
+constexpr size_t kMaxScored = 64; // Longer names are matched on this many bytes
+
+// Bit j set when a word starts at byte j
+uint64_t wordStartsOf(std::string_view text) {
+    uint64_t starts = 0;
+    for (size_t j = 0; j < std::min(text.size(), kMaxScored); j++) {
+        if (isWordStart(text, j)) starts |= uint64_t(1) << j;
+    }
+    return starts;
+}
+
+constexpr int kMatch = 16;
+constexpr int kWordStart = 8;
+constexpr int kFirst = 8;
+constexpr int kConsecutive = 12;
+constexpr int kSameCase = 1;
+constexpr int kMaxLeadingGap = 3;
+
+// What a query character matched at byte `at` scores when it comes first
+int firstScore(size_t at) {
+    return kMatch + kWordStart + (at == 0 ? kFirst : -std::min<int>(static_cast<int>(at), kMaxLeadingGap));
+}
+
+// Best match of `query` in `text` under the word-start rule. Each matched
+// character scores, more at word starts, at the very start and right after
+// the previous match; every skipped character costs one. Only positions
+// holding a query character can take part, usually a handful, so the
+// alignment runs over those instead of the whole name.
+int fuzzyScore(std::string_view query, std::string_view text, uint64_t wordStarts) {
+    constexpr size_t kMaxPositions = 32;
+
+    text = text.substr(0, kMaxScored);
+    const size_t m = query.size();
+    if (m == 0 || m > text.size()) return kNoMatch;
+
+    uint64_t wanted = 0;
+    for (char c : query) wanted |= uint64_t(1) << fold(c);
+    uint8_t position[kMaxPositions];
+    uint8_t folded[kMaxPositions];
+    bool starts[kMaxPositions];
+    size_t count = 0;
+    for (size_t j = 0; j < text.size() && count < kMaxPositions; j++) {
+        const uint8_t c = fold(text[j]);
+        if (!(wanted >> c & 1)) continue;
+        position[count] = static_cast<uint8_t>(j);
+        folded[count] = c;
+        starts[count] = wordStarts >> j & 1;
+        count++;
+    }
+    if (count == 0) return kNoMatch;
+    auto bonus = [&](size_t i, size_t p) {
+        const size_t j = position[p];
+        return kMatch + (starts[p] ? kWordStart : 0) + (query[i] == text[j] ? kSameCase : 0);
+    };
+
+    // previous[p] / current[p]: best score with this query character at
+    // position[p]
+    int previous[kMaxPositions];
+    int current[kMaxPositions];
+    const uint8_t first = fold(query[0]);
+    for (size_t p = 0; p < count; p++) {
+        const int j = position[p];
+        previous[p] = starts[p] && folded[p] == first ? firstScore(j) + (query[0] == text[j] ? kSameCase : 0) : kNoMatch;
+    }
+    for (size_t i = 1; i < m; i++) {
+        const uint8_t c = fold(query[i]);
+        bool any = false;
+        int gapBest = kNoMatch; // Max of previous[q] + position[q] over q < p - 1
+        for (size_t p = 0; p < count; p++) {
+            if (p >= 2 && previous[p - 2] != kNoMatch) gapBest = std::max(gapBest, previous[p - 2] + position[p - 2]);
+            current[p] = kNoMatch;
+            if (folded[p] != c || p == 0) continue;
+            int best = kNoMatch;
+            int gapped = gapBest;
+            if (previous[p - 1] != kNoMatch) {
+                if (position[p - 1] + 1 == position[p]) best = previous[p - 1] + kConsecutive;
+                else gapped = std::max(gapped, previous[p - 1] + position[p - 1]);
+            }
+            if (starts[p] && gapped != kNoMatch) best = std::max(best, gapped - position[p] + 1);
+            if (best == kNoMatch) continue;
+            current[p] = best + bonus(i, p);
+            any = true;
+        }
+        if (!any) return kNoMatch;
+        std::copy(current, current + count, previous);
+    }
+    const int best = *std::max_element(previous, previous + count);
+    // Shorter names rank higher among equal matches
+    return best - static_cast<int>(text.size() - m) / 4;
+}
+
+// Frequently used symbols get up to 16 points, two per doubling
+constexpr int kMaxUsesBonus = 16;
+
+int usesBonus(uint32_t uses) {
+    int bonus = 0;
+    while (uses > 1 && bonus < kMaxUsesBonus) {
+        uses >>= 1;
+        bonus += 2;
+    }
+    return bonus;
+}
+
+// Bonus of a symbol whose count is zero
+constexpr uint8_t kUnused = UINT8_MAX;
+
+} // namespace
+
+RuneCompletionIndex::RuneCompletionIndex() : buckets_(kWordChars + kWordChars * kWordChars) {
+    nodes_.emplace_back();
+}
+
+// Names are stored behind their word-start positions, which scoring needs
+// and now finds in the same cache line
+const char* RuneCompletionIndex::store(std::string_view word) {
+    const size_t size = sizeof(uint64_t) + word.size();
+    if (kBlockSize - used_ < size) {
+        // A name longer than a block gets one of its own size
+        blocks_.push_back(std::make_unique<char[]>(std::max(size, kBlockSize)));
+        used_ = 0;
+    }
+    char* copy = blocks_.back().get() + used_;
+    used_ = size > kBlockSize ? kBlockSize : used_ + size;
+    const uint64_t starts = wordStartsOf(word);
+    std::memcpy(copy, &starts, sizeof(starts));
+    return static_cast<char*>(std::memcpy(copy + sizeof(starts), word.data(), word.size()));
+}
+
+std::string_view RuneCompletionIndex::name(uint32_t symbol) const {
+    return {symbols_[symbol].name, symbols_[symbol].length};
+}
+
+std::string_view RuneCompletionIndex::label(const TrieNode& node) const {
+    return name(node.labelSymbol).substr(node.labelStart, node.labelLength);
+}
+
+uint32_t RuneCompletionIndex::intern(std::string_view word) {
+    const auto found = ids_.find(word);
+    if (found != ids_.end()) return found->second;
+
+    const uint32_t id = static_cast<uint32_t>(symbols_.size());
+    symbols_.push_back({store(word), static_cast<uint32_t>(word.size()), 0});
+    bonus_.push_back(kUnused);
+    ids_.emplace(name(id), id);
+    insertIntoTrie(id);
+
+    // A match begins at a word start and continues with the character
+    // after it or with a later word start
+    Candidate candidate{0, {0, 0}, symbols_[id].name, id, static_cast<uint16_t>(std::min<size_t>(word.size(), UINT16_MAX)), 0};
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < word.size(); i++) {
+        if (isWordStart(word, i)) {
+            starts.push_back(i);
+            candidate.starts |= uint64_t(1) << fold(word[i]);
+        }
+        if (i > 0 && isWordChar(word[i - 1]) && isWordChar(word[i])) {
+            const unsigned bit = adjacentBit(fold(word[i - 1]), fold(word[i]));
+            candidate.adjacent[bit / 64] |= uint64_t(1) << bit % 64;
+        }
+    }
+    // Bucket and the best its two characters score here, case aside
+    std::vector<std::pair<size_t, int>> filed;
+    for (size_t start = 0; start < starts.size(); start++) {
+        const size_t at = starts[start];
+        const uint8_t first = fold(word[at]);
+        const int head = firstScore(at);
+        filed.emplace_back(first, head);
+        if (at + 1 < word.size() && isWordChar(word[at + 1])) {
+            const int next = kMatch + kConsecutive + (isWordStart(word, at + 1) ? kWordStart : 0);
+            filed.emplace_back(pairBucket(first, fold(word[at + 1])), head + next);
+        }
+        for (size_t later = start + 1; later < starts.size(); later++) {
+            const int gap = static_cast<int>(starts[later] - at - 1);
+            filed.emplace_back(pairBucket(first, fold(word[starts[later]])), head + kMatch + kWordStart - gap);
+        }
+    }
+    // Highest score first within each bucket, then keep that one
+    std::sort(filed.begin(), filed.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second > b.second;
+    });
+    for (size_t i = 0; i < filed.size(); i++) {
+        if (i > 0 && filed[i].first == filed[i - 1].first) continue;
+        candidate.pairScore = static_cast<int16_t>(std::max(filed[i].second, INT16_MIN + 1));
+        buckets_[filed[i].first].push_back(candidate);
+    }
+    return id;
+}
+
+void RuneCompletionIndex::insertIntoTrie(uint32_t symbol) {
+    const std::string_view word = name(symbol);
+    auto byFirstByte = [this](uint32_t child, char c) { return label(nodes_[child])[0] < c; };
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < word.size()) {
+        std::vector<uint32_t>& children = nodes_[node].children;
+        const auto it = std::lower_bound(children.begin(), children.end(), word[pos], byFirstByte);
+        const size_t at = it - children.begin();
+        if (it == children.end() || label(nodes_[*it])[0] != word[pos]) {
+            TrieNode leaf;
+            leaf.labelSymbol = symbol;
+            leaf.labelStart = static_cast<uint32_t>(pos);
+            leaf.labelLength = static_cast<uint32_t>(word.size() - pos);
+            leaf.symbol = symbol;
+            const uint32_t id = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back(std::move(leaf)); // Invalidates `children`
+            nodes_[node].children.insert(nodes_[node].children.begin() + at, id);
+            return;
+        }
+
+        uint32_t child = *it;
+        const std::string_view edge = label(nodes_[child]);
+        size_t common = 1;
+        while (common < edge.size() && pos + common < word.size() && edge[common] == word[pos + common]) common++;
+        if (common < edge.size()) {
+            // Split the edge where the word leaves it
+            TrieNode middle;
+            middle.labelSymbol = nodes_[child].labelSymbol;
+            middle.labelStart = nodes_[child].labelStart;
+            middle.labelLength = static_cast<uint32_t>(common);
+            middle.best = nodes_[child].best;
+            middle.children.push_back(child);
+            nodes_[child].labelStart += static_cast<uint32_t>(common);
+            nodes_[child].labelLength -= static_cast<uint32_t>(common);
+            const uint32_t id = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back(std::move(middle));
+            nodes_[node].children[at] = id;
+            child = id;
+        }
+        pos += common;
+        node = child;
+    }
+    nodes_[node].symbol = symbol;
+}
+
+std::vector<uint32_t> RuneCompletionIndex::pathTo(uint32_t symbol) const {
+    const std::string_view word = name(symbol);
+    std::vector<uint32_t> path{0};
+    size_t pos = 0;
+    while (pos < word.size()) {
+        for (uint32_t child : nodes_[path.back()].children) {
+            if (label(nodes_[child])[0] == word[pos]) {
+                pos += nodes_[child].labelLength;
+                path.push_back(child);
+                break;
+            }
+        }
+    }
+    return path;
+}
+
+void RuneCompletionIndex::add(std::string_view word, uint32_t uses) {
+    if (word.empty() || uses == 0) return;
+    const uint32_t id = intern(word);
+    Symbol& symbol = symbols_[id];
+    if (symbol.uses == 0) live_++;
+    symbol.uses += uses;
+    bonus_[id] = static_cast<uint8_t>(usesBonus(symbol.uses));
+    for (uint32_t node : pathTo(id)) nodes_[node].best = std::max(nodes_[node].best, symbol.uses);
+}
+
+void RuneCompletionIndex::remove(std::string_view word, uint32_t uses) {
+    const auto found = ids_.find(word);
+    if (found == ids_.end()) return;
+    Symbol& symbol = symbols_[found->second];
+    const uint32_t old = symbol.uses;
+    if (old == 0) return;
+    symbol.uses -= std::min(uses, old);
+    if (symbol.uses == 0) live_--;
+    bonus_[found->second] = symbol.uses == 0 ? kUnused : static_cast<uint8_t>(usesBonus(symbol.uses));
+
+    // Only nodes whose best was this symbol change, from the bottom up
+    const std::vector<uint32_t> path = pathTo(found->second);
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        TrieNode& node = nodes_[*it];
+        if (node.best > old) break;
+        node.best = node.symbol == kNoSymbol ? 0 : symbols_[node.symbol].uses;
+        for (uint32_t child : node.children) node.best = std::max(node.best, nodes_[child].best);
+    }
+}
+
+void RuneCompletionIndex::addIdentifiers(std::string_view text) {
+    forEachIdentifier(text, [this](std::string_view word) { add(word); });
+}
+
+void RuneCompletionIndex::removeIdentifiers(std::string_view text) {
+    forEachIdentifier(text, [this](std::string_view word) { remove(word); });
+}
+
+uint32_t RuneCompletionIndex::uses(std::string_view word) const {
+    const auto found = ids_.find(word);
+    return found == ids_.end() ? 0 : symbols_[found->second].uses;
+}
+
+uint32_t RuneCompletionIndex::bestUse(std::string_view prefix) const {
+    const uint32_t node = subtreeOf(prefix);
+    return node == kNoSymbol ? 0 : nodes_[node].best;
+}
+
+uint32_t RuneCompletionIndex::subtreeOf(std::string_view prefix) const {
+    // The prefix may end inside an edge
+    uint32_t node = 0;
+    size_t pos = 0;
+    while (pos < prefix.size()) {
+        uint32_t next = kNoSymbol;
+        for (uint32_t child : nodes_[node].children) {
+            if (label(nodes_[child])[0] == prefix[pos]) next = child;
+        }
+        if (next == kNoSymbol) return kNoSymbol;
+        const std::string_view edge = label(nodes_[next]);
+        const size_t length = std::min(edge.size(), prefix.size() - pos);
+        if (edge.compare(0, length, prefix, pos, length) != 0) return kNoSymbol;
+        pos += length;
+        node = next;
+    }
+    return node;
+}
+
+void RuneCompletionIndex::prefixMatches(std::string_view prefix, size_t limit, std::vector<Completion>& out) const {
+    const uint32_t node = subtreeOf(prefix);
+    if (node == kNoSymbol) return;
+
+    // Best first: a node is queued under the highest count below it, so
+    // the first K symbols popped are the K most used
+    struct Item {
+        uint32_t weight;
+        bool symbol; // Index is a symbol rather than a node
+        uint32_t index;
+        bool operator<(const Item& other) const {
+            return weight != other.weight ? weight < other.weight : symbol < other.symbol;
+        }
+    };
+    std::priority_queue<Item> queue;
+    if (nodes_[node].best > 0) queue.push({nodes_[node].best, false, node});
+    while (!queue.empty() && out.size() < limit) {
+        const Item item = queue.top();
+        queue.pop();
+        if (item.symbol) {
+            out.push_back({name(item.index), static_cast<int>(item.weight), true});
+            continue;
+        }
+        const TrieNode& current = nodes_[item.index];
+        if (current.symbol != kNoSymbol && symbols_[current.symbol].uses > 0) {
+            queue.push({symbols_[current.symbol].uses, true, current.symbol});
+        }
+        for (uint32_t child : current.children) {
+            if (nodes_[child].best > 0) queue.push({nodes_[child].best, false, child});
+        }
+    }
+}
+
+void RuneCompletionIndex::fuzzyMatches(std::string_view query, size_t limit, std::vector<Completion>& out) const {
+    for (char c : query) {
+        if (!isWordChar(c)) return;
+    }
+    if (limit == 0) return;
+    const size_t bucket = query.size() > 1 ? pairBucket(fold(query[0]), fold(query[1])) : fold(query[0]);
+
+    struct Scored {
+        int score;
+        uint32_t length;
+        uint32_t symbol;
+    };
+    // Used as the heap's "less", so the front is the weakest of the best
+    // `limit` and sort_heap lists the strongest first
+    auto ranksAbove = [](const Scored& a, const Scored& b) {
+        return a.score != b.score ? a.score > b.score : a.length < b.length;
+    };
+    std::vector<Scored> heap;
+    heap.reserve(limit + 1);
+    auto score = [&](const Candidate& candidate, int bonus) {
+        const std::string_view text(candidate.name, candidate.length);
+        // Prefix matches were all listed already, or the list is full
+        if (text.compare(0, query.size(), query) == 0) return;
+        uint64_t wordStarts;
+        std::memcpy(&wordStarts, candidate.name - sizeof(wordStarts), sizeof(wordStarts));
+        const int matched = fuzzyScore(query, text, wordStarts);
+        if (matched == kNoMatch) return;
+        const Scored scored{matched + bonus, candidate.length, candidate.symbol};
+        if (heap.size() == limit) {
+            if (!ranksAbove(scored, heap.front())) return;
+            std::pop_heap(heap.begin(), heap.end(), ranksAbove);
+            heap.pop_back();
+        }
+        heap.push_back(scored);
+        std::push_heap(heap.begin(), heap.end(), ranksAbove);
+    };
+
+    // The bucket fixes how well the first two characters can score; each
+    // later one must start a word or follow its predecessor, and scores at
+    // most as if it did both. Candidates are scored from the highest bound
+    // down until none can beat the weakest result kept.
+    const int m = static_cast<int>(query.size());
+    int later[2] = {0, 0}; // Bound of a later character: [can follow its predecessor]
+    struct Bounded {
+        int bound;
+        int bonus;
+        const Candidate* candidate;
+    };
+    std::vector<Bounded> bounded;
+    int lowest = INT_MAX;
+    int highest = INT_MIN;
+    for (const Candidate& candidate : buckets_[bucket]) {
+        const uint8_t bonus = bonus_[candidate.symbol];
+        if (bonus == kUnused) continue;
+        int bound = candidate.pairScore + std::min(m, 2) * kSameCase + bonus;
+        bool possible = true;
+        for (size_t i = 2; i < query.size() && possible; i++) {
+            const uint8_t here = fold(query[i]);
+            const bool start = candidate.starts >> here & 1;
+            const unsigned bit = adjacentBit(fold(query[i - 1]), here);
+            const bool follows = candidate.adjacent[bit / 64] >> bit % 64 & 1;
+            possible = start || follows;
+            later[0] = kMatch + kSameCase + kWordStart - 1;
+            later[1] = kMatch + kSameCase + kConsecutive + (start ? kWordStart : 0);
+            bound += later[follows];
+        }
+        if (!possible) continue;
+        const int scored = std::min<int>(candidate.length, kMaxScored);
+        bound -= std::max(scored - m, 0) / 4;
+        lowest = std::min(lowest, bound);
+        highest = std::max(highest, bound);
+        bounded.push_back({bound, bonus, &candidate});
+    }
+    if (bounded.empty()) return;
+
+    // Bounds span a few hundred values at most, so a counting sort orders
+    // large buckets in linear time
+    std::vector<uint32_t> offsets(static_cast<size_t>(highest - lowest) + 2, 0);
+    for (const Bounded& entry : bounded) offsets[highest - entry.bound + 1]++;
+    for (size_t i = 1; i < offsets.size(); i++) offsets[i] += offsets[i - 1];
+    std::vector<Bounded> ordered(bounded.size());
+    for (const Bounded& entry : bounded) ordered[offsets[highest - entry.bound]++] = entry;
+
+    // Names are scattered over the blocks; prefetching a few ahead overlaps
+    // their cache misses
+    constexpr size_t kAhead = 8;
+    for (size_t i = 0; i < ordered.size(); i++) {
+        if (heap.size() == limit && ordered[i].bound < heap.front().score) break;
+        if (i + kAhead < ordered.size()) __builtin_prefetch(ordered[i + kAhead].candidate->name - sizeof(uint64_t));
+        score(*ordered[i].candidate, ordered[i].bonus);
+    }
+    std::sort_heap(heap.begin(), heap.end(), ranksAbove);
+    for (const Scored& scored : heap) out.push_back({name(scored.symbol), scored.score, false});
+}
+
+std::vector<Completion> RuneCompletionIndex::complete(std::string_view query, size_t limit) const {
+    std::vector<Completion> out;
+    prefixMatches(query, limit, out);
+    if (!query.empty() && out.size() < limit) fuzzyMatches(query, limit - out.size(), out);
+    return out;
+}
+
+} // namespace RuneLang
@@ -0,0 +1,37 @@
+#include "../include/RuneDocument.hpp"
+#include <algorithm>
+
+namespace RuneLang {
+
+RuneDocument::RuneDocument(const std::string& text)
+    : text_(text), semicolons_(std::count(text.begin(), text.end(), ';')) {
+    const RuneHighlighter::LineSource source = lines();
+    highlighter_.reset(text_.lineCount(), source);
+    brackets_.reset(highlighter_, source);
+}
+
+RuneHighlighter::LineSource RuneDocument::lines() const {
+    return [this](size_t index) { return text_.snapshot().line(index); };
+}
+
+EditedLines RuneDocument::edit(size_t offset, size_t length, const std::string& inserted) {
+    // Read before the buffer changes; a range past the end throws here
+    const RuneTextSnapshot& before = text_.snapshot();
+    const std::string removed = before.text(offset, length);
+    EditedLines edited;
+    edited.first = before.lineOf(offset);
+    edited.removed = before.lineOf(offset + length) - edited.first + 1;
+
+    if (length > 0) text_.erase(offset, length);
+    if (!inserted.empty()) text_.insert(offset, inserted);
+    edited.inserted = text_.snapshot().lineOf(offset + inserted.size()) - edited.first + 1;
+    semicolons_ += std::count(inserted.begin(), inserted.end(), ';');
+    semicolons_ -= std::count(removed.begin(), removed.end(), ';');
+
+    const RuneHighlighter::LineSource source = lines();
+    highlighter_.update(edited.first, edited.removed, edited.inserted, source);
+    brackets_.update(edited.first, edited.removed, edited.inserted, highlighter_, source);
+    return edited;
+}
+
+} // namespace RuneLang
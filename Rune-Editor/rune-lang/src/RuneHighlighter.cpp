@@ -0,0 +1,141 @@
+#include "../include/RuneHighlighter.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace RuneLang {
+
+namespace {
+
+bool isIdentStart(unsigned char c) {
+    return c == '_' || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+bool isDigit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool isKeyword(std::string_view word) {
+    static const std::unordered_set<std::string_view> keywords = {
+        "if", "else", "for", "while", "return", "int", "float", "double",
+        "char", "void", "class", "namespace", "struct"
+    };
+    return keywords.count(word) != 0;
+}
+
+// The Runic block, U+16A0 to U+16FF, is E1 9A A0 to E1 9B BF in UTF-8
+bool isRune(std::string_view line, size_t pos) {
+    if (pos + 2 >= line.size() || static_cast<unsigned char>(line[pos]) != 0xE1) return false;
+    const unsigned char second = static_cast<unsigned char>(line[pos + 1]);
+    const unsigned char third = static_cast<unsigned char>(line[pos + 2]);
+    if (third < 0x80 || third > 0xBF) return false;
+    return (second == 0x9A && third >= 0xA0) || second == 0x9B;
+}
+
+void addSpan(std::vector<HighlightSpan>* spans, size_t start, size_t length, TokenKind kind) {
+    if (spans && length > 0) spans->push_back({start, length, kind});
+}
+
+} // namespace
+
+LexState lexLine(std::string_view line, LexState state, std::vector<HighlightSpan>* spans) {
+    size_t pos = 0;
+    if (state == LexState::BlockComment) {
+        const size_t end = line.find("*/");
+        if (end == std::string_view::npos) {
+            addSpan(spans, 0, line.size(), TokenKind::Comment);
+            return LexState::BlockComment;
+        }
+        addSpan(spans, 0, end + 2, TokenKind::Comment);
+        pos = end + 2;
+    }
+
+    while (pos < line.size()) {
+        if (!spans) {
+            // Only comments and strings decide the state
+            while (pos < line.size() && line[pos] != '/' && line[pos] != '"' && line[pos] != '\'') pos++;
+            if (pos == line.size()) break;
+        }
+        const unsigned char c = line[pos];
+        const char next = pos + 1 < line.size() ? line[pos + 1] : '\0';
+        if (c == '/' && next == '/') {
+            addSpan(spans, pos, line.size() - pos, TokenKind::Comment);
+            return LexState::Code;
+        }
+        if (c == '/' && next == '*') {
+            const size_t end = line.find("*/", pos + 2);
+            if (end == std::string_view::npos) {
+                addSpan(spans, pos, line.size() - pos, TokenKind::Comment);
+                return LexState::BlockComment;
+            }
+            addSpan(spans, pos, end + 2 - pos, TokenKind::Comment);
+            pos = end + 2;
+        } else if (c == '"' || c == '\'') {
+            // An unterminated string ends with its line
+            size_t end = pos + 1;
+            while (end < line.size() && line[end] != static_cast<char>(c)) {
+                end += line[end] == '\\' ? 2 : 1;
+            }
+            end = std::min(end + 1, line.size());
+            addSpan(spans, pos, end - pos, TokenKind::String);
+            pos = end;
+        } else if (isDigit(c)) {
+            size_t end = pos + 1;
+            while (end < line.size() && (isIdentStart(line[end]) || isDigit(line[end]) || line[end] == '.')) end++;
+            addSpan(spans, pos, end - pos, TokenKind::Number);
+            pos = end;
+        } else if (isIdentStart(c)) {
+            size_t end = pos + 1;
+            while (end < line.size() && (isIdentStart(line[end]) || isDigit(line[end]))) end++;
+            if (isKeyword(line.substr(pos, end - pos))) addSpan(spans, pos, end - pos, TokenKind::Keyword);
+            pos = end;
+        } else if (isRune(line, pos)) {
+            addSpan(spans, pos, 3, TokenKind::Rune);
+            pos += 3;
+        } else {
+            pos++;
+        }
+    }
+    return LexState::Code;
+}
+
+void RuneHighlighter::reset(size_t lineCount, const LineSource& lines) {
+    endStates_.assign(lineCount, LexState::Code);
+    LexState state = LexState::Code;
+    for (size_t line = 0; line < lineCount; line++) {
+        state = lexLine(lines(line), state);
+        endStates_[line] = state;
+    }
+}
+
+size_t RuneHighlighter::update(size_t first, size_t removed, size_t inserted, const LineSource& lines) {
+    if (first > endStates_.size() || removed > endStates_.size() - first) {
+        throw std::out_of_range("RuneHighlighter::update: edited lines out of range");
+    }
+    endStates_.erase(endStates_.begin() + first, endStates_.begin() + first + removed);
+    endStates_.insert(endStates_.begin() + first, inserted, LexState::Code);
+
+    // Past the new lines, a line ending in the state it ended in before
+    // means everything below it is unchanged
+    LexState state = stateBefore(first);
+    size_t line = first;
+    while (line < endStates_.size()) {
+        state = lexLine(lines(line), state);
+        const bool settled = line >= first + inserted && endStates_[line] == state;
+        endStates_[line++] = state;
+        if (settled) break;
+    }
+    return line - first;
+}
+
+LexState RuneHighlighter::stateBefore(size_t line) const {
+    return line == 0 ? LexState::Code : endStates_.at(line - 1);
+}
+
+std::vector<HighlightSpan> RuneHighlighter::highlight(size_t line, std::string_view text) const {
+    std::vector<HighlightSpan> spans;
+    lexLine(text, stateBefore(line), &spans);
+    return spans;
+}
+
+} // namespace RuneLang
@@ -1,4 +1,9 @@
 #include "../include/RuneParser.hpp"
+#include "../include/RuneHighlighter.hpp"
+#include "../include/RuneViewport.hpp"
+#include "../include/RuneBrackets.hpp"
+#include "../include/RuneCompletion.hpp"
+#include "../include/RuneDocument.hpp"
 #include <sstream>
 #include <fstream>
 #include <map>
@@ -52,14 +57,33 @@ struct SyntaxError {
 
 std::list<SyntaxError> syntaxErrors;
 
-void checkForErrors(const std::string& code) {
+const char* bracketName(BracketKind kind) {
+    switch (kind) {
+        case BracketKind::Brace: return "brace";
+        case BracketKind::Paren: return "parenthesis";
+        case BracketKind::Square: return "bracket";
+        default: return "block rune";
+    }
+}
+
+// Nesting errors from an index the editor keeps up to date while typing
+void checkBrackets(const RuneBracketIndex& brackets) {
+    const std::optional<BracketPosition> unmatched = brackets.firstUnmatched();
+    if (unmatched) {
+        syntaxErrors.push_back({std::string("Syntax Error: Unmatched ") + (unmatched->open ? "opening " : "closing ") +
+                                    bracketName(unmatched->kind) + ".",
+                                static_cast<int>(unmatched->line + 1)});
+    }
+}
+
+// Reads only state the document's edits keep up to date, so live
+// checking does not rescan the buffer
+void checkForErrors(const RuneDocument& document) {
     // Simple error checking logic
-    if (code.find(";") == std::string::npos) {
+    if (document.semicolons() == 0) {
         syntaxErrors.push_back({"Syntax Error: Missing semicolon.", 0});
     }
-    if (code.find("{") != std::string::npos && code.find("}") == std::string::npos) {
-        syntaxErrors.push_back({"Syntax Error: Unmatched opening brace.", 0});
-    }
+    checkBrackets(document.brackets());
     // Add more error checks as needed
 }
 
@@ -247,24 +271,47 @@ ColorSettings loadColorSettings() {
     return {"#0000FF", "#008000", "#808080"}; // Blue, Green, Gray
 }
 
+const char* ansiColor(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::Keyword:
+        case TokenKind::Rune: return "\033[38;5;34m";     // Green
+        case TokenKind::String: return "\033[38;5;172m";  // Orange
+        case TokenKind::Comment: return "\033[38;5;245m"; // Gray
+        case TokenKind::Number: return "\033[38;5;141m";  // Purple
+        default: return "";
+    }
+}
+
+void printHighlighted(std::string_view line, const std::vector<HighlightSpan>& spans) {
+    size_t pos = 0;
+    for (const HighlightSpan& span : spans) {
+        std::cout << line.substr(pos, span.start - pos) << ansiColor(span.kind)
+                  << line.substr(span.start, span.length) << "\033[0m";
+        pos = span.start + span.length;
+    }
+    std::cout << line.substr(pos) << '\n';
+}
+
 void applySyntaxHighlighting(const std::string& code) {
-    ColorSettings colors = loadColorSettings();
     std::istringstream codeStream(code);
     std::string line;
+    std::vector<HighlightSpan> spans;
+    LexState state = LexState::Code;
 
     while (std::getline(codeStream, line)) {
-        // Example highlighting logic
-        if (line.find("//") != std::string::npos) {
-            // Highlight comments
-            std::cout << "\033[38;5;245m" << line << "\033[0m" << std::endl; // Gray
-        } else if (line.find("int") != std::string::npos) {
-            // Highlight keywords
-            std::cout << "\033[38;5;34m" << line << "\033[0m" << std::endl; // Green
-        } else {
-            // Regular line
-            std::cout << line << std::endl;
-        }
+        spans.clear();
+        state = lexLine(line, state, &spans);
+        printHighlighted(line, spans);
+    }
+    std::cout.flush();
+}
+
+// Prints only lines [firstLine, firstLine + lineCount), the part on screen
+void applySyntaxHighlighting(const RuneTextSnapshot& text, RuneViewport& viewport, size_t firstLine, size_t lineCount) {
+    for (const StyledLine& line : viewport.render(text, firstLine, lineCount)) {
+        printHighlighted(line.text, line.spans);
     }
+    std::cout.flush();
 }
 
 void loadKeybindings() {
@@ -310,19 +357,70 @@ void executeCode(const std::string& code) {
     }
 }
 
+// Keywords, then the identifiers of open buffers as they are edited
+RuneCompletionIndex& completionIndex() {
+    static RuneCompletionIndex index = [] {
+        RuneCompletionIndex seeded;
+        for (const auto& keyword : keywords) seeded.add(keyword);
+        return seeded;
+    }();
+    return index;
+}
+
+// Call with the old and new text of every edited line, or with the whole
+// text of a buffer as it is opened or closed
+void updateSuggestions(std::string_view removed, std::string_view inserted) {
+    completionIndex().removeIdentifiers(removed);
+    completionIndex().addIdentifiers(inserted);
+}
+
+// Open buffers by path, each kept up to date by its edits
+std::map<std::string, RuneDocument> openBuffers;
+
+// Text of lines [first, first + count) of `text`
+std::string linesOf(const RuneTextSnapshot& text, size_t first, size_t count) {
+    const size_t start = text.lineStart(first);
+    const size_t end = first + count < text.lineCount() ? text.lineStart(first + count) : text.size();
+    return text.text(start, end - start);
+}
+
+void closeBuffer(const std::string& path);
+
+void openBuffer(const std::string& path, const std::string& contents) {
+    closeBuffer(path);
+    openBuffers.try_emplace(path, contents);
+    updateSuggestions({}, contents);
+}
+
+// Replaces `length` bytes at `offset` of an open buffer with `inserted`
+void editBuffer(const std::string& path, size_t offset, size_t length, const std::string& inserted) {
+    RuneDocument& document = openBuffers.at(path);
+    const RuneTextSnapshot before = document.text().snapshot();
+    const EditedLines edited = document.edit(offset, length, inserted);
+    updateSuggestions(linesOf(before, edited.first, edited.removed),
+                      linesOf(document.text().snapshot(), edited.first, edited.inserted));
+}
+
+void closeBuffer(const std::string& path) {
+    const auto found = openBuffers.find(path);
+    if (found == openBuffers.end()) return;
+    updateSuggestions(found->second.text().snapshot().toString(), {});
+    openBuffers.erase(found);
+}
+
+// Live check of an open buffer, for the editor to call as the user types
+void checkBuffer(const std::string& path) {
+    checkForErrors(openBuffers.at(path));
+}
+
 void showSuggestions(const std::string& input) {
-    std::vector<std::string> suggestions;
-    for (const auto& keyword : keywords) {
-        if (keyword.find(input) == 0) { // Match from the start
-            suggestions.push_back(keyword);
-        }
-    }
+    const std::vector<Completion> suggestions = completionIndex().complete(input);
 
     // Display suggestions
     if (!suggestions.empty()) {
         std::cout << "Suggestions:" << std::endl;
         for (const auto& suggestion : suggestions) {
-            std::cout << "- " << suggestion << std::endl;
+            std::cout << "- " << suggestion.text << std::endl;
         }
     } else {
         std::cout << "No suggestions found." << std::endl;
@@ -335,7 +433,8 @@ void processInput(const std::string& input) {
 }
 
 std::string RuneParser::compileToCpp(const std::string& runeCode) {
-    checkForErrors(runeCode); // Check for errors before compiling
+    // A compile has no open buffer, so its code is indexed once here
+    checkForErrors(RuneDocument(runeCode)); // Check for errors before compiling
     std::string cppCode = parseRuneCode(runeCode);
     std::ofstream outputFile("output.cpp");
     outputFile << "#include <iostream>\n\n" << cppCode << "\nint main() {\n\treturn 0;\n}";
@@ -0,0 +1,275 @@
+#include "../include/RuneTextBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace RuneLang {
+
+using namespace TextBufferDetail;
+
+namespace {
+
+size_t countNewlines(const char* text, size_t length) {
+    size_t count = 0;
+    const char* end = text + length;
+    while ((text = static_cast<const char*>(std::memchr(text, '\n', end - text)))) {
+        count++;
+        text++;
+    }
+    return count;
+}
+
+size_t lengthOf(const NodePtr& node) { return node ? node->totalLength : 0; }
+size_t newlinesOf(const NodePtr& node) { return node ? node->totalNewlines : 0; }
+size_t piecesOf(const NodePtr& node) { return node ? node->totalPieces : 0; }
+
+NodePtr makeNode(const Piece& piece, uint32_t priority, NodePtr left, NodePtr right) {
+    const size_t length = lengthOf(left) + piece.length + lengthOf(right);
+    const size_t newlines = newlinesOf(left) + piece.newlines + newlinesOf(right);
+    const size_t pieces = piecesOf(left) + 1 + piecesOf(right);
+    return std::make_shared<const Node>(
+        Node{piece, length, newlines, pieces, priority, std::move(left), std::move(right)});
+}
+
+Piece makePiece(const char* text, size_t length) {
+    return {text, length, countNewlines(text, length)};
+}
+
+// Everything before byte `offset` goes to `left`, the rest to `right`. A
+// piece straddling the offset is cut in two.
+void split(const NodePtr& node, size_t offset, NodePtr& left, NodePtr& right) {
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    const size_t before = lengthOf(node->left);
+    const Piece& piece = node->piece;
+    if (offset <= before) {
+        NodePtr rest;
+        split(node->left, offset, left, rest);
+        right = makeNode(piece, node->priority, std::move(rest), node->right);
+    } else if (offset >= before + piece.length) {
+        NodePtr rest;
+        split(node->right, offset - before - piece.length, rest, right);
+        left = makeNode(piece, node->priority, node->left, std::move(rest));
+    } else {
+        const size_t cut = offset - before;
+        const Piece head = makePiece(piece.text, cut);
+        const Piece tail{piece.text + cut, piece.length - cut, piece.newlines - head.newlines};
+        left = makeNode(head, node->priority, node->left, nullptr);
+        right = makeNode(tail, node->priority, nullptr, node->right);
+    }
+}
+
+// Concatenates two treaps, every piece of `left` before every piece of `right`
+NodePtr merge(const NodePtr& left, const NodePtr& right) {
+    if (!left) return right;
+    if (!right) return left;
+    if (left->priority > right->priority) {
+        return makeNode(left->piece, left->priority, left->left, merge(left->right, right));
+    }
+    return makeNode(right->piece, right->priority, merge(left, right->left), right->right);
+}
+
+const Piece* lastPiece(const NodePtr& node) {
+    if (!node) return nullptr;
+    const Node* current = node.get();
+    while (current->right) current = current->right.get();
+    return &current->piece;
+}
+
+// Copy of `node` with its last piece replaced
+NodePtr replaceLast(const NodePtr& node, const Piece& piece) {
+    if (!node->right) return makeNode(piece, node->priority, node->left, nullptr);
+    return makeNode(node->piece, node->priority, node->left, replaceLast(node->right, piece));
+}
+
+// Calls `visit(text, length)` for the pieces covering [offset, offset + length)
+template <typename Visit>
+void visitRange(const NodePtr& node, size_t offset, size_t length, Visit& visit) {
+    if (!node || length == 0) return;
+    const size_t before = lengthOf(node->left);
+    if (offset < before) {
+        visitRange(node->left, offset, std::min(length, before - offset), visit);
+    }
+    const Piece& piece = node->piece;
+    const size_t pieceEnd = before + piece.length;
+    if (offset < pieceEnd && offset + length > before) {
+        const size_t from = offset > before ? offset - before : 0;
+        const size_t to = std::min(offset + length, pieceEnd) - before;
+        visit(piece.text + from, to - from);
+    }
+    if (offset + length > pieceEnd) {
+        const size_t from = offset > pieceEnd ? offset - pieceEnd : 0;
+        visitRange(node->right, from, offset + length - pieceEnd - from, visit);
+    }
+}
+
+} // namespace
+
+size_t RuneTextSnapshot::size() const {
+    return lengthOf(root_);
+}
+
+size_t RuneTextSnapshot::lineCount() const {
+    return newlinesOf(root_) + 1;
+}
+
+size_t RuneTextSnapshot::lineStart(size_t line) const {
+    if (line >= lineCount()) {
+        throw std::out_of_range("RuneTextSnapshot::lineStart: no line " + std::to_string(line));
+    }
+    if (line == 0) return 0;
+
+    // Find the line-th newline; the line starts right after it
+    size_t remaining = line;
+    size_t offset = 0;
+    const Node* node = root_.get();
+    while (true) {
+        const size_t leftNewlines = newlinesOf(node->left);
+        if (remaining <= leftNewlines) {
+            node = node->left.get();
+            continue;
+        }
+        remaining -= leftNewlines;
+        offset += lengthOf(node->left);
+        const Piece& piece = node->piece;
+        if (remaining <= piece.newlines) {
+            const char* cursor = piece.text;
+            const char* end = piece.text + piece.length;
+            for (;;) {
+                cursor = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor)) + 1;
+                if (--remaining == 0) return offset + (cursor - piece.text);
+            }
+        }
+        remaining -= piece.newlines;
+        offset += piece.length;
+        node = node->right.get();
+    }
+}
+
+size_t RuneTextSnapshot::lineOf(size_t offset) const {
+    if (offset > size()) {
+        throw std::out_of_range("RuneTextSnapshot::lineOf: offset " + std::to_string(offset) + " past the end");
+    }
+    size_t line = 0;
+    const Node* node = root_.get();
+    while (node) {
+        const size_t before = lengthOf(node->left);
+        if (offset < before) {
+            node = node->left.get();
+            continue;
+        }
+        line += newlinesOf(node->left);
+        offset -= before;
+        const Piece& piece = node->piece;
+        if (offset < piece.length) {
+            return line + countNewlines(piece.text, offset);
+        }
+        line += piece.newlines;
+        offset -= piece.length;
+        node = node->right.get();
+    }
+    return line;
+}
+
+std::string RuneTextSnapshot::line(size_t line) const {
+    const size_t start = lineStart(line);
+    const size_t end = line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+    return text(start, end - start);
+}
+
+std::string RuneTextSnapshot::text(size_t offset, size_t length) const {
+    if (offset > size() || length > size() - offset) {
+        throw std::out_of_range("RuneTextSnapshot::text: range past the end");
+    }
+    std::string result;
+    result.reserve(length);
+    auto append = [&result](const char* text, size_t count) { result.append(text, count); };
+    visitRange(root_, offset, length, append);
+    return result;
+}
+
+std::string RuneTextSnapshot::toString() const {
+    return text(0, size());
+}
+
+RuneTextBuffer::RuneTextBuffer(std::string text)
+    : storage_(std::make_shared<Storage>()) {
+    storage_->original = std::move(text);
+    const std::string& original = storage_->original;
+    current_ = RuneTextSnapshot(buildPieces(original.data(), original.size(), true), storage_);
+}
+
+size_t RuneTextBuffer::pieceCount() const {
+    return piecesOf(current_.root_);
+}
+
+void RuneTextBuffer::insert(size_t offset, const std::string& text) {
+    if (offset > size()) {
+        throw std::out_of_range("RuneTextBuffer::insert: offset " + std::to_string(offset) + " past the end");
+    }
+    if (text.empty()) return;
+
+    NodePtr left, right;
+    split(current_.root_, offset, left, right);
+
+    // Typing appends to the piece the previous keystroke made, as long as
+    // nothing else was appended in between and it stays within bounds
+    const Piece* last = lastPiece(left);
+    Storage& storage = *storage_;
+    if (last && storage.used > 0 && last->text + last->length == storage.blocks.back().get() + storage.used &&
+        last->length + text.size() <= kMaxPiece && storage.used + text.size() <= kBlockSize) {
+        const Piece extended{last->text, last->length + text.size(),
+                             last->newlines + countNewlines(text.data(), text.size())};
+        append(text.data(), text.size());
+        left = replaceLast(left, extended);
+    } else {
+        left = merge(left, buildPieces(text.data(), text.size(), false));
+    }
+    current_.root_ = merge(left, right);
+}
+
+void RuneTextBuffer::erase(size_t offset, size_t length) {
+    if (offset > size() || length > size() - offset) {
+        throw std::out_of_range("RuneTextBuffer::erase: range past the end");
+    }
+    if (length == 0) return;
+
+    NodePtr left, rest, erased, right;
+    split(current_.root_, offset, left, rest);
+    split(rest, length, erased, right);
+    current_.root_ = merge(left, right);
+}
+
+uint32_t RuneTextBuffer::nextPriority() {
+    // xorshift32
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+}
+
+const char* RuneTextBuffer::append(const char* text, size_t length) {
+    Storage& storage = *storage_;
+    if (storage.blocks.empty() || storage.used + length > kBlockSize) {
+        storage.blocks.push_back(std::make_unique<char[]>(kBlockSize));
+        storage.used = 0;
+    }
+    char* destination = storage.blocks.back().get() + storage.used;
+    std::memcpy(destination, text, length);
+    storage.used += length;
+    return destination;
+}
+
+NodePtr RuneTextBuffer::buildPieces(const char* text, size_t length, bool stored) {
+    NodePtr result;
+    for (size_t offset = 0; offset < length; offset += kMaxPiece) {
+        const size_t count = std::min(kMaxPiece, length - offset);
+        const char* pieceText = stored ? text + offset : append(text + offset, count);
+        result = merge(result, makeNode(makePiece(pieceText, count), nextPriority(), nullptr, nullptr));
+    }
+    return result;
+}
+
+} // namespace RuneLang
@@ -0,0 +1,87 @@
+#include "../include/RuneViewport.hpp"
+#include <algorithm>
+#include <string_view>
+
+namespace RuneLang {
+
+namespace {
+
+// Calls `visit(line, text)` for every '\n'-terminated line of `text` and
+// for a final unterminated one, numbering them from `firstLine`
+template <typename Visit>
+void forEachLine(std::string_view text, size_t firstLine, Visit&& visit) {
+    size_t pos = 0;
+    size_t line = firstLine;
+    while (pos <= text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        visit(line++, text.substr(pos, end - pos));
+        pos = end + 1;
+    }
+}
+
+} // namespace
+
+RuneViewport::RuneViewport()
+    : checkpoints_{LexState::Code} {}
+
+std::vector<StyledLine> RuneViewport::render(const RuneTextSnapshot& text, size_t first, size_t count) {
+    std::vector<StyledLine> styled;
+    const size_t lines = text.lineCount();
+    if (first >= lines || count == 0) return styled;
+    count = std::min(count, lines - first);
+
+    const size_t checkpoint = first / kCheckpointInterval;
+    extendTo(text, checkpoint);
+
+    // One read from the checkpoint to the end of the viewport
+    const size_t from = checkpoint * kCheckpointInterval;
+    const size_t last = first + count - 1;
+    const size_t start = text.lineStart(from);
+    const size_t end = last + 1 < lines ? text.lineStart(last + 1) - 1 : text.size();
+    const std::string contents = text.text(start, end - start);
+
+    styled.reserve(count);
+    LexState state = checkpoints_[checkpoint];
+    forEachLine(contents, from, [&](size_t line, std::string_view lineText) {
+        if (line < first) {
+            state = lexLine(lineText, state);
+        } else {
+            StyledLine& out = styled.emplace_back();
+            out.text = lineText;
+            state = lexLine(lineText, state, &out.spans);
+        }
+        // Scrolling down finds the next checkpoints for free
+        if ((line + 1) % kCheckpointInterval == 0 && checkpoints_.size() == (line + 1) / kCheckpointInterval) {
+            checkpoints_.push_back(state);
+        }
+    });
+    return styled;
+}
+
+bool RuneViewport::advance(const RuneTextSnapshot& text, size_t lines) {
+    const size_t total = (text.lineCount() - 1) / kCheckpointInterval + 1;
+    const size_t target = checkpoints_.size() - 1 + std::max<size_t>(lines / kCheckpointInterval, 1);
+    extendTo(text, std::min(target, total - 1));
+    return checkpoints_.size() < total;
+}
+
+void RuneViewport::invalidateFrom(size_t line) {
+    // The checkpoint at or before `line` only depends on text above it
+    checkpoints_.resize(std::min(checkpoints_.size(), line / kCheckpointInterval + 1));
+}
+
+void RuneViewport::extendTo(const RuneTextSnapshot& text, size_t checkpoint) {
+    while (checkpoints_.size() <= checkpoint) {
+        const size_t from = (checkpoints_.size() - 1) * kCheckpointInterval;
+        const size_t start = text.lineStart(from);
+        const size_t end = text.lineStart(from + kCheckpointInterval) - 1;
+        LexState state = checkpoints_.back();
+        forEachLine(text.text(start, end - start), from, [&state](size_t, std::string_view lineText) {
+            state = lexLine(lineText, state);
+        });
+        checkpoints_.push_back(state);
+    }
+}
+
+} // namespace RuneLang
@@ -0,0 +1,525 @@
+#include <cassert>
+#include "RuneBrackets.hpp"
+#include "RuneCompletion.hpp"
+#include "RuneDocument.hpp"
+#include "RuneHighlighter.hpp"
+#include "RuneTextBuffer.hpp"
+#include "RuneViewport.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace RuneLang;
+
+namespace {
+
+// Pieces that open and close block comments, also inside strings and
+// line comments where they must not
+const char* const kFragments[] = {
+    "int x = 1;", "/* open", "close */", "// line /*", "\"str /* \"", "'*'", "ᚠ ᛟhiᛟ ", "*/ if",
+    "", "a */ b /* c", "while (x) {", "}", "1.5e3", "/**/",
+};
+
+std::string randomLine(std::mt19937& random) {
+    std::string line;
+    const size_t pieces = random() % 4;
+    for (size_t i = 0; i < pieces; i++) {
+        if (i > 0) line += ' ';
+        line += kFragments[random() % (sizeof(kFragments) / sizeof(kFragments[0]))];
+    }
+    return line;
+}
+
+// Text for an insert: mostly a few typed characters, sometimes a pasted
+// block longer than a piece
+std::string randomText(std::mt19937& random) {
+    const size_t length = random() % 64 == 0 ? RuneTextBuffer::kMaxPiece + random() % 5000 : random() % 12;
+    std::string text;
+    for (size_t i = 0; i < length; i++) text += random() % 5 == 0 ? '\n' : static_cast<char>('a' + random() % 26);
+    return text;
+}
+
+// Compares every line query of `snapshot` with a scan of `expected`
+void checkLines([[maybe_unused]] const RuneTextSnapshot& snapshot, const std::string& expected) {
+    assert(snapshot.size() == expected.size());
+    assert(snapshot.toString() == expected);
+    size_t start = 0;
+    size_t line = 0;
+    for (;; line++) {
+        const size_t end = std::min(expected.find('\n', start), expected.size());
+        assert(snapshot.lineStart(line) == start);
+        assert(snapshot.line(line) == expected.substr(start, end - start));
+        for ([[maybe_unused]] size_t offset : {start, (start + end) / 2, end}) assert(snapshot.lineOf(offset) == line);
+        if (end == expected.size()) break;
+        start = end + 1;
+    }
+    assert(snapshot.lineCount() == line + 1);
+}
+
+[[maybe_unused]] bool sameSpans(const std::vector<HighlightSpan>& a, const std::vector<HighlightSpan>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].start != b[i].start || a[i].length != b[i].length || a[i].kind != b[i].kind) return false;
+    }
+    return true;
+}
+
+std::string joinLines(const std::vector<std::string>& lines) {
+    std::string text;
+    for (size_t i = 0; i < lines.size(); i++) text += (i > 0 ? "\n" : "") + lines[i];
+    return text;
+}
+
+RuneHighlighter::LineSource sourceOf(const std::vector<std::string>& lines) {
+    return [&lines](size_t index) { return lines[index]; };
+}
+
+} // namespace
+
+void testHighlighterUpdate() {
+    std::mt19937 random(21);
+    std::vector<std::string> lines;
+    for (int i = 0; i < 200; i++) lines.push_back(randomLine(random));
+    RuneHighlighter highlighter;
+    highlighter.reset(lines.size(), sourceOf(lines));
+
+    for (int edit = 0; edit < 2000; edit++) {
+        const size_t first = random() % (lines.size() + 1);
+        const size_t removed = std::min<size_t>(random() % 4, lines.size() - first);
+        const size_t inserted = random() % 4;
+        std::vector<LexState> before;
+        for (size_t line = 0; line <= lines.size(); line++) before.push_back(highlighter.stateBefore(line));
+
+        lines.erase(lines.begin() + first, lines.begin() + first + removed);
+        for (size_t i = 0; i < inserted; i++) lines.insert(lines.begin() + first, randomLine(random));
+        const size_t relexed = highlighter.update(first, removed, inserted, sourceOf(lines));
+
+        RuneHighlighter full;
+        full.reset(lines.size(), sourceOf(lines));
+        assert(highlighter.lineCount() == lines.size());
+        for (size_t line = 0; line < lines.size(); line++) {
+            assert(highlighter.stateBefore(line) == full.stateBefore(line));
+            assert(sameSpans(highlighter.highlight(line, lines[line]), full.highlight(line, lines[line])));
+        }
+        // Lines past the re-lexed ones start as they did before the edit
+        assert(relexed >= inserted);
+        for (size_t line = first + relexed + 1; line <= lines.size(); line++) {
+            assert(highlighter.stateBefore(line) == before[line - inserted + removed]);
+        }
+    }
+}
+
+void testTextBuffer() {
+    std::mt19937 random(22);
+    std::string expected = "first line\nsecond line\n\nfourth";
+    RuneTextBuffer buffer(expected);
+    checkLines(buffer.snapshot(), expected);
+
+    // Snapshots taken along the way must keep their text
+    std::vector<std::pair<RuneTextSnapshot, std::string>> history;
+    for (int edit = 0; edit < 3000; edit++) {
+        if (expected.empty() || random() % 3 != 0) {
+            const size_t offset = random() % (expected.size() + 1);
+            const std::string text = randomText(random);
+            buffer.insert(offset, text);
+            expected.insert(offset, text);
+        } else {
+            const size_t offset = random() % expected.size();
+            const size_t length = std::min<size_t>(random() % (random() % 8 == 0 ? 20000 : 16), expected.size() - offset);
+            buffer.erase(offset, length);
+            expected.erase(offset, length);
+        }
+        assert(buffer.size() == expected.size());
+        if (edit % 100 == 0) {
+            checkLines(buffer.snapshot(), expected);
+            history.emplace_back(buffer.snapshot(), expected);
+        }
+    }
+    checkLines(buffer.snapshot(), expected);
+    for (const auto& [snapshot, text] : history) checkLines(snapshot, text);
+
+    // Reads and edits past the end are refused
+    [[maybe_unused]] bool refused = false;
+    try {
+        buffer.insert(expected.size() + 1, "x");
+    } catch (const std::out_of_range&) {
+        refused = true;
+    }
+    assert(refused);
+    refused = false;
+    try {
+        buffer.snapshot().lineStart(buffer.lineCount());
+    } catch (const std::out_of_range&) {
+        refused = true;
+    }
+    assert(refused);
+}
+
+// Renders [first, first + count) and compares it with highlighting the
+// whole of `lines`
+void checkRender(RuneViewport& viewport, const RuneTextSnapshot& text, const std::vector<std::string>& lines,
+                 size_t first, size_t count) {
+    RuneHighlighter full;
+    full.reset(lines.size(), sourceOf(lines));
+    const std::vector<StyledLine> styled = viewport.render(text, first, count);
+    [[maybe_unused]] const size_t expected = first >= lines.size() ? 0 : std::min(count, lines.size() - first);
+    assert(styled.size() == expected);
+    for (size_t i = 0; i < styled.size(); i++) {
+        assert(styled[i].text == lines[first + i]);
+        assert(sameSpans(styled[i].spans, full.highlight(first + i, lines[first + i])));
+    }
+}
+
+void testViewport() {
+    constexpr size_t kInterval = RuneViewport::kCheckpointInterval;
+    std::mt19937 random(23);
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < 5 * kInterval + 17; i++) lines.push_back("int x = " + std::to_string(i) + "; // line");
+    // A block comment open across the first checkpoint
+    lines[kInterval - 3] = "ᚠ ᛟhiᛟ /* opens";
+    lines[kInterval + 4] = "still comment */ int y;";
+    RuneTextBuffer buffer(joinLines(lines));
+
+    // Jumping straight past a checkpoint, and to the end
+    {
+        RuneViewport viewport;
+        checkRender(viewport, buffer.snapshot(), lines, kInterval - 1, 10);
+        checkRender(viewport, buffer.snapshot(), lines, lines.size() - 5, 40);
+        checkRender(viewport, buffer.snapshot(), lines, lines.size(), 10);
+        assert(viewport.checkpointCount() == lines.size() / kInterval + 1);
+    }
+
+    // Checkpoints found ahead of time give the same result
+    {
+        RuneViewport viewport;
+        size_t steps = 0;
+        while (viewport.advance(buffer.snapshot(), kInterval)) steps++;
+        assert(steps > 0 && viewport.checkpointCount() == lines.size() / kInterval + 1);
+        for (int i = 0; i < 20; i++) checkRender(viewport, buffer.snapshot(), lines, random() % lines.size(), 30);
+    }
+
+    // Edits invalidate the checkpoints below them; the rest stay valid
+    RuneViewport viewport;
+    while (viewport.advance(buffer.snapshot(), 4 * kInterval)) {
+    }
+    for (int edit = 0; edit < 200; edit++) {
+        const size_t line = random() % lines.size();
+        const std::string& inserted = random() % 2 ? "/* " : random() % 2 ? " */" : "\nint z;";
+        const size_t column = random() % (lines[line].size() + 1);
+        buffer.insert(buffer.snapshot().lineStart(line) + column, inserted);
+        lines[line].insert(column, inserted);
+        if (inserted[0] == '\n') {
+            lines.insert(lines.begin() + line + 1, lines[line].substr(column + 1));
+            lines[line].erase(column);
+        }
+        viewport.invalidateFrom(line);
+        assert(viewport.checkpointCount() <= line / kInterval + 1);
+        checkRender(viewport, buffer.snapshot(), lines, random() % lines.size(), 50);
+    }
+}
+
+// Every bracket outside strings and comments, in document order, matched
+// with a stack. As in the index, kinds are not compared.
+struct ReferenceBrackets {
+    std::vector<BracketPosition> brackets;
+    std::map<std::pair<size_t, size_t>, size_t> partner; // Position to index
+    std::optional<BracketPosition> firstUnmatched;
+
+    explicit ReferenceBrackets(const std::vector<std::string>& lines) {
+        RuneHighlighter highlighter;
+        highlighter.reset(lines.size(), sourceOf(lines));
+        for (size_t line = 0; line < lines.size(); line++) {
+            const std::string& text = lines[line];
+            const std::vector<HighlightSpan> spans = highlighter.highlight(line, text);
+            auto hidden = [&spans](size_t column) {
+                for (const HighlightSpan& span : spans) {
+                    if ((span.kind == TokenKind::String || span.kind == TokenKind::Comment) &&
+                        column >= span.start && column < span.start + span.length) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+            for (size_t column = 0; column < text.size(); column++) {
+                if (hidden(column)) continue;
+                const std::string_view rest(text.data() + column, text.size() - column);
+                const size_t kind = std::string_view("{}()[]").find(text[column]);
+                if (kind != std::string_view::npos) {
+                    brackets.push_back({line, column, static_cast<BracketKind>(kind / 2), kind % 2 == 0});
+                } else if (rest.substr(0, 3) == "ᛒ" || rest.substr(0, 3) == "ᛘ") {
+                    brackets.push_back({line, column, BracketKind::RuneBlock, rest.substr(0, 3) == "ᛒ"});
+                }
+            }
+        }
+
+        std::vector<size_t> open;
+        for (size_t i = 0; i < brackets.size(); i++) {
+            if (brackets[i].open) {
+                open.push_back(i);
+            } else if (open.empty()) {
+                if (!firstUnmatched) firstUnmatched = brackets[i];
+            } else {
+                partner[{brackets[i].line, brackets[i].column}] = open.back();
+                partner[{brackets[open.back()].line, brackets[open.back()].column}] = i;
+                open.pop_back();
+            }
+        }
+        if (!firstUnmatched && !open.empty()) firstUnmatched = brackets[open.front()];
+    }
+};
+
+bool samePosition(const std::optional<BracketPosition>& a, const std::optional<BracketPosition>& b) {
+    if (!a || !b) return !a && !b;
+    return a->line == b->line && a->column == b->column && a->kind == b->kind && a->open == b->open;
+}
+
+void testBrackets() {
+    // Brackets in code, strings and comments, and comments that hide the
+    // brackets of later lines
+    const char* const fragments[] = {"{", "}", "(", ")", "[", "]", "ᛒ", "ᛘ", "x", "\"(\"", "// )", "/* { */",
+                                     "/* [", "] */", "'}'", "f(a[0])"};
+    std::mt19937 random(24);
+    auto randomBracketLine = [&]() {
+        std::string line;
+        for (size_t i = random() % 5; i > 0; i--) line += fragments[random() % (sizeof(fragments) / sizeof(fragments[0]))];
+        return line;
+    };
+
+    std::vector<std::string> lines;
+    for (int i = 0; i < 120; i++) lines.push_back(randomBracketLine());
+    RuneHighlighter highlighter;
+    highlighter.reset(lines.size(), sourceOf(lines));
+    RuneBracketIndex index;
+    index.reset(highlighter, sourceOf(lines));
+
+    for (int edit = 0; edit < 600; edit++) {
+        const size_t first = random() % (lines.size() + 1);
+        const size_t removed = std::min<size_t>(random() % 3, lines.size() - first);
+        const size_t inserted = random() % 3;
+        lines.erase(lines.begin() + first, lines.begin() + first + removed);
+        for (size_t i = 0; i < inserted; i++) lines.insert(lines.begin() + first, randomBracketLine());
+        highlighter.update(first, removed, inserted, sourceOf(lines));
+        index.update(first, removed, inserted, highlighter, sourceOf(lines));
+
+        const ReferenceBrackets reference(lines);
+        assert(index.lineCount() == lines.size());
+        assert(samePosition(index.firstUnmatched(), reference.firstUnmatched));
+        for (const BracketPosition& bracket : reference.brackets) {
+            const auto found = reference.partner.find({bracket.line, bracket.column});
+            [[maybe_unused]] const std::optional<BracketPosition> expected =
+                found == reference.partner.end() ? std::nullopt
+                                                 : std::optional<BracketPosition>(reference.brackets[found->second]);
+            assert(samePosition(index.matching(bracket.line, bracket.column), expected));
+        }
+    }
+    // Nothing matches where there is no bracket
+    lines = {"int x;"};
+    highlighter.reset(lines.size(), sourceOf(lines));
+    index.reset(highlighter, sourceOf(lines));
+    assert(!index.matching(0, 0) && !index.matching(5, 0) && !index.firstUnmatched());
+}
+
+void testDocument() {
+    const char* const pieces[] = {"\n", "ᛒ", "ᛘ", "(", ")", "{ x; }", "/* ", " */", "\"(\"", "// ]", "ᚠ 1;"};
+    std::mt19937 random(24);
+    std::string expected;
+    for (int i = 0; i < 60; i++) expected += randomLine(random) + "\n";
+    RuneDocument document(expected);
+
+    // Runes are not split, or the reference would lex different bytes
+    auto boundary = [&](size_t offset) {
+        while (offset > 0 && offset < expected.size() && (static_cast<unsigned char>(expected[offset]) & 0xC0) == 0x80) {
+            offset--;
+        }
+        return offset;
+    };
+    for (int step = 0; step < 500; step++) {
+        const size_t offset = boundary(random() % (expected.size() + 1));
+        const size_t length = random() % 3 == 0 ? boundary(std::min(expected.size(), offset + random() % 40)) - offset : 0;
+        std::string inserted;
+        for (size_t i = random() % 3; i > 0; i--) inserted += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+
+        const RuneTextSnapshot before = document.text().snapshot();
+        const EditedLines edited = document.edit(offset, length, inserted);
+        expected.replace(offset, length, inserted);
+        const RuneTextSnapshot& after = document.text().snapshot();
+        assert(after.toString() == expected);
+
+        // Lines outside the reported range are the same text as before
+        for (size_t i = 0; i < edited.first; i++) assert(before.line(i) == after.line(i));
+        assert(before.lineCount() - edited.removed == after.lineCount() - edited.inserted);
+        for (size_t i = edited.first + edited.removed; i < before.lineCount(); i++) {
+            assert(before.line(i) == after.line(i - edited.removed + edited.inserted));
+        }
+
+        // Kept up to date, the document checks as one built from scratch
+        const RuneDocument fresh(expected);
+        assert(document.semicolons() == static_cast<size_t>(std::count(expected.begin(), expected.end(), ';')));
+        assert(document.highlighter().lineCount() == fresh.highlighter().lineCount());
+        for (size_t line = 0; line < after.lineCount(); line++) {
+            assert(document.highlighter().stateBefore(line) == fresh.highlighter().stateBefore(line));
+        }
+        assert(samePosition(document.brackets().firstUnmatched(), fresh.brackets().firstUnmatched()));
+    }
+    [[maybe_unused]] bool threw = false;
+    try {
+        document.edit(expected.size(), 1, "");
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw && document.text().snapshot().toString() == expected);
+}
+
+// Identifiers built from a few parts, so that many share prefixes and
+// fuzzy queries have word starts to land on
+std::string randomIdentifier(std::mt19937& random) {
+    const char* const parts[] = {"get", "set", "buf", "Buffer", "line", "_count", "Text", "x", "run", "Rune", "s"};
+    std::string word;
+    for (size_t i = random() % 3 + 1; i > 0; i--) word += parts[random() % (sizeof(parts) / sizeof(parts[0]))];
+    return word;
+}
+
+// Prefix results of `query` against every live word with that prefix
+// sorted by count; words of equal count may come in any order
+void checkPrefix(const RuneCompletionIndex& index, const std::map<std::string, uint32_t>& reference,
+                 const std::string& query, size_t limit) {
+    std::vector<uint32_t> expected;
+    for (auto it = reference.lower_bound(query); it != reference.end() && it->first.compare(0, query.size(), query) == 0;
+         ++it) {
+        if (it->second > 0) expected.push_back(it->second);
+    }
+    std::sort(expected.rbegin(), expected.rend());
+    expected.resize(std::min(expected.size(), limit));
+
+    std::set<std::string_view> seen;
+    size_t count = 0;
+    for (const Completion& completion : index.complete(query, limit)) {
+        if (!completion.prefix) break;
+        assert(count < expected.size());
+        assert(completion.text.compare(0, query.size(), query) == 0);
+        assert(completion.score == static_cast<int>(expected[count]));
+        assert(completion.score == static_cast<int>(reference.at(std::string(completion.text))));
+        assert(seen.insert(completion.text).second);
+        count++;
+    }
+    assert(count == expected.size());
+}
+
+// A small limit keeps the first results of an unbounded one; of results
+// that tie with the last one kept, any may be chosen
+void checkLimit(const RuneCompletionIndex& index, const std::string& query, size_t limit, size_t unbounded) {
+    const std::vector<Completion> all = index.complete(query, unbounded);
+    const std::vector<Completion> some = index.complete(query, limit);
+    assert(some.size() == std::min(limit, all.size()));
+    if (some.empty()) return;
+    auto rank = [](const Completion& completion) {
+        // Fuzzy matches of equal score list the shorter name first
+        const int length = completion.prefix ? 0 : -static_cast<int>(completion.text.size());
+        return std::tuple(completion.prefix, completion.score, length);
+    };
+    std::set<std::string_view> kept;
+    for (size_t i = 0; i < some.size(); i++) {
+        assert(rank(some[i]) == rank(all[i]));
+        kept.insert(some[i].text);
+    }
+    for (size_t i = 0; i < some.size(); i++) {
+        if (rank(all[i]) != rank(some.back())) assert(kept.count(all[i].text));
+    }
+}
+
+void testCompletion() {
+    RuneCompletionIndex index;
+    index.addIdentifiers("getBuffer get_buffer gutter getBuffer");
+    const std::vector<Completion> found = index.complete("gb", 10);
+    assert(found.size() == 2 && !found[0].prefix && !found[1].prefix);
+    assert(std::set<std::string_view>({found[0].text, found[1].text}) ==
+           std::set<std::string_view>({"getBuffer", "get_buffer"}));
+    assert(index.complete("get", 1).size() == 1 && index.complete("get", 1)[0].text == "getBuffer");
+
+    std::mt19937 random(25);
+    index = RuneCompletionIndex();
+    std::map<std::string, uint32_t> reference;
+    size_t live = 0;
+    for (int step = 0; step < 4000; step++) {
+        if (reference.empty() || random() % 3 != 0) {
+            const std::string word = randomIdentifier(random);
+            const uint32_t uses = random() % 8 + 1;
+            if (reference[word] == 0) live++;
+            reference[word] += uses;
+            index.add(word, uses);
+        } else {
+            // Often all of a word's uses, which most changes the bests above it
+            auto it = std::next(reference.begin(), random() % reference.size());
+            if (it->second == 0) continue;
+            const uint32_t uses = random() % 2 ? it->second : random() % it->second + 1;
+            it->second -= uses;
+            if (it->second == 0) live--;
+            index.remove(it->first, uses);
+        }
+        assert(index.size() == live);
+        if (step % 100 != 99) continue;
+
+        // Every trie node's best, at every prefix of every word
+        for (const auto& [word, uses] : reference) {
+            assert(index.uses(word) == uses);
+            for (size_t length = 0; length <= word.size(); length++) {
+                const std::string prefix = word.substr(0, length);
+                uint32_t best = 0;
+                for (auto it = reference.lower_bound(prefix);
+                     it != reference.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+                    best = std::max(best, it->second);
+                }
+                assert(index.bestUse(prefix) == best);
+            }
+        }
+        assert(index.bestUse("q") == 0);
+
+        for (int query = 0; query < 50; query++) {
+            const std::string& word = std::next(reference.begin(), random() % reference.size())->first;
+            checkPrefix(index, reference, word.substr(0, random() % (word.size() + 1)), random() % 12 + 1);
+            // An abbreviation of the word, lowercased now and then
+            std::string abbreviation(1, word[0]);
+            for (size_t i = 1; i < word.size(); i++) {
+                if (random() % 3 == 0) abbreviation += random() % 2 ? word[i] : static_cast<char>(std::tolower(word[i]));
+            }
+            for (size_t limit = 1; limit <= 8; limit++) checkLimit(index, abbreviation, limit, reference.size() + 1);
+        }
+    }
+}
+
+int main() {
+    std::cout << "Running Rune editor tests..." << std::endl;
+    try {
+        testHighlighterUpdate();
+        std::cout << "Highlighter update test passed" << std::endl;
+
+        testTextBuffer();
+        std::cout << "Text buffer test passed" << std::endl;
+
+        testViewport();
+        std::cout << "Viewport test passed" << std::endl;
+
+        testBrackets();
+        std::cout << "Bracket index test passed" << std::endl;
+
+        testDocument();
+        std::cout << "Document test passed" << std::endl;
+
+        testCompletion();
+        std::cout << "Completion index test passed" << std::endl;
+
+        std::cout << "All tests passed!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,311 @@
+// Parser throughput suite. Generates deterministic synthetic corpora from
+// 1 KB up to 1 GB, runs them through parseRuneCode and compileToCpp and
+// writes the timings as JSON, so runs can be diffed to spot regressions.
+// compileToCpp leaves a file that already holds its output alone, so every
+// run after the first times parsing plus a compare, not a write.
+//
+//   rune_bench [--max-size SIZE] [--corpus NAME] [--warmup N]
+//              [--repetitions N] [--output FILE]
+//
+// SIZE takes K, M and G suffixes and defaults to 64M. The 1G inputs need
+// several gigabytes of memory for the token stream.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "RuneParser.hpp"
+
+using namespace RuneLang;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kSeed = 0x52554e45; // "RUNE"
+
+// splitmix64: the same corpus on every platform and standard library
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+
+    template <size_t N>
+    const char* pick(const char* const (&items)[N]) { return items[below(N)]; }
+
+private:
+    uint64_t state_;
+};
+
+const char* const kNames[] = {"total", "count", "blockSize", "memBlock", "index", "offset",
+                              "limit", "value", "result", "buffer", "left", "right"};
+const char* const kWords[] = {"rune", "stone", "ghost", "kernel", "memory", "process",
+                              "thread", "file", "system", "carved", "ancient", "signal"};
+const char* const kOperators[] = {"ᚢ", "ᚦ", "ᚹ", "ᚺ", "ᚻ", "ᚼ", "ᚽ", "ᚾ", "ᚿ", "ᛀ", "ᛇ", "ᛋ"};
+const char* const kTypes[] = {"ᛚ", "ᛦ", "ᛙ", "ᛠ", "ᛡ", "ᛝ"};
+
+void appendOperand(std::string& out, Random& random) {
+    if (random.below(3) == 0) {
+        out += std::to_string(random.below(4096));
+    } else {
+        out += random.pick(kNames);
+    }
+}
+
+void appendWords(std::string& out, Random& random, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (i) out += ' ';
+        out += random.pick(kWords);
+    }
+}
+
+// Expressions where nearly every other token is an operator rune
+void operatorsUnit(std::string& out, Random& random) {
+    out += random.pick(kTypes);
+    out += ' ';
+    out += random.pick(kNames);
+    out += " ᛃ ";
+    const size_t terms = 4 + random.below(8);
+    for (size_t i = 0; i < terms; i++) {
+        appendOperand(out, random);
+        out += ' ';
+        out += random.pick(kOperators);
+        out += ' ';
+    }
+    appendOperand(out, random);
+    out += "\nᚷ(";
+    appendOperand(out, random);
+    out += " ᛇ ";
+    appendOperand(out, random);
+    out += ") ᛏ ";
+    appendOperand(out, random);
+    out += '\n';
+}
+
+// Output statements made mostly of ᛟ and quoted literals
+void stringsUnit(std::string& out, Random& random) {
+    out += "ᚠ ᛟ";
+    appendWords(out, random, 4 + random.below(12));
+    out += "ᛟ ";
+    appendOperand(out, random);
+    out += " \"";
+    appendWords(out, random, 2 + random.below(8));
+    out += "\\n\"\n";
+}
+
+// Long ᛞ comments with the occasional statement in between
+void commentsUnit(std::string& out, Random& random) {
+    const size_t lines = 2 + random.below(4);
+    for (size_t i = 0; i < lines; i++) {
+        out += "ᛞ ";
+        appendWords(out, random, 6 + random.below(14));
+        out += '\n';
+    }
+    out += "ᚠ ";
+    out += random.pick(kNames);
+    out += '\n';
+}
+
+// A function whose body nests ᛒ…ᛘ blocks up to 256 levels deep
+void nestedUnit(std::string& out, Random& random) {
+    const size_t depth = 16 + random.below(241);
+    out += "ᛤ ";
+    out += random.pick(kNames);
+    out += std::to_string(random.below(1000000));
+    out += ' ';
+    for (size_t i = 0; i < depth; i++) {
+        out += std::string(i % 8, ' ');
+        out += "ᛒ ᚷ(";
+        out += random.pick(kNames);
+        out += ")\n";
+    }
+    for (size_t i = depth; i-- > 0;) {
+        out += std::string(i % 8, ' ');
+        out += "ᛘ\n";
+    }
+}
+
+struct Corpus {
+    const char* name;
+    void (*unit)(std::string& out, Random& random);
+};
+
+const Corpus kCorpora[] = {
+    {"operators", operatorsUnit},
+    {"strings", stringsUnit},
+    {"comments", commentsUnit},
+    {"nested", nestedUnit},
+};
+
+// Whole units until the target size is reached; every size starts from the
+// same seed, so small corpora are prefixes of large ones
+std::string generate(const Corpus& corpus, size_t targetBytes) {
+    Random random(kSeed);
+    std::string out;
+    out.reserve(targetBytes + 64 * 1024);
+    while (out.size() < targetBytes) corpus.unit(out, random);
+    return out;
+}
+
+struct Result {
+    std::string corpus;
+    const char* operation;
+    size_t bytes;
+    size_t outputBytes;
+    int repetitions;
+    std::vector<double> seconds; // Sorted ascending
+
+    double percentile(double fraction) const {
+        const size_t rank = static_cast<size_t>(fraction * seconds.size() + 0.999999);
+        return seconds[std::min(seconds.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+};
+
+template <typename F>
+Result measure(const std::string& corpus, const char* operation, size_t bytes,
+               int warmup, int repetitions, F&& body) {
+    Result result{corpus, operation, bytes, 0, repetitions, {}};
+    for (int i = 0; i < warmup; i++) result.outputBytes = body();
+    for (int i = 0; i < repetitions; i++) {
+        const Clock::time_point start = Clock::now();
+        result.outputBytes = body();
+        result.seconds.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::sort(result.seconds.begin(), result.seconds.end());
+    return result;
+}
+
+bool parseSize(const char* text, size_t& size) {
+    char* end = nullptr;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+    size_t scale = 1;
+    if (*end == 'K' || *end == 'k') scale = 1ull << 10;
+    if (*end == 'M' || *end == 'm') scale = 1ull << 20;
+    if (*end == 'G' || *end == 'g') scale = 1ull << 30;
+    if (end == text || (scale != 1 && end[1] != '\0') || (scale == 1 && *end != '\0')) return false;
+    size = static_cast<size_t>(value) * scale;
+    return true;
+}
+
+std::string sizeLabel(size_t bytes) {
+    if (bytes >= (1u << 30)) return std::to_string(bytes >> 30) + "G";
+    if (bytes >= (1u << 20)) return std::to_string(bytes >> 20) + "M";
+    return std::to_string(bytes >> 10) + "K";
+}
+
+void writeJson(FILE* out, const std::vector<Result>& results) {
+    std::fprintf(out, "{\n  \"benchmark\": \"rune_bench\",\n  \"seed\": %llu,\n  \"results\": [\n",
+                 static_cast<unsigned long long>(kSeed));
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        const double median = r.percentile(0.5);
+        std::fprintf(out,
+                     "    {\"corpus\": \"%s\", \"operation\": \"%s\", \"bytes\": %zu, "
+                     "\"output_bytes\": %zu, \"repetitions\": %d, \"min_ns\": %.0f, "
+                     "\"median_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %.0f, "
+                     "\"bytes_per_second\": %.0f}%s\n",
+                     r.corpus.c_str(), r.operation, r.bytes, r.outputBytes, r.repetitions,
+                     r.seconds.front() * 1e9, median * 1e9, r.percentile(0.99) * 1e9,
+                     r.seconds.back() * 1e9, median > 0 ? r.bytes / median : 0.0,
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: rune_bench [--max-size SIZE] [--corpus NAME] [--warmup N]"
+                         " [--repetitions N] [--output FILE]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t maxSize = 64u << 20;
+    const char* only = nullptr;
+    const char* outputPath = nullptr;
+    int warmup = 2;
+    int repetitions = 10;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            if (!parseSize(argv[++i], maxSize)) return usage();
+        } else if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+
+    char directory[] = "/tmp/rune_bench.XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string translationUnit = std::string(directory) + "/output.cpp";
+
+    std::vector<Result> results;
+    RuneParser parser;
+    std::fprintf(stderr, "%-10s %5s  %-12s %10s %10s %9s\n", "corpus", "size", "operation",
+                 "median ms", "p99 ms", "MB/s");
+    for (const Corpus& corpus : kCorpora) {
+        if (only && std::strcmp(only, corpus.name) != 0) continue;
+        // 1 KB to 1 GB in steps of 16
+        for (size_t size = 1u << 10; size <= maxSize && size <= (1u << 30); size <<= 4) {
+            const std::string source = generate(corpus, size);
+            // Big inputs take seconds per run; a few runs are enough there
+            const int runs = size >= (64u << 20) ? std::min(repetitions, 3) : repetitions;
+            const int warm = size >= (64u << 20) ? std::min(warmup, 1) : warmup;
+
+            std::string cppCode;
+            const Result parsed = measure(corpus.name, "parseRuneCode", source.size(), warm, runs, [&] {
+                cppCode.clear();
+                StringSink sink(cppCode, StringSink::estimateFor(source.size()));
+                parser.parseRuneCode(source, sink);
+                sink.flush();
+                return cppCode.size();
+            });
+            cppCode = std::string();
+            // Writes output.cpp once; later runs only compare against it
+            const Result compiled = measure(corpus.name, "compileToCpp", source.size(), warm, runs, [&] {
+                return parser.compileToCpp(source, translationUnit).size();
+            });
+
+            for (const Result* r : {&parsed, &compiled}) {
+                const double median = r->percentile(0.5);
+                std::fprintf(stderr, "%-10s %5s  %-12s %10.3f %10.3f %9.1f\n", corpus.name,
+                             sizeLabel(size).c_str(), r->operation, median * 1e3,
+                             r->percentile(0.99) * 1e3, r->bytes / median / (1 << 20));
+                results.push_back(*r);
+            }
+        }
+    }
+    unlink(translationUnit.c_str());
+    rmdir(directory);
+
+    FILE* out = outputPath ? std::fopen(outputPath, "w") : stdout;
+    if (!out) {
+        std::perror(outputPath);
+        return 1;
+    }
+    writeJson(out, results);
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
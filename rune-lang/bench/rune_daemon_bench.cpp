@@ -0,0 +1,145 @@
+// Latency of one compile request: a cold `rune_lang compile` process
+// against a warm RuneDaemon, reached through the client CLI and through a
+// connection the caller keeps open, with and without a result cache hit.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "RuneDaemon.hpp"
+#include "RuneMappedFile.hpp"
+
+using namespace RuneLang;
+
+extern char** environ;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kProcessRuns = 100;
+constexpr int kRequestRuns = 1000;
+
+struct Latency {
+    double p50;
+    double p99;
+};
+
+Latency summarize(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    return {samples[samples.size() / 2], samples[samples.size() * 99 / 100]};
+}
+
+// Runs a command without a shell in between, its output discarded
+bool spawn(std::vector<std::string> args) {
+    std::vector<char*> argv;
+    for (std::string& arg : args) argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    const int error = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) return false;
+    int status = 0;
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+template <typename F>
+Latency measure(int runs, F&& body) {
+    std::vector<double> samples;
+    samples.reserve(runs);
+    for (int run = 0; run < runs; run++) {
+        const Clock::time_point start = Clock::now();
+        if (!body(run)) {
+            std::fprintf(stderr, "request failed\n");
+            std::exit(1);
+        }
+        samples.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return summarize(samples);
+}
+
+void print(const char* name, Latency latency) {
+    std::printf("%-30s %9.3f %9.3f\n", name, latency.p50 * 1e3, latency.p99 * 1e3);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : RUNE_EXAMPLES_DIR "/system_info.rune";
+    const std::string binary = RUNE_LANG_BINARY;
+
+    char directory[] = "/tmp/rune_daemon_bench.XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string socketPath = std::string(directory) + "/daemon.sock";
+    const std::string source = std::string(RuneMappedFile(path).contents());
+    // Distinct sources, so misses really compile
+    std::vector<std::string> inputs;
+    for (int i = 0; i < kRequestRuns; i++) {
+        inputs.push_back(std::string(directory) + "/input" + std::to_string(i) + ".rune");
+        std::ofstream(inputs.back()) << source << "ᛞ variant " << i << "\n";
+    }
+    const std::string output = std::string(directory) + "/out";
+    const std::string translationUnit = std::string(directory) + "/unit.cpp";
+
+    const Latency cold = measure(kProcessRuns, [&](int run) {
+        return spawn({binary, "compile", "-j", "1", "-o", output, inputs[run]});
+    });
+
+    RuneDaemon daemon(socketPath, 1);
+    std::thread server([&daemon] { daemon.serve(); });
+
+    const Latency cliMiss = measure(kProcessRuns, [&](int run) {
+        return spawn({binary, "client", "--socket", socketPath, "compile", inputs[run], translationUnit});
+    });
+    const Latency cliHit = measure(kProcessRuns, [&](int) {
+        return spawn({binary, "client", "--socket", socketPath, "compile", inputs[0], translationUnit});
+    });
+
+    Latency miss, hit, parseHit;
+    {
+        // Holds the only worker until it is closed
+        RuneDaemonClient client(socketPath);
+        // The CLI runs filled the cache with the first inputs; skip past them
+        miss = measure(kRequestRuns - kProcessRuns, [&](int run) {
+            client.compile(inputs[kProcessRuns + run], translationUnit);
+            return true;
+        });
+        hit = measure(kRequestRuns, [&](int) {
+            client.compile(inputs[0], translationUnit);
+            return true;
+        });
+        parseHit = measure(kRequestRuns, [&](int) { return !client.parse(source).empty(); });
+    }
+    const Latency connectParse = measure(kRequestRuns, [&](int) {
+        RuneDaemonClient once(socketPath);
+        return !once.parse(source).empty();
+    });
+
+    RuneDaemonClient(socketPath).shutdown();
+    server.join();
+    std::system(("rm -rf " + std::string(directory)).c_str());
+
+    std::printf("source: %s (%zu bytes)\n", path.c_str(), source.size());
+    std::printf("request                         p50 ms    p99 ms\n");
+    print("cold rune_lang compile", cold);
+    print("rune_lang client, miss", cliMiss);
+    print("rune_lang client, hit", cliHit);
+    print("open connection, miss", miss);
+    print("open connection, hit", hit);
+    print("open connection, parse hit", parseHit);
+    print("connect + parse hit", connectParse);
+    std::printf("speedup, open connection hit   %9.0fx\n", cold.p50 / hit.p50);
+    return 0;
+}
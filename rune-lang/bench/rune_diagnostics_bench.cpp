@@ -0,0 +1,93 @@
+// Parse throughput on editor-sized documents (100 lines) with one error
+// each, comparing the throwing interface against diagnostics mode.
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "RuneParser.hpp"
+
+using namespace RuneLang;
+
+namespace {
+
+constexpr int kDocuments = 2000;
+constexpr int kLinesPerDocument = 100;
+constexpr int kRuns = 15;
+
+std::string makeDocument(bool withError) {
+    static const char* const lines[] = {
+        "ᛚ total ᛃ 1024 ᚹ 1024 ᛞ one megabyte\n",
+        "ᛤ report ᛒ ᚠ ᛟAvailable: ᛟ ᛨgetAvailableMemory() ᛘ\n",
+        "ᚷ(total ᚢ 1) ᛏ total ᚦ 2\n",
+        "ᛥ Point { ᛚ x ᛚ y }\n",
+    };
+    std::string document;
+    for (int i = 0; i < kLinesPerDocument; i++) {
+        // Last line, so the throwing interface parses as much as diagnostics mode
+        if (withError && i == kLinesPerDocument - 1) {
+            document += "ᚠ total ᚸ value\n"; // ᚸ has no mapping
+        } else {
+            document += lines[i % 4];
+        }
+    }
+    return document;
+}
+
+// Best of kRuns, in MB/s
+template <typename F>
+double throughput(size_t bytes, F&& body) {
+    double best = 0;
+    for (int run = 0; run < kRuns; run++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, bytes / elapsed.count() / (1 << 20));
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    RuneParser parser;
+    std::string out;
+    DiagnosticList diagnostics;
+
+    std::printf("input   mode          MB/s  errors found\n");
+    for (bool withError : {false, true}) {
+        const std::string document = makeDocument(withError);
+        const size_t bytes = document.size() * kDocuments;
+        const char* input = withError ? "1/100" : "clean";
+
+        size_t thrown = 0;
+        double throwing = throughput(bytes, [&] {
+            thrown = 0;
+            for (int i = 0; i < kDocuments; i++) {
+                try {
+                    out.clear();
+                    StringSink sink(out);
+                    parser.parseRuneCode(document, sink);
+                } catch (const RuneParseError&) {
+                    thrown++;
+                }
+            }
+        });
+        std::printf("%-7s %-12s %6.0f  %zu\n", input, "exceptions", throwing, thrown);
+
+        size_t reported = 0;
+        double collected = throughput(bytes, [&] {
+            reported = 0;
+            for (int i = 0; i < kDocuments; i++) {
+                out.clear();
+                diagnostics.clear();
+                {
+                    StringSink sink(out);
+                    parser.parseWithDiagnostics(document, sink, diagnostics);
+                }
+                reported += diagnostics.items().size();
+            }
+        });
+        std::printf("%-7s %-12s %6.0f  %zu\n", input, "diagnostics", collected, reported);
+    }
+    return 0;
+}
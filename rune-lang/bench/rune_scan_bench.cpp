@@ -0,0 +1,96 @@
+// Compares the scalar and vector scanning kernels, on their own and inside
+// the lexer, over comment-, string- and indentation-heavy corpora, then
+// the serial lexer against tokenizeParallel with one worker per core.
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RuneLexer.hpp"
+#include "RuneScan.hpp"
+
+using namespace RuneLang;
+
+namespace {
+
+constexpr size_t kCorpusBytes = 32 << 20;
+constexpr int kRuns = 5;
+
+std::string makeCorpus(const std::string& line) {
+    std::string corpus;
+    corpus.reserve(kCorpusBytes + line.size());
+    while (corpus.size() < kCorpusBytes) corpus += line;
+    return corpus;
+}
+
+// Best of kRuns, in MB/s
+template <typename F>
+double throughput(size_t bytes, F&& body) {
+    double best = 0;
+    for (int run = 0; run < kRuns; run++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, bytes / elapsed.count() / (1 << 20));
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    const std::string comment = "ᛞ " + std::string(100, 'c') + " trailing comment text\nᚠ x\n";
+    const std::string string = "ᚠ ᛟ" + std::string(120, 's') + " ᚢ more string text ᛟ\n";
+    const std::string indent = std::string(48, ' ') + "ᛚ x ᛃ 1\n" + std::string(48, '\t') + "ᚠ x\n";
+    const struct {
+        const char* name;
+        std::string corpus;
+    } corpora[] = {{"comments", makeCorpus(comment)}, {"strings", makeCorpus(string)}, {"indent", makeCorpus(indent)}};
+
+    std::vector<ScanLevel> levels = {ScanLevel::Scalar};
+    if (detectScanLevel() >= ScanLevel::SSE2) levels.push_back(ScanLevel::SSE2);
+    if (detectScanLevel() >= ScanLevel::AVX2) levels.push_back(ScanLevel::AVX2);
+
+    std::cout << "corpus    level   findByte MB/s  lexer MB/s\n";
+    std::vector<Token> tokens;
+    RuneLexer lexer;
+    for (const auto& entry : corpora) {
+        const char* begin = entry.corpus.data();
+        const char* end = begin + entry.corpus.size();
+        for (ScanLevel level : levels) {
+            const ScanKernels& scan = scanKernels(level);
+            size_t lines = 0;
+            double kernel = throughput(entry.corpus.size(), [&] {
+                lines = 0;
+                for (const char* p = begin; (p = scan.findByte(p, end, '\n')) < end; p++) lines++;
+            });
+
+            setScanLevel(level);
+            double lex = throughput(entry.corpus.size(), [&] {
+                tokens.clear();
+                lexer.tokenize(entry.corpus, tokens);
+            });
+
+            std::printf("%-9s %-7s %13.0f %11.0f   (%zu lines, %zu tokens)\n", entry.name,
+                        scanLevelName(level), kernel, lex, lines, tokens.size());
+        }
+    }
+
+    setScanLevel(detectScanLevel());
+    const unsigned workers = std::max(2u, std::thread::hardware_concurrency());
+    std::cout << "\ncorpus    serial MB/s  parallel MB/s  (" << workers << " workers)\n";
+    for (const auto& entry : corpora) {
+        double serial = throughput(entry.corpus.size(), [&] {
+            tokens.clear();
+            lexer.tokenize(entry.corpus, tokens);
+        });
+        double parallel = throughput(entry.corpus.size(), [&] {
+            tokens.clear();
+            lexer.tokenizeParallel(entry.corpus, tokens, workers);
+        });
+        std::printf("%-9s %11.0f %14.0f\n", entry.name, serial, parallel);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Time from "run this script" to its first byte of output: the bytecode VM
+// against translating to C++ and building with the system compiler.
+//
+// The C++ side is a lower bound. Translated scripts with top-level
+// statements are not valid C++ on their own, so the compiler is timed on a
+// one-line <iostream> program, which is the least any translated script
+// costs to build and start.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "RuneMappedFile.hpp"
+#include "RuneParser.hpp"
+#include "RuneVM.hpp"
+
+using namespace RuneLang;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kVMRuns = 200;
+constexpr int kCompilerRuns = 5;
+
+// Remembers when the first output reached it
+class TimingSink : public OutputSink {
+public:
+    Clock::time_point first;
+    bool seen = false;
+
+protected:
+    void drain(const char*, size_t) override {
+        if (!seen) {
+            first = Clock::now();
+            seen = true;
+        }
+    }
+};
+
+double median(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+double seconds(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : RUNE_EXAMPLES_DIR "/system_info.rune";
+    const char* compiler = std::getenv("CXX") ? std::getenv("CXX") : "c++";
+
+    std::vector<double> firstOutput;
+    std::vector<double> total;
+    std::vector<double> compile;
+    for (int run = 0; run < kVMRuns; run++) {
+        const Clock::time_point start = Clock::now();
+        RuneMappedFile file(path);
+        const Script script = compileScript(file.contents());
+        const Clock::time_point compiled = Clock::now();
+        TimingSink out;
+        RuneVM vm(out);
+        vm.run(script);
+        const Clock::time_point end = Clock::now();
+        compile.push_back(seconds(start, compiled));
+        firstOutput.push_back(seconds(start, out.seen ? out.first : end));
+        total.push_back(seconds(start, end));
+    }
+
+    char directory[] = "/tmp/rune_vm_bench.XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string translated = std::string(directory) + "/script.cpp";
+    const std::string program = std::string(directory) + "/hello.cpp";
+    const std::string binary = std::string(directory) + "/hello";
+    if (FILE* f = std::fopen(program.c_str(), "w")) {
+        std::fputs("#include <iostream>\nint main() { std::cout << \"=== System ===\\n\"; }\n", f);
+        std::fclose(f);
+    }
+    const std::string build = std::string(compiler) + " -O0 -o " + binary + " " + program;
+
+    std::vector<double> translate;
+    std::vector<double> cppFirstOutput;
+    for (int run = 0; run < kCompilerRuns; run++) {
+        const Clock::time_point start = Clock::now();
+        RuneMappedFile file(path);
+        RuneParser parser;
+        parser.compileToCpp(std::string(file.contents()), translated);
+        const Clock::time_point translatedAt = Clock::now();
+        if (std::system(build.c_str()) != 0 || std::system((binary + " > /dev/null").c_str()) != 0) {
+            std::fprintf(stderr, "failed to run %s\n", build.c_str());
+            return 1;
+        }
+        translate.push_back(seconds(start, translatedAt));
+        cppFirstOutput.push_back(seconds(start, Clock::now()));
+    }
+    unlink(translated.c_str());
+    unlink(program.c_str());
+    unlink(binary.c_str());
+    rmdir(directory);
+
+    std::printf("script: %s\n", path.c_str());
+    std::printf("path                      median ms\n");
+    std::printf("vm: parse + compile       %9.3f\n", median(compile) * 1e3);
+    std::printf("vm: first output          %9.3f\n", median(firstOutput) * 1e3);
+    std::printf("vm: whole run             %9.3f\n", median(total) * 1e3);
+    std::printf("c++: translate            %9.3f\n", median(translate) * 1e3);
+    std::printf("c++: first output (>=)    %9.3f  (%s)\n", median(cppFirstOutput) * 1e3, compiler);
+    std::printf("speedup                   %9.0fx\n", median(cppFirstOutput) / median(firstOutput));
+    return 0;
+}
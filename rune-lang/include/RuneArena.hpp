@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace RuneLang {
+
+// Bump allocator owned by a single parse. Objects are never freed
+// individually; every block is released at once when the arena dies
+// or is reset. Only trivially destructible types may live here.
+class RuneArena {
+public:
+    explicit RuneArena(size_t initialBlockSize = kDefaultBlockSize)
+        : nextBlockSize_(initialBlockSize < kMinBlockSize ? kMinBlockSize : initialBlockSize) {}
+
+    RuneArena(const RuneArena&) = delete;
+    RuneArena& operator=(const RuneArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        size_t offset = (used_ + alignment - 1) & ~(alignment - 1);
+        if (blocks_.empty() || offset + size > capacity_) {
+            addBlock(size + alignment);
+            offset = (used_ + alignment - 1) & ~(alignment - 1);
+        }
+        used_ = offset + size;
+        return blocks_.back().get() + offset;
+    }
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copies `text` into the arena and returns a view of the copy
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) return std::string_view();
+        char* data = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return std::string_view(data, text.size());
+    }
+
+    // Sizes the first block so that `bytes` fit without further blocks.
+    // Has no effect once memory has been handed out.
+    void reserve(size_t bytes) {
+        if (blocks_.empty() && bytes > nextBlockSize_) nextBlockSize_ = bytes;
+    }
+
+    // Drops everything but the most recent block, which is kept for reuse
+    void reset() {
+        if (blocks_.size() > 1) {
+            std::unique_ptr<char[]> last = std::move(blocks_.back());
+            blocks_.clear();
+            blocks_.push_back(std::move(last));
+        }
+        used_ = 0;
+    }
+
+    size_t blockCount() const { return blocks_.size(); }
+
+private:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+    static constexpr size_t kMinBlockSize = 4 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    size_t nextBlockSize_;
+
+    void addBlock(size_t minimum) {
+        size_t size = nextBlockSize_;
+        while (size < minimum) size *= 2;
+        blocks_.emplace_back(new char[size]);
+        capacity_ = size;
+        used_ = 0;
+        // Grow geometrically so the block count stays logarithmic
+        nextBlockSize_ = size * 2;
+    }
+};
+
+} // namespace RuneLang
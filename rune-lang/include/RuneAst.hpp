@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "RuneSymbols.hpp"
+
+namespace RuneLang {
+
+// Node types of the Rune syntax tree. Nodes are allocated from the
+// RuneArena of the parse that created them, so they hold only views
+// and pointers and are never destroyed individually.
+enum class NodeKind : uint8_t {
+    Text,      // Keyword expansion, identifier, number or punctuation
+    String,    // String literal
+    Comment,   // ᛞ comment
+    Operation, // ᛨ/ᛩ/᛫ prefixed system, process or file operation
+    Block,     // ᛒ ... ᛘ or { ... }
+    Function,  // Type rune, name and body
+    Class      // ᛥ, name and optional body
+};
+
+struct Node {
+    NodeKind kind;
+    uint8_t flags;   // TokenFlags describing the whitespace before the node
+    uint64_t offset; // Byte offset of the node's first token, see LineIndex
+    Node* next = nullptr; // Next sibling
+
+    Node(NodeKind k, uint8_t f, uint64_t o)
+        : kind(k), flags(f), offset(o) {}
+};
+
+// Singly linked list of sibling nodes
+struct NodeList {
+    Node* first = nullptr;
+    Node* last = nullptr;
+
+    void append(Node* node) {
+        if (last) {
+            last->next = node;
+        } else {
+            first = node;
+        }
+        last = node;
+    }
+};
+
+struct TextNode : Node {
+    std::string_view text;
+
+    TextNode(uint8_t f, uint64_t o, std::string_view t)
+        : Node(NodeKind::Text, f, o), text(t) {}
+};
+
+struct StringNode : Node {
+    std::string_view value; // Contents without delimiters
+
+    StringNode(uint8_t f, uint64_t o, std::string_view v)
+        : Node(NodeKind::String, f, o), value(v) {}
+};
+
+struct CommentNode : Node {
+    std::string_view text;
+
+    CommentNode(uint8_t f, uint64_t o, std::string_view t)
+        : Node(NodeKind::Comment, f, o), text(t) {}
+};
+
+struct OperationNode : Node {
+    std::string_view prefix; // "RuneSystem::", "RuneProcess::" or "RuneFileSystem::"
+    std::string_view name;   // May be empty when no name follows the prefix
+
+    OperationNode(uint8_t f, uint64_t o, std::string_view p, std::string_view n)
+        : Node(NodeKind::Operation, f, o), prefix(p), name(n) {}
+};
+
+struct BlockNode : Node {
+    NodeList children;
+    uint8_t closeFlags = 0; // Whitespace before the closing rune
+
+    BlockNode(uint8_t f, uint64_t o)
+        : Node(NodeKind::Block, f, o) {}
+};
+
+struct FunctionNode : Node {
+    std::string_view returnType;
+    std::string_view name;
+    SymbolId symbol;
+    BlockNode* body = nullptr;
+
+    FunctionNode(uint8_t f, uint64_t o, std::string_view r, std::string_view n, SymbolId s)
+        : Node(NodeKind::Function, f, o), returnType(r), name(n), symbol(s) {}
+};
+
+struct ClassNode : Node {
+    std::string_view name;
+    SymbolId symbol;
+    BlockNode* body = nullptr; // Null for a forward declaration
+
+    ClassNode(uint8_t f, uint64_t o, std::string_view n, SymbolId s)
+        : Node(NodeKind::Class, f, o), name(n), symbol(s) {}
+};
+
+// Root of a parsed translation unit
+struct Program {
+    NodeList items;
+};
+
+// Readable listing of the tree, one node per line with its source offset,
+// for inspecting what passes over the tree did
+std::string dumpProgram(const Program& program);
+
+} // namespace RuneLang
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "RuneAst.hpp"
+
+namespace RuneLang {
+
+// Instruction set of the rune VM. Opcodes are one byte; operands follow
+// inline in little-endian order. Listed once here so the enum and the
+// VM's dispatch table cannot drift apart.
+//   u8/u16: unsigned operand, i32: jump distance from the next instruction
+#define RUNE_OPCODES(X)                                                       \
+    X(Constant)     /* u16 constant               -> value            */       \
+    X(Pop)          /* value                      ->                  */       \
+    X(LoadGlobal)   /* u16 slot                   -> value            */       \
+    X(StoreGlobal)  /* u16 slot, value            -> value            */       \
+    X(LoadLocal)    /* u16 slot                   -> value            */       \
+    X(StoreLocal)   /* u16 slot, value            -> value            */       \
+    X(Add)          /* a b -> a + b, also concatenates strings         */       \
+    X(Subtract)                                                                \
+    X(Multiply)                                                                \
+    X(Divide)                                                                  \
+    X(Modulo)                                                                  \
+    X(ShiftLeft)                                                               \
+    X(ShiftRight)                                                              \
+    X(BitAnd)                                                                  \
+    X(BitOr)                                                                   \
+    X(BitXor)                                                                  \
+    X(Equal)                                                                   \
+    X(NotEqual)                                                                \
+    X(Less)                                                                    \
+    X(LessEqual)                                                               \
+    X(Greater)                                                                 \
+    X(GreaterEqual)                                                            \
+    X(Negate)       /* a -> -a                                          */      \
+    X(Not)          /* a -> !a                                          */      \
+    X(BitNot)       /* a -> ~a                                          */      \
+    X(ToBool)       /* a -> bool(a)                                     */      \
+    X(ToInt)        /* a -> int(a), as stored in a declared variable    */      \
+    X(ToLong)                                                                  \
+    X(ToUnsigned)                                                              \
+    X(ToFloat)                                                                 \
+    X(ToDouble)                                                                \
+    X(ToChar)                                                                  \
+    X(Jump)         /* i32                                              */      \
+    X(JumpIfFalse)  /* i32, condition ->                                */      \
+    X(JumpIfFalseOrPop) /* i32: jumps keeping a falsy value, else pops   */     \
+    X(JumpIfTrueOrPop)  /* i32: jumps keeping a truthy value, else pops  */     \
+    X(Print)        /* value -> (written to the output)                 */      \
+    X(Call)         /* u16 function                -> result            */      \
+    X(CallBuiltin)  /* u16 builtin, u8 argc, args  -> result            */      \
+    X(Return)       /* result ->                                        */      \
+    X(Halt)
+
+enum class OpCode : uint8_t {
+#define RUNE_OPCODE_ENUM(name) name,
+    RUNE_OPCODES(RUNE_OPCODE_ENUM)
+#undef RUNE_OPCODE_ENUM
+    Count
+};
+
+const char* opCodeName(OpCode op);
+
+enum class ValueType : uint8_t {
+    Int,
+    Float,
+    Bool,
+    Char, // Integer in `i`, printed as a character
+    String
+};
+
+// Trivially copyable VM value. Strings are owned elsewhere: by the
+// Script for constants, by the VM for strings made at run time.
+struct Value {
+    ValueType type;
+    union {
+        int64_t i;
+        double f;
+        bool b;
+        const std::string* s;
+    };
+
+    static Value integer(int64_t v) { Value value; value.type = ValueType::Int; value.i = v; return value; }
+    static Value real(double v) { Value value; value.type = ValueType::Float; value.f = v; return value; }
+    static Value boolean(bool v) { Value value; value.type = ValueType::Bool; value.i = 0; value.b = v; return value; }
+    static Value character(char v) { Value value; value.type = ValueType::Char; value.i = v; return value; }
+    static Value string(const std::string* v) { Value value; value.type = ValueType::String; value.s = v; return value; }
+};
+
+// Code of one rune function; the script body is function 0
+struct BytecodeFunction {
+    std::string name;
+    std::vector<uint8_t> code;
+    uint16_t locals = 0;   // Slots reserved on the stack for the frame
+    uint16_t maxStack = 0; // Deepest operand stack the code can build
+    // (first instruction, source offset) pairs, ascending, for locating
+    // runtime errors without storing an offset per instruction
+    std::vector<std::pair<uint32_t, uint64_t>> offsets;
+
+    uint64_t offsetAt(size_t pc) const;
+};
+
+// Compiled rune program. Constants point into `strings`, so a Script can
+// be moved but not copied.
+struct Script {
+    std::vector<BytecodeFunction> functions;
+    std::vector<Value> constants;
+    std::deque<std::string> strings;
+    uint16_t globals = 0;
+
+    Script() = default;
+    Script(Script&&) = default;
+    Script& operator=(Script&&) = default;
+    Script(const Script&) = delete;
+    Script& operator=(const Script&) = delete;
+
+    // Human-readable listing of every function, for debugging
+    std::string disassemble() const;
+};
+
+// Translates a parsed Program into bytecode. Rune source is C++ spelled
+// with runes, so the compiler reads the same node stream the emitter
+// prints and accepts the subset a script needs: variables, expressions,
+// ᚠ output, ᚷ/ᚱ/ᛉ control flow, parameterless functions and the
+// ᛨ/ᛩ/᛫ operations. Anything else is a RuneSourceError at its offset.
+class BytecodeCompiler {
+public:
+    Script compile(const Program& program);
+
+private:
+    // A variable's conversion is applied to every value stored in it, so
+    // the VM sees the same values as the C++ the declaration compiles to;
+    // Halt for types that need none
+    struct Local {
+        std::string_view name;
+        uint16_t slot;
+        size_t depth;
+        OpCode conversion;
+    };
+    struct Global {
+        std::string_view name;
+        uint16_t slot;
+        OpCode conversion;
+    };
+    struct Loop {
+        std::vector<size_t> breaks;
+        std::vector<size_t> continues;
+    };
+
+    Script* script_ = nullptr;
+    BytecodeFunction* function_ = nullptr;
+    std::vector<std::pair<std::string_view, uint16_t>> functionIndex_;
+    std::vector<Global> globalIndex_;
+    std::vector<Local> locals_;
+    std::vector<Loop> loops_;
+    size_t scopeDepth_ = 0;
+    uint16_t nextLocal_ = 0;
+    int stackDepth_ = 0;
+    const Node* node_ = nullptr; // Next node of the statement being compiled
+    const Node* statementStart_ = nullptr;
+    size_t parenDepth_ = 0;
+    uint64_t offset_ = 0;        // Source offset of the code being emitted
+    size_t lastLoad_ = SIZE_MAX; // Position of a trailing variable load, for assignments
+
+    void compileFunction(const FunctionNode* function, uint16_t index);
+    void statements(const NodeList& list);
+    void statement();
+    void body();
+    void declaration();
+    void output();
+    void ifStatement();
+    void whileStatement();
+    void forStatement();
+    void returnStatement();
+    void jumpStatement(bool isBreak);
+    void expression();
+    void assignment();
+    void binary(int minPrecedence);
+    void unary();
+    void postfix();
+    void primary();
+    size_t arguments();
+
+    bool atEnd() const;
+    const Node* advance();
+    std::string_view peekText(const Node** after = nullptr) const;
+    bool match(std::string_view text);
+    void expect(std::string_view text);
+    [[noreturn]] void fail(const std::string& message, const Node* at = nullptr) const;
+
+    void beginScope();
+    void endScope();
+    bool resolve(std::string_view name, OpCode& load, uint16_t& slot) const;
+    uint16_t declareVariable(std::string_view name, OpCode conversion);
+
+    void emit(OpCode op);
+    void emitU8(uint8_t value);
+    void emitU16(uint16_t value);
+    void emitVariable(OpCode op, uint16_t slot);
+    // Stores into the variable `load` reads, converting to its type first
+    void emitStore(OpCode load, uint16_t slot);
+    size_t emitJump(OpCode op);
+    void patchJump(size_t at);
+    void emitLoop(size_t target);
+    void emitConstant(Value value);
+    void emitString(std::string text);
+    void adjustStack(int delta);
+};
+
+// Parses and compiles rune source in one step. Errors are RuneParseErrors
+// located in `source`.
+Script compileScript(std::string_view source);
+
+} // namespace RuneLang
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "RuneOutput.hpp"
+
+namespace RuneLang {
+
+// Identifies generated code: XXH64 of the source bytes under two seeds
+// derived from the compiler fingerprint. The halves hash the same input
+// with the same function, so they are not independent and the key only
+// promises the collision bound of one 64-bit hash: about n^2 / 2^65 for n
+// distinct sources, or 3e-8 at a million entries.
+struct CacheKey {
+    uint64_t high;
+    uint64_t low;
+
+    bool operator==(const CacheKey& other) const { return high == other.high && low == other.low; }
+    std::string hex() const;
+};
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    uint64_t evictions = 0;
+    uint64_t bytesSaved = 0; // Source bytes that did not have to be compiled
+    uint64_t entries = 0;
+    uint64_t diskBytes = 0;
+};
+
+// On-disk cache of generated C++ keyed by the content of the rune source.
+// Entries are written to a temporary file and renamed into place, so
+// readers never see a partial entry. The total size is bounded; the least
+// recently used entries are evicted first, and hits refresh an entry's
+// modification time so the order survives restarts. Safe to share between
+// threads. Processes sharing a directory each enforce the bound on what
+// they know about.
+class RuneCache {
+public:
+    static constexpr uint64_t kDefaultMaxBytes = 256ull << 20;
+    // Part of every key; bump whenever the generated code changes
+    static constexpr std::string_view kCompilerVersion = "runelang-cpp-5";
+
+    explicit RuneCache(const std::string& directory, uint64_t maxBytes = kDefaultMaxBytes);
+
+    RuneCache(const RuneCache&) = delete;
+    RuneCache& operator=(const RuneCache&) = delete;
+
+    // `options` tells apart outputs of the same source under settings
+    // that change the generated code, such as optimization
+    static CacheKey keyFor(std::string_view source, uint64_t options = 0);
+
+    // Appends the cached code for `key` to `out`. `sourceSize` only feeds
+    // the statistics.
+    bool lookup(const CacheKey& key, uint64_t sourceSize, OutputSink& out);
+    // Failures to write are logged, not thrown; the cache is an optimization
+    void store(const CacheKey& key, std::string_view code);
+
+    CacheStats stats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const CacheKey& key) const { return static_cast<size_t>(key.high ^ key.low); }
+    };
+    struct Entry {
+        uint64_t size;
+        std::list<CacheKey>::iterator position; // In lru_
+    };
+
+    std::string directory_;
+    uint64_t maxBytes_;
+    mutable std::mutex mutex_;
+    std::unordered_map<CacheKey, Entry, KeyHash> index_;
+    std::list<CacheKey> lru_; // Most recently used first
+    CacheStats stats_;
+    uint64_t tempCounter_ = 0;
+
+    std::string pathFor(const CacheKey& key) const;
+    void load();
+    void insert(const CacheKey& key, uint64_t size);
+    void evict();
+    void forget(const CacheKey& key);
+};
+
+} // namespace RuneLang
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include "RuneCache.hpp"
+
+namespace RuneLang {
+
+class RuneParser;
+
+// Framing between RuneDaemon and RuneDaemonClient over a Unix stream
+// socket. Both ends are on one machine, so integers are in host order.
+//
+//   request:  uint8 type, uint8 flags, uint32 length, payload
+//   response: uint8 status, uint32 length, payload
+//
+// A connection carries any number of requests, answered in order.
+enum class DaemonRequest : uint8_t {
+    Parse = 1,   // Payload: rune source. Reply: the generated C++
+    Compile = 2, // Payload: input path, NUL, output path. Reply: "written" or "unchanged"
+    Stats = 3,   // Reply: DaemonStats::format()
+    Shutdown = 4 // Reply: empty; the daemon stops once it is sent
+};
+
+enum DaemonFlags : uint8_t {
+    DaemonOptimize = 1 << 0 // Same as RuneParser::setOptimize
+};
+
+enum class DaemonStatus : uint8_t {
+    Ok = 0,
+    ParseError = 1, // Payload: the RuneParseError message
+    Error = 2       // Payload: what went wrong otherwise
+};
+
+struct DaemonStats {
+    uint64_t requests = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t entries = 0;
+    uint64_t bytes = 0; // Generated code held by the result cache
+
+    std::string format() const;
+};
+
+// Long-running compiler that keeps its parsers and recent results warm, so
+// tools calling it many times a minute pay neither process startup nor
+// cold caches. Every worker thread owns a RuneParser and serves one
+// connection at a time; further connections wait for a free worker.
+// Results are cached in memory by source content and options, the least
+// recently used evicted first once `cacheBytes` is exceeded.
+class RuneDaemon {
+public:
+    static constexpr uint64_t kDefaultCacheBytes = 64ull << 20;
+    // Larger payloads are refused and their connection closed
+    static constexpr uint32_t kMaxPayload = 256u << 20;
+
+    // Listens on `socketPath`. A socket file nobody answers on is taken
+    // over; one with a live daemon behind it is an error.
+    RuneDaemon(const std::string& socketPath, unsigned workers, uint64_t cacheBytes = kDefaultCacheBytes);
+    ~RuneDaemon();
+
+    RuneDaemon(const RuneDaemon&) = delete;
+    RuneDaemon& operator=(const RuneDaemon&) = delete;
+
+    // Serves connections until stop() or a Shutdown request, then waits
+    // for requests in progress and returns
+    void serve();
+    // Safe to call from any thread, including a request handler
+    void stop();
+
+    DaemonStats stats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const CacheKey& key) const { return static_cast<size_t>(key.high ^ key.low); }
+    };
+    struct CachedCode {
+        std::string code;
+        std::list<CacheKey>::iterator position; // In lru_
+    };
+
+    std::string socketPath_;
+    unsigned workers_;
+    uint64_t cacheBytes_;
+    int listenFd_ = -1;
+    int wakeFds_[2] = {-1, -1}; // Written by stop() to interrupt serve()
+    std::atomic<bool> stopping_{false};
+
+    std::mutex queueMutex_;
+    std::condition_variable queueReady_;
+    std::deque<int> pending_;          // Accepted, not yet picked up
+    std::unordered_set<int> active_;   // Being served, shut down on stop
+    bool closed_ = false;
+
+    mutable std::mutex cacheMutex_;
+    std::unordered_map<CacheKey, CachedCode, KeyHash> cache_;
+    std::list<CacheKey> lru_; // Most recently used first
+    DaemonStats stats_;
+
+    void work();
+    void serveConnection(int fd, RuneParser& parser);
+    bool lookup(const CacheKey& key, std::string& code);
+    void store(const CacheKey& key, const std::string& code);
+    std::string generate(RuneParser& parser, std::string_view source, uint8_t flags);
+};
+
+// Connection to a RuneDaemon. Failures to reach it throw NETWORK_ERROR;
+// rejected sources throw RuneParseError with the daemon's message.
+class RuneDaemonClient {
+public:
+    explicit RuneDaemonClient(const std::string& socketPath);
+    ~RuneDaemonClient();
+
+    RuneDaemonClient(const RuneDaemonClient&) = delete;
+    RuneDaemonClient& operator=(const RuneDaemonClient&) = delete;
+
+    std::string parse(std::string_view source, uint8_t flags = 0);
+    // Paths are resolved by the daemon, so relative ones are relative to
+    // its working directory. Returns false when `output` was up to date.
+    bool compile(const std::string& input, const std::string& output, uint8_t flags = 0);
+    std::string stats();
+    void shutdown();
+
+private:
+    int fd_;
+
+    std::string request(DaemonRequest type, uint8_t flags, std::string_view payload);
+};
+
+} // namespace RuneLang
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "RuneLineIndex.hpp"
+
+namespace RuneLang {
+
+// Problems the lexer and parser can report
+enum class DiagnosticCode : uint8_t {
+    InvalidUtf8,
+    UnknownRune,
+    UnterminatedString,
+    UnterminatedRuneString,
+    UnmatchedBlockEnd,
+    UnterminatedBlock,
+    ExpectedClassName,
+    NestingTooDeep,
+    DuplicateDefinition
+};
+
+const char* diagnosticText(DiagnosticCode code);
+
+struct Diagnostic {
+    DiagnosticCode code;
+    uint64_t offset;         // Byte offset in the source
+    std::string_view detail; // Offending source text where it helps, e.g. the rune
+    SourcePosition position; // Filled in by DiagnosticList::resolve
+
+    std::string message() const;
+};
+
+// Collects diagnostics for parses that must not throw. Storage is reserved
+// up front; diagnostics beyond the capacity are only counted, so reporting
+// never allocates.
+class DiagnosticList {
+public:
+    static constexpr size_t kDefaultCapacity = 256;
+
+    explicit DiagnosticList(size_t capacity = kDefaultCapacity);
+
+    void report(DiagnosticCode code, uint64_t offset, std::string_view detail = {});
+    // Sorts the diagnostics by offset and fills in their line and column
+    void resolve(const LineIndex& lines);
+    void clear();
+
+    const std::vector<Diagnostic>& items() const { return items_; }
+    bool empty() const { return items_.empty() && dropped_ == 0; }
+    size_t dropped() const { return dropped_; }
+
+private:
+    std::vector<Diagnostic> items_;
+    size_t capacity_;
+    size_t dropped_ = 0;
+};
+
+} // namespace RuneLang
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RuneCache.hpp"
+
+namespace RuneLang {
+
+// One source file and the translation unit it compiles to
+struct CompileJob {
+    std::string input;
+    std::string output;
+    uint64_t size = 0; // Bytes of rune source
+};
+
+struct CompileFailure {
+    std::string input;
+    std::string message;
+};
+
+struct CompileReport {
+    size_t files = 0;
+    uint64_t bytes = 0;
+    size_t unchanged = 0; // Outputs that already held the same code, left alone
+    unsigned workers = 0;
+    double wallSeconds = 0;
+    std::vector<double> latencies; // Seconds per file, sorted ascending
+    std::vector<CompileFailure> failures;
+
+    // Latency below which `fraction` of the files finished, 0 when empty
+    double percentile(double fraction) const;
+};
+
+// Compiles many rune files at once. Every worker thread owns a RuneParser
+// and writes each translation unit to the job's own output path, so
+// compilations never share state.
+class RuneDriver {
+public:
+    static constexpr const char* kSourceExtension = ".rune";
+
+    // Expands directories into the *.rune files below them. Outputs go next
+    // to their inputs, or mirror the directory layout below `outputDir`
+    // when one is given; output directories are created here. Throws
+    // FILE_ERROR when two inputs would write the same output.
+    static std::vector<CompileJob> planJobs(const std::vector<std::string>& inputs,
+                                            const std::string& outputDir = "");
+
+    // Compiles every job on `workers` threads, largest files first so a
+    // big file does not start last and stretch the wall time. All workers
+    // share `cache` when one is given. `optimize` applies
+    // RuneParser::setOptimize to every file.
+    static CompileReport compile(const std::vector<CompileJob>& jobs, unsigned workers,
+                                 RuneCache* cache = nullptr, bool optimize = false);
+};
+
+} // namespace RuneLang
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "RuneAst.hpp"
+#include "RuneOutput.hpp"
+
+namespace RuneLang {
+
+// Walks a parsed Program and writes the equivalent C++
+class CppEmitter {
+public:
+    explicit CppEmitter(OutputSink& out) : out_(out) {}
+
+    void emit(const Program& program);
+    // Emits one top-level item, for callers that parse incrementally
+    void emit(const Node* item);
+
+private:
+    OutputSink& out_;
+    char last_ = '\0'; // Last character written, for separator decisions
+
+    void emitList(const NodeList& list);
+    void emitNode(const Node* node);
+    void emitBlock(const BlockNode* block);
+    void emitSeparator(uint8_t flags);
+    void write(std::string_view text);
+    void write(char c);
+};
+
+// #include lines, and what else has to precede generated `code`, for the
+// standard and runtime facilities it refers to, such as std::cout or
+// RuneFileSystem::. Empty when it refers to none.
+std::string prologueFor(std::string_view code);
+
+// The headers prologueFor() picks, for code that arrives in pieces. A name
+// split between pieces is held back until the piece that completes it.
+class UsedHeaders {
+public:
+    void scan(std::string_view code);
+    // prologueFor() of everything scanned so far
+    std::string prologue() const;
+
+private:
+    uint8_t used_ = 0; // Bit per header
+    std::string tail_; // Name characters at the end of the last piece
+};
+
+// Drops generated code as it drains, keeping only the headers it needs
+class HeaderSink : public OutputSink {
+public:
+    std::string prologue() {
+        flush();
+        return headers_.prologue();
+    }
+
+protected:
+    void drain(const char* data, size_t size) override { headers_.scan(std::string_view(data, size)); }
+
+private:
+    UsedHeaders headers_;
+};
+
+} // namespace RuneLang
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <stdexcept>
 #include "RuneLogger.hpp"
@@ -44,6 +45,59 @@ private:
     ErrorCode code_;
 };
 
+// Custom exception for rune parsing errors
+class RuneParseError : public std::runtime_error {
+public:
+    explicit RuneParseError(const std::string& message, size_t line = 0, size_t column = 0) 
+        : std::runtime_error(formatError(message, line, column)),
+          line_(line),
+          column_(column) {}
+
+    size_t getLine() const { return line_; }
+    size_t getColumn() const { return column_; }
+
+private:
+    size_t line_;
+    size_t column_;
+    
+    static std::string formatError(const std::string& message, size_t line, size_t column) {
+        if (line == 0) return message;
+        return "Line " + std::to_string(line) + ", Column " + std::to_string(column) + ": " + message;
+    }
+};
+
+// Error raised while a compiled rune script runs, located like a parse error
+class RuneRuntimeError : public std::runtime_error {
+public:
+    explicit RuneRuntimeError(const std::string& message, size_t line = 0, size_t column = 0)
+        : std::runtime_error(line == 0 ? message
+                                       : "Line " + std::to_string(line) + ", Column " +
+                                             std::to_string(column) + ": " + message),
+          line_(line),
+          column_(column) {}
+
+    size_t getLine() const { return line_; }
+    size_t getColumn() const { return column_; }
+
+private:
+    size_t line_;
+    size_t column_;
+};
+
+// Parse error located by byte offset only. Raised by the lexer and parser,
+// which do not track lines; the parser turns it into a RuneParseError once
+// the offset has been resolved against the source.
+class RuneSourceError : public std::runtime_error {
+public:
+    RuneSourceError(const std::string& message, uint64_t offset)
+        : std::runtime_error(message), offset_(offset) {}
+
+    uint64_t getOffset() const { return offset_; }
+
+private:
+    uint64_t offset_;
+};
+
 #define RUNE_THROW(code, message) \
     throw RuneError(code, message)
 
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace RuneLang {
+
+// XXH64 of `size` bytes at `data`. Runs at memory bandwidth on large
+// inputs, so hashing a source file costs far less than lexing it.
+uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
+} // namespace RuneLang
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "RuneDiagnostic.hpp"
+#include "RuneError.hpp"
+#include "RuneTable.hpp"
+
+namespace RuneLang {
+
+// Runes the lexer itself has to understand
+constexpr char32_t kStringRune = 0x16DF;  // ᛟ
+constexpr char32_t kCommentRune = 0x16DE; // ᛞ
+
+// Kinds of token produced by the lexer
+enum class TokenKind : uint8_t {
+    Rune,       // Rune from the Runic block, see Token::rune
+    Identifier, // [A-Za-z_][A-Za-z0-9_]*
+    Number,     // Digit followed by identifier characters or '.'
+    String,     // ᛟ...ᛟ or "..." literal, text excludes the delimiters
+    Comment,    // ᛞ up to the end of the line, text excludes the marker
+    Punct       // Any other single ASCII character
+};
+
+// Whitespace that preceded a token
+enum TokenFlags : uint8_t {
+    SpaceBefore = 1 << 0,
+    NewlineBefore = 1 << 1,
+    RuneDelimited = 1 << 2 // String literal delimited by ᛟ instead of '"'
+};
+
+struct Token {
+    TokenKind kind;
+    uint8_t flags;
+    uint8_t rune;          // Offset into the Runic block for TokenKind::Rune
+    uint64_t offset;       // Byte offset of the token's first byte, see LineIndex
+    std::string_view text; // Slice of the source, never copied
+
+    bool hasFlag(TokenFlags flag) const { return (flags & flag) != 0; }
+};
+
+// Decodes one UTF-8 sequence starting at `p`. Returns its length in bytes,
+// or 0 when the sequence is malformed or truncated.
+size_t decodeUtf8(const char* p, const char* end, char32_t& codepoint);
+
+// Encodes a codepoint as UTF-8 (used for diagnostics)
+std::string encodeUtf8(char32_t codepoint);
+
+// Turns rune source into a flat token stream. The source is decoded exactly
+// once; tokens refer back into it, so it must outlive the token vector.
+// Errors are RuneSourceErrors carrying the byte offset of the problem, or
+// diagnostics when a DiagnosticList is attached; the lexer then skips bad
+// input and closes unterminated strings at the end of the source.
+class RuneLexer {
+public:
+    void tokenize(std::string_view source, std::vector<Token>& tokens);
+
+    // Same tokens as tokenize(), lexed on up to `workers` threads. The
+    // source is split at line starts and every piece is lexed as if no
+    // string were open there; pieces where that guess was wrong are lexed
+    // again from the real state until they rejoin the guessed tokens.
+    // Sources too small for `minChunk` bytes per worker, and lexers with
+    // diagnostics attached, are lexed serially.
+    static constexpr size_t kParallelMinChunk = 1 << 20;
+    void tokenizeParallel(std::string_view source, std::vector<Token>& tokens, unsigned workers,
+                          size_t minChunk = kParallelMinChunk);
+
+    // Incremental interface for sources that arrive in pieces. `chunk` must
+    // start at offset(). Unless `last` is set, a token that might continue
+    // past the end of the chunk is left alone. Returns the number of bytes
+    // consumed; the rest has to be passed again with more data appended.
+    size_t tokenizeChunk(std::string_view chunk, bool last, std::vector<Token>& tokens);
+    void reset();
+    // Continues lexing at `token`, which has to come from this lexer
+    void rewind(const Token& token);
+    // Continues lexing at `offset`, which has to follow a newline that is
+    // not part of a token
+    void startLine(uint64_t offset);
+    uint64_t offset() const { return offset_; }
+    // Reports errors to `diagnostics` instead of throwing; null to throw again
+    void setDiagnostics(DiagnosticList* diagnostics) { diagnostics_ = diagnostics; }
+
+private:
+    const char* base_ = nullptr; // Chunk start, located at baseOffset_
+    uint64_t baseOffset_ = 0;
+    uint64_t offset_ = 0;        // Where the next chunk starts
+    uint8_t flags_ = 0;          // Whitespace seen since the last token
+    DiagnosticList* diagnostics_ = nullptr;
+
+    uint64_t offsetOf(const char* p) const {
+        return baseOffset_ + static_cast<uint64_t>(p - base_);
+    }
+    void report(DiagnosticCode code, uint64_t offset, std::string_view detail = {}) const;
+};
+
+} // namespace RuneLang
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace RuneLang {
+
+// 1-based line and column; columns count codepoints, not bytes
+struct SourcePosition {
+    uint32_t line = 1;
+    uint32_t column = 1;
+};
+
+// Resolves byte offsets to line and column for diagnostics. The lexer and
+// parser only record offsets; the newline index is built the first time a
+// position is asked for, so inputs without errors never pay for it.
+class LineIndex {
+public:
+    // `source` starts at byte `baseOffset` of the input, at `basePosition`
+    explicit LineIndex(std::string_view source, uint64_t baseOffset = 0,
+                       SourcePosition basePosition = SourcePosition());
+
+    // Offsets outside the source are clamped to it
+    SourcePosition locate(uint64_t offset) const;
+
+    // Position just past `text`, which starts at `from`
+    static SourcePosition advance(SourcePosition from, std::string_view text);
+
+private:
+    std::string_view source_;
+    uint64_t baseOffset_;
+    SourcePosition basePosition_;
+    mutable std::vector<size_t> newlines_; // Offsets of '\n' within source_
+    mutable bool built_ = false;
+
+    void build() const;
+};
+
+} // namespace RuneLang
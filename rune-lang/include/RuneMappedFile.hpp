@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace RuneLang {
+
+// Read-only memory mapping of a whole file. The contents stay valid for
+// the lifetime of the object; views into them are never copied.
+class RuneMappedFile {
+public:
+    explicit RuneMappedFile(const std::string& path);
+    ~RuneMappedFile();
+
+    RuneMappedFile(const RuneMappedFile&) = delete;
+    RuneMappedFile& operator=(const RuneMappedFile&) = delete;
+
+    std::string_view contents() const {
+        return std::string_view(static_cast<const char*>(data_), size_);
+    }
+    size_t size() const { return size_; }
+
+private:
+    void* data_;
+    size_t size_;
+};
+
+} // namespace RuneLang
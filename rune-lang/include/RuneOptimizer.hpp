@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include "RuneArena.hpp"
+#include "RuneAst.hpp"
+
+namespace RuneLang {
+
+// What a ConstantFolder pass changed
+struct FoldStats {
+    size_t constants = 0;  // Constant subexpressions replaced by their value
+    size_t identities = 0; // Operations like x ᚹ 1 reduced to their operand
+    size_t branches = 0;   // ᚷ statements with a constant condition resolved
+
+    size_t total() const { return constants + identities + branches; }
+};
+
+// Simplifies a parsed Program before emission. The tree is a stream of
+// C++ tokens, so expressions are recovered with C++ precedence and only
+// rewritten where the surrounding tokens bind looser than the rewritten
+// part; anything the folder does not understand is left alone.
+//
+//  - int and double literals are folded across ᚢ ᚦ ᚹ ᚺ ᚻ ᚼ ᚽ ᚾ ᚿ ᛀ and
+//    unary - + ~, following C++ typing; folds that would overflow an int,
+//    divide by zero or change a literal's type are skipped
+//  - x ᚹ 1, x ᚺ 1, x ᚦ 0, x ᚿ 0, x ᛀ 0, x ᚼ 0 and x ᚽ 0 become x where x
+//    takes part in arithmetic anyway, so integer promotion cannot change
+//    the result; x ᚢ 0 is kept, since x may be a floating -0.0
+//  - if with a constant condition and { } bodies is replaced by the branch
+//    that runs
+//
+// New nodes and text are allocated from `arena`, which has to live as long
+// as the program.
+class ConstantFolder {
+public:
+    explicit ConstantFolder(RuneArena& arena) : arena_(arena) {}
+
+    FoldStats fold(Program& program);
+
+private:
+    RuneArena& arena_;
+    FoldStats stats_;
+
+    void foldList(NodeList& list);
+};
+
+// Drops top-level functions and classes the rest of the program never
+// names. Each translation unit is a whole program, so what is kept is what
+// top-level statements and a function called main refer to by name,
+// directly or through other kept definitions. Returns the number dropped.
+size_t pruneUnreferenced(Program& program);
+
+} // namespace RuneLang
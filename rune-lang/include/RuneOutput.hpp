@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace RuneLang {
+
+// Destination for generated C++. Appends land in a small staging buffer
+// and reach the destination in large chunks through drain(), so the
+// emitter pays a memcpy per piece instead of a virtual call.
+class OutputSink {
+public:
+    OutputSink() : cur_(buffer_) {}
+    virtual ~OutputSink() = default;
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void append(std::string_view text) {
+        if (text.size() <= static_cast<size_t>(buffer_ + kBufferSize - cur_)) {
+            std::memcpy(cur_, text.data(), text.size());
+            cur_ += text.size();
+        } else {
+            appendSlow(text);
+        }
+    }
+
+    void append(char c) {
+        if (cur_ == buffer_ + kBufferSize) flush();
+        *cur_++ = c;
+    }
+
+    // Pushes everything appended so far to the destination
+    void flush() {
+        if (cur_ != buffer_) {
+            drain(buffer_, cur_ - buffer_);
+            written_ += cur_ - buffer_;
+            cur_ = buffer_;
+        }
+    }
+
+    // Total bytes appended, flushed or not
+    size_t size() const { return written_ + (cur_ - buffer_); }
+
+protected:
+    virtual void drain(const char* data, size_t size) = 0;
+
+private:
+    static constexpr size_t kBufferSize = 16 * 1024;
+
+    char buffer_[kBufferSize];
+    char* cur_;
+    size_t written_ = 0;
+
+    void appendSlow(std::string_view text);
+};
+
+// Appends to a std::string, reserving the expected size up front
+class StringSink : public OutputSink {
+public:
+    explicit StringSink(std::string& out, size_t sizeHint = 0) : out_(out) {
+        out_.reserve(out_.size() + sizeHint);
+    }
+    ~StringSink() override { flush(); }
+
+    // Generated C++ is rarely more than a quarter larger than its source
+    static size_t estimateFor(size_t sourceSize) { return sourceSize + sourceSize / 4 + 64; }
+
+protected:
+    void drain(const char* data, size_t size) override { out_.append(data, size); }
+
+private:
+    std::string& out_;
+};
+
+// Streams straight to a file descriptor, which it does not own
+class FdSink : public OutputSink {
+public:
+    explicit FdSink(int fd) : fd_(fd) {}
+    ~FdSink() override;
+
+protected:
+    void drain(const char* data, size_t size) override;
+
+private:
+    int fd_;
+};
+
+} // namespace RuneLang
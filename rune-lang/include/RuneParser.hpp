@@ -1,59 +1,33 @@
 #pragma once
 
+#include <functional>
+#include <istream>
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <stdexcept>
+#include "RuneArena.hpp"
+#include "RuneAst.hpp"
+#include "RuneCache.hpp"
+#include "RuneDiagnostic.hpp"
+#include "RuneError.hpp"
+#include "RuneLexer.hpp"
+#include "RuneLineIndex.hpp"
+#include "RuneOutput.hpp"
+#include "RuneSymbols.hpp"
 #include "RuneSystem.hpp"
+#include "RuneTable.hpp"
+#include "RuneTokenBuffer.hpp"
 
 namespace RuneLang {
 
-// Forward declarations
-class RuneParser;
-class Function;
-class Class;
+// Outcome of a parse that reports problems instead of throwing
+struct ParseResult {
+    std::string code; // C++ for everything that could be parsed
+    DiagnosticList diagnostics;
 
-// Custom exception for rune parsing errors
-class RuneParseError : public std::runtime_error {
-public:
-    explicit RuneParseError(const std::string& message, size_t line = 0, size_t column = 0) 
-        : std::runtime_error(formatError(message, line, column)),
-          line_(line),
-          column_(column) {}
-
-    size_t getLine() const { return line_; }
-    size_t getColumn() const { return column_; }
-
-private:
-    size_t line_;
-    size_t column_;
-    
-    static std::string formatError(const std::string& message, size_t line, size_t column) {
-        if (line == 0) return message;
-        return "Line " + std::to_string(line) + ", Column " + std::to_string(column) + ": " + message;
-    }
-};
-
-// Structure to represent a function
-class Function {
-public:
-    std::string returnType;
-    std::string name;
-    std::vector<std::string> parameters;
-    std::string body;
-
-    Function(const std::string& ret, const std::string& n) 
-        : returnType(ret), name(n) {}
-};
-
-// Structure to represent a class
-class Class {
-public:
-    std::string name;
-    std::vector<Function> methods;
-    std::vector<std::string> members;
-
-    explicit Class(const std::string& n) : name(n) {}
+    explicit ParseResult(size_t maxDiagnostics = DiagnosticList::kDefaultCapacity)
+        : diagnostics(maxDiagnostics) {}
+    bool ok() const { return diagnostics.empty(); }
 };
 
 // Main parser class
@@ -61,25 +35,118 @@ class RuneParser {
 public:
     RuneParser();
     std::string parseRuneCode(const std::string& runeCode);
+    void parseRuneCode(const std::string& runeCode, OutputSink& out);
+    // Writes the translation unit to output.cpp and returns the generated
+    // code. Files are replaced atomically, and not at all when they already
+    // hold the same translation unit, so their mtime only moves on change.
     std::string compileToCpp(const std::string& runeCode);
+    std::string compileToCpp(const std::string& runeCode, const std::string& outputPath);
+    void compileToCpp(const std::string& runeCode, OutputSink& out);
+    // Compiles the file at `inputPath` into a translation unit at
+    // `outputPath`. Translation units include only the headers the
+    // generated code uses. Returns false when `outputPath` was already up
+    // to date and left alone.
+    bool compileFile(const std::string& inputPath, const std::string& outputPath);
+
+    // Writes generated code as the complete translation unit at
+    // `outputPath`, as compileFile does. Returns false when the file
+    // already held it.
+    static bool writeTranslationUnit(const std::string& outputPath, std::string_view cppCode);
+
+    // Parses the file at `path` straight out of a read-only mapping; source
+    // bytes are only copied when the generated code is written
+    std::string parseFile(const std::string& path);
+    void parseFile(const std::string& path, OutputSink& out);
     std::string handleCustomType(const std::string& code, size_t& pos);
+
+    // Parses without throwing on bad input. Problems go to the diagnostics,
+    // which refer into `runeCode`; the parser recovers at the next statement
+    // or brace boundary and keeps going. Meant for editors, which mostly see
+    // code that is being typed.
+    ParseResult parseWithDiagnostics(std::string_view runeCode,
+                                     size_t maxDiagnostics = DiagnosticList::kDefaultCapacity);
+    // Variant that reuses the caller's sink and diagnostic storage
+    void parseWithDiagnostics(std::string_view runeCode, OutputSink& out, DiagnosticList& diagnostics);
+
+    // Parses `runeCode` into a syntax tree whose nodes live in `arena`.
+    // The tree refers into `runeCode`, which must outlive it.
+    Program* parse(std::string_view runeCode, RuneArena& arena);
+    // Same, from a lex the caller already has, e.g. one shared with an
+    // editor. The tree refers into tokens.source().
+    Program* parse(const TokenBuffer& tokens, RuneArena& arena);
+
+    // Serves whole-source parses (parseRuneCode, parseFile, compileToCpp,
+    // compileFile) from `cache` when the source was compiled before; null
+    // turns caching off. Hits skip parsing, so they leave the symbol table
+    // empty.
+    void setCache(RuneCache* sharedCache) { cache = sharedCache; }
+
+    // Lexes whole sources on up to `threads` threads; see
+    // RuneLexer::tokenizeParallel. 1, the default, lexes serially.
+    void setLexerThreads(unsigned threads) { lexerThreads = threads; }
+
+    // Runs ConstantFolder and pruneUnreferenced over whole-source parses
+    // before emitting them. Streaming parses emit items as they complete
+    // and are not optimized.
+    void setOptimize(bool enabled) { optimize = enabled; }
+
+    // Symbols of the most recent parse. IDs stay stable across parses with
+    // the same parser, since the interner is kept, until it holds more than
+    // kMaxIdentifiers names; the next parse then starts it afresh.
+    static constexpr size_t kMaxIdentifiers = 1 << 20;
+    const SymbolTable& symbolTable() const { return symbols; }
+    const StringInterner& identifiers() const { return interner; }
+
+    // Reads rune source in chunks and emits C++ as soon as each top-level
+    // item is complete. Memory use is bounded by the chunk size and the
+    // largest top-level item, not by the size of the input.
+    static constexpr size_t kStreamChunkSize = 64 * 1024;
+    void parseStream(std::istream& in, OutputSink& out, size_t chunkSize = kStreamChunkSize);
+    void parseStream(int fd, OutputSink& out, size_t chunkSize = kStreamChunkSize);
     
 private:
-    std::unordered_map<std::string, std::string> runeToKeyword;
-    size_t currentLine;
-    size_t currentColumn;
+    RuneLexer lexer;
+    RuneArena* arena;  // Arena of the parse in progress
+    bool moreInput;    // Streaming: more tokens may follow the current ones
+    DiagnosticList* diagnostics; // Collects errors instead of throwing when set
+    RuneCache* cache;
+    unsigned lexerThreads;
+    bool optimize;
+    StringInterner interner;
+    SymbolTable symbols;
+    SymbolId currentClass; // Class whose body is being parsed, if directly inside one
+    uint64_t currentOffset; // Token being parsed, to locate unexpected errors
     
-    void initializeRuneMap();
-    std::string handleFunction(const std::string& code, size_t& pos);
-    std::string handleClass(const std::string& code, size_t& pos);
-    std::string handleSwitch(const std::string& code, size_t& pos);
-    std::string handleString(const std::string& code, size_t& pos);
-    std::string handleComment(const std::string& code, size_t& pos);
-    std::string handleSystemCall(const std::string& code, size_t& pos);
-    std::string handleProcessManagement(const std::string& code, size_t& pos);
-    std::string handleFileOperation(const std::string& code, size_t& pos);
-    void updatePosition(const std::string& code, size_t& pos);
-    void skipWhitespace(const std::string& code, size_t& pos);
+    template<typename T, typename... Args>
+    T* makeNode(const Token& token, Args&&... args) {
+        return arena->make<T>(token.flags, token.offset, std::forward<Args>(args)...);
+    }
+
+    void resetSymbols();
+    Program* parseTokens(const std::vector<Token>& tokens, RuneArena& parseArena);
+    void parseSource(std::string_view runeCode, OutputSink& out);
+    void parseUncached(std::string_view runeCode, OutputSink& out);
+    Program* parseWhole(std::string_view runeCode, RuneArena& parseArena);
+    void parseChunks(const std::function<size_t(char*, size_t)>& read, OutputSink& out, size_t chunkSize);
+    SymbolId declare(SymbolKind kind, const Token& name, SymbolId owner, bool defined = true);
+    void handleIdentifier(const std::vector<Token>& tokens, size_t pos);
+    void report(DiagnosticCode code, uint64_t offset, std::string_view detail = {});
+    void synchronize(const std::vector<Token>& tokens, size_t& pos) const;
+    void skipBlock(const std::vector<Token>& tokens, size_t& pos) const;
+    void requireTokens(const std::vector<Token>& tokens, size_t pos, size_t count) const;
+    void parseSequence(const std::vector<Token>& tokens, size_t& pos, NodeList& list,
+                       BlockNode* block, size_t depth);
+    Node* parseNode(const std::vector<Token>& tokens, size_t& pos, size_t depth);
+    Node* handleFunction(const std::vector<Token>& tokens, size_t& pos, size_t depth);
+    Node* handleClass(const std::vector<Token>& tokens, size_t& pos, size_t depth);
+    BlockNode* handleBlock(const std::vector<Token>& tokens, size_t& pos, size_t depth);
+    Node* handleString(const std::vector<Token>& tokens, size_t& pos);
+    Node* handleComment(const std::vector<Token>& tokens, size_t& pos);
+    Node* handleSystemCall(const std::vector<Token>& tokens, size_t& pos);
+    Node* handleProcessManagement(const std::vector<Token>& tokens, size_t& pos);
+    Node* handleFileOperation(const std::vector<Token>& tokens, size_t& pos);
+    Node* handleOperation(const std::vector<Token>& tokens, size_t& pos, std::string_view prefix);
+    bool isFunctionHeader(const std::vector<Token>& tokens, size_t pos) const;
 };
 
 } // namespace RuneLang
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace RuneLang {
+
+// Instruction sets the scanning kernels come in
+enum class ScanLevel : uint8_t {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Byte scanning primitives for the lexer's hot loops. Every kernel
+// returns `end` when it finds nothing.
+struct ScanKernels {
+    // First occurrence of `c` in [p, end)
+    const char* (*findByte)(const char* p, const char* end, char c);
+
+    // First byte in [p, end) that is not ASCII whitespace. Adds the number
+    // of newlines skipped to `newlines` and points `lastNewline` at the
+    // last of them.
+    const char* (*skipWhitespace)(const char* p, const char* end,
+                                  size_t& newlines, const char*& lastNewline);
+
+    // First occurrence of the three bytes at `sequence` in [p, end), as
+    // needed to find the UTF-8 encoding of a rune
+    const char* (*findSequence3)(const char* p, const char* end, const char* sequence);
+};
+
+// Best level this CPU supports
+ScanLevel detectScanLevel();
+
+// Kernels for `level`, or for the best supported level below it
+const ScanKernels& scanKernels(ScanLevel level);
+
+// Kernels the lexer uses; detectScanLevel() unless overridden
+const ScanKernels& activeScanKernels();
+ScanLevel activeScanLevel();
+void setScanLevel(ScanLevel level);
+
+const char* scanLevelName(ScanLevel level);
+
+} // namespace RuneLang
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "RuneArena.hpp"
+
+namespace RuneLang {
+
+// Identifiers are interned once and then handled as 32-bit IDs, so lookups
+// and comparisons are integer operations. 0 is never a valid ID.
+using SymbolId = uint32_t;
+constexpr SymbolId kNoSymbol = 0;
+
+// Maps identifier spellings to dense IDs. Each distinct spelling is copied
+// into the interner's arena once, however often it occurs.
+class StringInterner {
+public:
+    StringInterner();
+
+    SymbolId intern(std::string_view text);
+    // kNoSymbol if `text` was never interned
+    SymbolId find(std::string_view text) const;
+    std::string_view name(SymbolId id) const { return names_[id]; }
+    size_t size() const { return names_.size() - 1; }
+    // Forgets every name; IDs handed out before are reused
+    void clear();
+
+private:
+    RuneArena storage_{4096};
+    std::vector<std::string_view> names_; // Indexed by ID; slot 0 unused
+    std::vector<uint32_t> hashes_;        // Parallel to names_
+    std::vector<SymbolId> slots_;         // Open addressing, power-of-two size
+
+    static uint32_t hash(std::string_view text);
+    size_t slotFor(std::string_view text, uint32_t h) const;
+    void grow();
+};
+
+enum class SymbolKind : uint8_t {
+    Function,
+    Class,
+    Method, // Function declared directly in a class body
+    Member  // <type rune> <name> directly in a class body
+};
+
+struct Declaration {
+    SymbolKind kind;
+    bool defined;      // False for a class forward declaration
+    SymbolId name;
+    SymbolId owner;    // Enclosing class of methods and members
+    uint64_t offset;   // Byte offset of the declaring token
+    uint32_t previous; // Declaration this one superseded in its scope
+};
+
+// Declarations and references of one compilation. Classes and functions
+// share the global scope; members and methods are scoped by their class.
+class SymbolTable {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    // State to return to with rollback(), for items that may be parsed
+    // again. References are only logged while a mark is open.
+    struct Mark {
+        size_t declarations;
+        size_t duplicates;
+    };
+
+    // Records a declaration. Returns false when `name` is already defined
+    // in the same scope; the duplicate is recorded and the first one kept.
+    bool declare(SymbolKind kind, SymbolId name, SymbolId owner, uint64_t offset, bool defined = true);
+    void reference(SymbolId name);
+
+    // Current declaration of `name` in the scope of `owner`, or null
+    const Declaration* lookup(SymbolId name, SymbolId owner = kNoSymbol) const;
+    uint32_t referenceCount(SymbolId name) const {
+        return name < referenceCounts_.size() ? referenceCounts_[name] : 0;
+    }
+
+    // Every declaration in source order, forward declarations included
+    const std::vector<Declaration>& declarations() const { return declarations_; }
+    // Indices into declarations() of definitions that repeat an earlier one
+    const std::vector<uint32_t>& duplicates() const { return duplicates_; }
+
+    Mark mark();
+    void rollback(const Mark& mark);
+    // Storage is kept for the next compilation. Only the IDs this one
+    // touched are reset, so the cost does not grow with the interner.
+    void clear();
+
+private:
+    std::vector<Declaration> declarations_;
+    std::vector<uint32_t> duplicates_;
+    std::vector<uint32_t> referenceCounts_; // Indexed by SymbolId
+    std::vector<SymbolId> referenced_;      // IDs whose count left zero since clear()
+    std::vector<uint32_t> globalScope_;     // SymbolId to current declaration
+    std::unordered_map<uint64_t, uint32_t> memberScopes_; // (owner, name) to current declaration
+    std::vector<SymbolId> pendingReferences_; // Made since the open mark
+    bool marked_ = false;
+
+    uint32_t* scopeSlot(SymbolId owner, SymbolId name, bool create);
+    static uint64_t memberKey(SymbolId owner, SymbolId name) {
+        return (static_cast<uint64_t>(owner) << 32) | name;
+    }
+};
+
+} // namespace RuneLang
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
@@ -11,6 +12,18 @@ namespace RuneLang {
 // Forward declaration
 void* threadWrapper(void* arg);
 
+// Host information behind the ᛨ prefix
+class RuneSystem {
+public:
+    static std::string getOSVersion();
+    static std::string getHostname();
+    static unsigned getCPUCount();
+    static uint64_t getTotalMemory();     // Bytes
+    static uint64_t getAvailableMemory(); // Bytes
+    static uint64_t getUptime();          // Seconds
+    static void sleep(unsigned milliseconds);
+};
+
 // Process management class
 class RuneProcess {
 public:
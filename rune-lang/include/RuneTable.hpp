@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace RuneLang {
+
+// Runes live in the Unicode Runic block (U+16A0–U+16FF)
+constexpr char32_t kRuneBlockFirst = 0x16A0;
+constexpr char32_t kRuneBlockLast = 0x16FF;
+constexpr size_t kRuneBlockSize = kRuneBlockLast - kRuneBlockFirst + 1;
+
+// A rune and the C++ it expands to
+struct RuneMapping {
+    char32_t rune;
+    std::string_view keyword;
+};
+
+constexpr RuneMapping kRuneMappings[] = {
+    {U'ᚠ', "std::cout << "}, // Output to console
+    {U'ᚱ', "for"},           // For-loop
+    {U'ᚷ', "if"},            // If-condition
+    {U'ᛏ', "return"},        // Return from function
+    {U'ᚢ', "+"},             // Addition operator
+    {U'ᚦ', "-"},             // Subtraction operator
+    {U'ᛉ', "while"},         // While-loop
+    {U'ᚨ', "std::vector<"},  // Array declaration
+    {U'ᛜ', "std::cin >> "},  // Input from console
+    {U'ᛝ', "std::string"},   // String type
+    {U'ᛞ', "#"},             // Comment marker
+    {U'ᛟ', "\""},            // String delimiter
+    {U'ᛗ', "->"},            // Arrow operator
+    {U'ᚹ', "*"},             // Multiplication
+    {U'ᚺ', "/"},             // Division
+    {U'ᚻ', "%"},             // Modulo
+    {U'ᚼ', "<<"},            // Left shift
+    {U'ᚽ', ">>"},            // Right shift
+    {U'ᚾ', "&"},             // Bitwise AND
+    {U'ᚿ', "|"},             // Bitwise OR
+    {U'ᛀ', "^"},             // Bitwise XOR
+    {U'ᛁ', "~"},             // Bitwise NOT
+    {U'ᛃ', "="},             // Assignment operator
+    {U'ᛇ', "!="},            // Not equal operator
+    {U'ᛋ', "||"},            // Logical OR operator
+    {U'ᛒ', "{"},             // Start of block
+    {U'ᛘ', "}"},             // End of block
+    {U'ᛚ', "float"},         // Float array type
+    {U'ᛦ', "double"},        // Double array type
+    {U'ᛙ', "char"},          // Char type
+    {U'ᛠ', "double"},        // Double type
+    {U'ᛡ', "bool"},          // Boolean type
+    {U'ᛤ', "void"},          // Void return type
+    {U'ᛥ', "class"},         // Class declaration
+    {U'ᛧ', "struct"},        // Struct declaration
+    {U'ᛨ', "RuneSystem::"},  // System operations prefix
+    {U'ᛩ', "RuneProcess::"}, // Process operations prefix
+    {U'ᛪ', "RuneThread::"},  // Thread operations prefix
+    {U'᛫', "RuneFileSystem::"}, // File system operations prefix
+    {U'᛬', "allocateMemory"}, // Allocate memory
+    {U'ᛮ', "freeMemory"},     // Free memory
+    {U'ᛯ', "createProcess"}, // Create new process
+    {U'ᛰ', "createThread"}, // Create new thread
+    {U'ᛱ', "terminate"},    // Terminate process/thread
+    {U'ᛲ', "createFile"},    // Create file
+    {U'ᛳ', "deleteFile"},    // Delete file
+    {U'ᛴ', "readFile"},      // Read file
+    {U'ᛵ', "writeFile"},     // Write file
+};
+
+namespace detail {
+
+constexpr bool runesInBlock() {
+    for (const auto& mapping : kRuneMappings) {
+        if (mapping.rune < kRuneBlockFirst || mapping.rune > kRuneBlockLast) return false;
+    }
+    return true;
+}
+
+constexpr bool runesUnique() {
+    constexpr size_t count = sizeof(kRuneMappings) / sizeof(kRuneMappings[0]);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = i + 1; j < count; j++) {
+            if (kRuneMappings[i].rune == kRuneMappings[j].rune) return false;
+        }
+    }
+    return true;
+}
+
+constexpr std::array<std::string_view, kRuneBlockSize> buildRuneTable() {
+    std::array<std::string_view, kRuneBlockSize> table{};
+    for (const auto& mapping : kRuneMappings) {
+        table[mapping.rune - kRuneBlockFirst] = mapping.keyword;
+    }
+    return table;
+}
+
+} // namespace detail
+
+static_assert(detail::runesInBlock(), "Every rune must come from the Runic block");
+static_assert(detail::runesUnique(), "A rune may only be mapped once");
+
+// Expansion for every rune in the block, indexed by (codepoint - U+16A0).
+// Unmapped runes expand to an empty view.
+inline constexpr std::array<std::string_view, kRuneBlockSize> kRuneTable = detail::buildRuneTable();
+
+} // namespace RuneLang
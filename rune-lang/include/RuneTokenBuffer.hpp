@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "RuneLexer.hpp"
+
+namespace RuneLang {
+
+// Token stream of one source stored as parallel arrays, ten bytes per
+// token and no per-token objects, so one lex of a document can be kept
+// around and shared by the compiler, the highlighter and error checking.
+// Token text is not stored: it is found again from the offset, the length
+// and the delimiter the kind implies. The source must outlive the buffer
+// and, with 32-bit offsets, be smaller than 4 GiB.
+class TokenBuffer {
+public:
+    // Replaces the contents with the tokens of `source`. Lexing goes
+    // through a small scratch vector, so no full std::vector<Token> is ever
+    // built. Errors are those of `lexer`, thrown or reported to its
+    // diagnostics.
+    void lex(std::string_view source, RuneLexer& lexer);
+    void lex(std::string_view source);
+    // Replaces the contents with `tokens`, which refer into `source`
+    void assign(std::string_view source, const std::vector<Token>& tokens);
+    void clear();
+
+    size_t size() const { return kinds_.size(); }
+    bool empty() const { return kinds_.empty(); }
+    std::string_view source() const { return source_; }
+
+    TokenKind kind(size_t i) const { return static_cast<TokenKind>(kinds_[i]); }
+    uint8_t flags(size_t i) const { return flags_[i]; }
+    bool hasFlag(size_t i, TokenFlags flag) const { return (flags_[i] & flag) != 0; }
+    // Byte offset of the token's first byte, delimiters included
+    uint32_t offset(size_t i) const { return offsets_[i]; }
+    // Length of the token's text, delimiters excluded
+    uint32_t length(size_t i) const { return lengths_[i]; }
+    std::string_view text(size_t i) const {
+        return source_.substr(offsets_[i] + delimiterLength(i), lengths_[i]);
+    }
+    // Offset into the Runic block for TokenKind::Rune, decoded on demand
+    uint8_t rune(size_t i) const;
+
+    // The token as the lexer produced it
+    Token token(size_t i) const;
+    // Appends every token to `tokens`, for code that wants a Token vector
+    void toTokens(std::vector<Token>& tokens) const;
+
+    // Index of the first token starting at or after `offset`
+    size_t lowerBound(uint64_t offset) const;
+
+    // Bytes held by the columns, capacity included
+    size_t memoryUsage() const;
+
+private:
+    std::string_view source_;
+    std::vector<uint8_t> kinds_;
+    std::vector<uint8_t> flags_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> lengths_;
+
+    size_t delimiterLength(size_t i) const {
+        switch (kind(i)) {
+            case TokenKind::String: return hasFlag(i, RuneDelimited) ? 3 : 1;
+            case TokenKind::Comment: return 3; // ᛞ
+            default: return 0;
+        }
+    }
+    void append(const std::vector<Token>& tokens);
+};
+
+} // namespace RuneLang
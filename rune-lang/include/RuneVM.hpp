@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "RuneBytecode.hpp"
+#include "RuneOutput.hpp"
+#include "RuneSystem.hpp"
+
+namespace RuneLang {
+
+class RuneVM;
+
+// Operation reachable through a ᛨ, ᛩ or ᛫ prefix. Arguments are checked
+// against the arity when the script is compiled.
+struct Builtin {
+    std::string_view prefix; // As expanded by the rune table, e.g. "RuneSystem::"
+    std::string_view name;
+    uint8_t minArgs;
+    uint8_t maxArgs;
+    Value (*call)(RuneVM& vm, const Value* args, uint8_t argc);
+};
+
+// Index of prefix + name in the builtin table, or -1
+int findBuiltin(std::string_view prefix, std::string_view name);
+const Builtin& builtin(uint16_t index);
+
+// Executes compiled rune scripts. Dispatch is threaded through a table of
+// label addresses where the compiler supports computed goto, with a switch
+// loop as fallback. Output goes through the sink's buffer; it is flushed
+// when the script ends or sleeps.
+class RuneVM {
+public:
+    static constexpr size_t kStackSize = 64 * 1024; // Values
+    static constexpr size_t kMaxCallDepth = 1024;
+    static constexpr size_t kMinCollect = 1024; // Runtime strings before the first collection
+
+    explicit RuneVM(OutputSink& out);
+    ~RuneVM();
+
+    // Runs the script body. Runtime errors are RuneSourceErrors carrying
+    // the offset of the failing code.
+    void run(const Script& script);
+
+    // For builtins
+    OutputSink& output() { return out_; }
+    Value makeString(std::string text);
+    std::string_view stringArg(const Value* args, uint8_t index) const;
+    int64_t intArg(const Value* args, uint8_t index) const;
+    RuneProcess& process(int64_t handle);
+    int64_t startProcess(const std::string& command);
+    [[noreturn]] void fail(const std::string& message) const;
+
+    // Runtime strings not yet collected
+    size_t heapStrings() const { return heap_.size(); }
+
+private:
+    struct Frame {
+        const BytecodeFunction* function;
+        const uint8_t* returnPc;
+        Value* base;
+    };
+
+    OutputSink& out_;
+    std::unique_ptr<Value[]> stack_;
+    std::vector<Value> globals_;
+    std::vector<Frame> frames_;
+    // Strings made at run time, collected when the heap doubles
+    std::vector<std::unique_ptr<std::string>> heap_;
+    size_t collectAt_ = kMinCollect;
+    Value* top_ = nullptr; // End of the live stack as of the last allocation
+    std::vector<std::unique_ptr<RuneProcess>> processes_;
+    // Where the running instruction started, for locating errors
+    const BytecodeFunction* errorFunction_ = nullptr;
+    size_t errorPc_ = 0;
+
+    void execute(const Script& script);
+    void collect();
+    void print(const Value& value);
+};
+
+// Compiles and runs rune source, writing the script's output to `out`.
+// Compile errors are RuneParseErrors, runtime errors RuneRuntimeErrors,
+// both located in `source`.
+void runScript(std::string_view source, OutputSink& out);
+
+} // namespace RuneLang
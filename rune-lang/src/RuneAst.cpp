@@ -0,0 +1,87 @@
+#include "../include/RuneAst.hpp"
+
+namespace RuneLang {
+
+namespace {
+
+void appendQuoted(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '\n') {
+            out += "\\n";
+        } else if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void dumpList(std::string& out, const NodeList& list, size_t depth);
+
+void dumpNode(std::string& out, const Node* node, size_t depth) {
+    out.append(depth * 2, ' ');
+    switch (node->kind) {
+    case NodeKind::Text:
+        out += "Text ";
+        appendQuoted(out, static_cast<const TextNode*>(node)->text);
+        break;
+    case NodeKind::String:
+        out += "String ";
+        appendQuoted(out, static_cast<const StringNode*>(node)->value);
+        break;
+    case NodeKind::Comment:
+        out += "Comment ";
+        appendQuoted(out, static_cast<const CommentNode*>(node)->text);
+        break;
+    case NodeKind::Operation: {
+        const auto* operation = static_cast<const OperationNode*>(node);
+        out += "Operation ";
+        out += operation->prefix;
+        out += operation->name;
+        break;
+    }
+    case NodeKind::Block:
+        out += "Block";
+        break;
+    case NodeKind::Function: {
+        const auto* function = static_cast<const FunctionNode*>(node);
+        out += "Function ";
+        out += function->returnType;
+        out += ' ';
+        out += function->name;
+        break;
+    }
+    case NodeKind::Class:
+        out += "Class ";
+        out += static_cast<const ClassNode*>(node)->name;
+        break;
+    }
+    out += " @";
+    out += std::to_string(node->offset);
+    out += '\n';
+
+    if (node->kind == NodeKind::Block) {
+        dumpList(out, static_cast<const BlockNode*>(node)->children, depth + 1);
+    } else if (node->kind == NodeKind::Function && static_cast<const FunctionNode*>(node)->body) {
+        dumpNode(out, static_cast<const FunctionNode*>(node)->body, depth + 1);
+    } else if (node->kind == NodeKind::Class && static_cast<const ClassNode*>(node)->body) {
+        dumpNode(out, static_cast<const ClassNode*>(node)->body, depth + 1);
+    }
+}
+
+void dumpList(std::string& out, const NodeList& list, size_t depth) {
+    for (const Node* node = list.first; node; node = node->next) dumpNode(out, node, depth);
+}
+
+} // namespace
+
+std::string dumpProgram(const Program& program) {
+    std::string out = "Program\n";
+    dumpList(out, program.items, 1);
+    return out;
+}
+
+} // namespace RuneLang
@@ -0,0 +1,977 @@
+#include "../include/RuneBytecode.hpp"
+#include "../include/RuneLexer.hpp"
+#include "../include/RuneLineIndex.hpp"
+#include "../include/RuneParser.hpp"
+#include "../include/RuneVM.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace RuneLang {
+
+namespace {
+
+// Variable types. The VM is dynamically typed; a type picks the value of
+// a declaration without initializer and the conversion of stored values.
+constexpr std::string_view kTypeNames[] = {
+    "std::string", "float", "double", "char", "bool", "int", "long", "unsigned", "auto",
+};
+
+// Conversion applied to values stored in a variable of `type`, or Halt
+OpCode conversionFor(std::string_view type) {
+    if (type == "float") return OpCode::ToFloat;
+    if (type == "double") return OpCode::ToDouble;
+    if (type == "char") return OpCode::ToChar;
+    if (type == "bool") return OpCode::ToBool;
+    if (type == "int") return OpCode::ToInt;
+    if (type == "long") return OpCode::ToLong;
+    if (type == "unsigned") return OpCode::ToUnsigned;
+    return OpCode::Halt;
+}
+
+// Operators spelled with more than one punctuation token
+constexpr std::string_view kCompoundOperators[] = {
+    "<<=", ">>=", "<=", ">=", "==", "!=", "&&", "||", "<<", ">>",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "++", "--",
+};
+
+struct BinaryOperator {
+    std::string_view text;
+    int precedence;
+    OpCode op;
+};
+
+constexpr int kShiftPrecedence = 8;
+
+// C++ precedence, loosest first; && and || compile to jumps
+constexpr BinaryOperator kBinaryOperators[] = {
+    {"||", 1, OpCode::JumpIfTrueOrPop},
+    {"&&", 2, OpCode::JumpIfFalseOrPop},
+    {"|", 3, OpCode::BitOr},
+    {"^", 4, OpCode::BitXor},
+    {"&", 5, OpCode::BitAnd},
+    {"==", 6, OpCode::Equal},
+    {"!=", 6, OpCode::NotEqual},
+    {"<", 7, OpCode::Less},
+    {"<=", 7, OpCode::LessEqual},
+    {">", 7, OpCode::Greater},
+    {">=", 7, OpCode::GreaterEqual},
+    {"<<", kShiftPrecedence, OpCode::ShiftLeft},
+    {">>", kShiftPrecedence, OpCode::ShiftRight},
+    {"+", 9, OpCode::Add},
+    {"-", 9, OpCode::Subtract},
+    {"*", 10, OpCode::Multiply},
+    {"/", 10, OpCode::Divide},
+    {"%", 10, OpCode::Modulo},
+};
+
+// Compound assignments and the operation they apply
+constexpr BinaryOperator kAssignmentOperators[] = {
+    {"=", 0, OpCode::Halt},
+    {"+=", 0, OpCode::Add},
+    {"-=", 0, OpCode::Subtract},
+    {"*=", 0, OpCode::Multiply},
+    {"/=", 0, OpCode::Divide},
+    {"%=", 0, OpCode::Modulo},
+    {"<<=", 0, OpCode::ShiftLeft},
+    {">>=", 0, OpCode::ShiftRight},
+    {"&=", 0, OpCode::BitAnd},
+    {"|=", 0, OpCode::BitOr},
+    {"^=", 0, OpCode::BitXor},
+};
+
+template <size_t N>
+const BinaryOperator* findOperator(const BinaryOperator (&table)[N], std::string_view text) {
+    for (const BinaryOperator& candidate : table) {
+        if (candidate.text == text) return &candidate;
+    }
+    return nullptr;
+}
+
+std::string_view textOf(const Node* node) {
+    return node && node->kind == NodeKind::Text ? static_cast<const TextNode*>(node)->text
+                                                : std::string_view();
+}
+
+bool isIdentifier(std::string_view text) {
+    if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_')) {
+        return false;
+    }
+    return std::all_of(text.begin(), text.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    });
+}
+
+bool isTypeName(std::string_view text) {
+    return std::find(std::begin(kTypeNames), std::end(kTypeNames), text) != std::end(kTypeNames);
+}
+
+bool isOperatorText(std::string_view text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) {
+        return std::ispunct(static_cast<unsigned char>(c)) != 0;
+    });
+}
+
+const Node* skipComments(const Node* node) {
+    while (node && node->kind == NodeKind::Comment) node = node->next;
+    return node;
+}
+
+std::string unescape(std::string_view literal) {
+    std::string out;
+    out.reserve(literal.size());
+    for (size_t i = 0; i < literal.size(); i++) {
+        char c = literal[i];
+        if (c != '\\' || i + 1 == literal.size()) {
+            out += c;
+            continue;
+        }
+        switch (c = literal[++i]) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case '0': out += '\0'; break;
+        case 'a': out += '\a'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'v': out += '\v'; break;
+        case 'x': {
+            unsigned value = 0;
+            size_t digits = 0;
+            while (i + 1 < literal.size() && digits < 2 &&
+                   std::isxdigit(static_cast<unsigned char>(literal[i + 1]))) {
+                const char d = literal[++i];
+                value = value * 16 + (std::isdigit(static_cast<unsigned char>(d)) ? d - '0'
+                                                                                  : (d | 0x20) - 'a' + 10);
+                digits++;
+            }
+            out += static_cast<char>(value);
+            break;
+        }
+        default: out += c; break; // \\, \", \' and unknown escapes
+        }
+    }
+    return out;
+}
+
+// Net operand stack change of the fixed-size instructions
+int stackEffect(OpCode op) {
+    switch (op) {
+    case OpCode::Constant:
+    case OpCode::LoadGlobal:
+    case OpCode::LoadLocal:
+    case OpCode::Call:
+        return 1;
+    case OpCode::StoreGlobal:
+    case OpCode::StoreLocal:
+    case OpCode::Negate:
+    case OpCode::Not:
+    case OpCode::BitNot:
+    case OpCode::ToBool:
+    case OpCode::ToInt:
+    case OpCode::ToLong:
+    case OpCode::ToUnsigned:
+    case OpCode::ToFloat:
+    case OpCode::ToDouble:
+    case OpCode::ToChar:
+    case OpCode::Jump:
+    case OpCode::CallBuiltin: // Adjusted by the caller, which knows argc
+    case OpCode::Halt:
+    case OpCode::Count:
+        return 0;
+    default: // Binary operators, conditional jumps, Pop, Print, Return
+        return -1;
+    }
+}
+
+uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+int32_t readI32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return static_cast<int32_t>(value);
+}
+
+} // namespace
+
+const char* opCodeName(OpCode op) {
+    static const char* const names[] = {
+#define RUNE_OPCODE_NAME(name) #name,
+        RUNE_OPCODES(RUNE_OPCODE_NAME)
+#undef RUNE_OPCODE_NAME
+    };
+    return op < OpCode::Count ? names[static_cast<size_t>(op)] : "?";
+}
+
+uint64_t BytecodeFunction::offsetAt(size_t pc) const {
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), pc,
+                               [](size_t value, const std::pair<uint32_t, uint64_t>& entry) {
+                                   return value < entry.first;
+                               });
+    return it == offsets.begin() ? 0 : std::prev(it)->second;
+}
+
+std::string Script::disassemble() const {
+    std::string out;
+    char line[128];
+    for (size_t f = 0; f < functions.size(); f++) {
+        const BytecodeFunction& function = functions[f];
+        std::snprintf(line, sizeof(line), "function %zu %s (locals %u, stack %u)\n", f,
+                      function.name.c_str(), function.locals, function.maxStack);
+        out += line;
+        const std::vector<uint8_t>& code = function.code;
+        for (size_t pc = 0; pc < code.size();) {
+            const OpCode op = static_cast<OpCode>(code[pc]);
+            int length = std::snprintf(line, sizeof(line), "%6zu  %-16s", pc, opCodeName(op));
+            pc++;
+            switch (op) {
+            case OpCode::Constant: {
+                const Value& value = constants[readU16(&code[pc])];
+                switch (value.type) {
+                case ValueType::Int: std::snprintf(line + length, sizeof(line) - length, "%lld", static_cast<long long>(value.i)); break;
+                case ValueType::Float: std::snprintf(line + length, sizeof(line) - length, "%g", value.f); break;
+                case ValueType::Bool: std::snprintf(line + length, sizeof(line) - length, "%s", value.b ? "true" : "false"); break;
+                case ValueType::Char: std::snprintf(line + length, sizeof(line) - length, "'\\x%02x'", static_cast<unsigned char>(value.i)); break;
+                case ValueType::String: std::snprintf(line + length, sizeof(line) - length, "\"%.40s\"", value.s->c_str()); break;
+                }
+                pc += 2;
+                break;
+            }
+            case OpCode::LoadGlobal:
+            case OpCode::StoreGlobal:
+            case OpCode::LoadLocal:
+            case OpCode::StoreLocal:
+                std::snprintf(line + length, sizeof(line) - length, "%u", readU16(&code[pc]));
+                pc += 2;
+                break;
+            case OpCode::Call:
+                std::snprintf(line + length, sizeof(line) - length, "%s", functions[readU16(&code[pc])].name.c_str());
+                pc += 2;
+                break;
+            case OpCode::CallBuiltin: {
+                const Builtin& target = builtin(readU16(&code[pc]));
+                std::snprintf(line + length, sizeof(line) - length, "%.*s%.*s/%u",
+                              static_cast<int>(target.prefix.size()), target.prefix.data(),
+                              static_cast<int>(target.name.size()), target.name.data(), code[pc + 2]);
+                pc += 3;
+                break;
+            }
+            case OpCode::Jump:
+            case OpCode::JumpIfFalse:
+            case OpCode::JumpIfFalseOrPop:
+            case OpCode::JumpIfTrueOrPop:
+                std::snprintf(line + length, sizeof(line) - length, "-> %lld",
+                              static_cast<long long>(pc + 4) + readI32(&code[pc]));
+                pc += 4;
+                break;
+            default:
+                break;
+            }
+            out += line;
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+Script BytecodeCompiler::compile(const Program& program) {
+    Script script;
+    script_ = &script;
+    functionIndex_.clear();
+    globalIndex_.clear();
+
+    // Functions may be called before their definition
+    script.functions.emplace_back().name = "<script>";
+    for (const Node* item = program.items.first; item; item = item->next) {
+        if (item->kind != NodeKind::Function) continue;
+        const auto* function = static_cast<const FunctionNode*>(item);
+        for (const auto& known : functionIndex_) {
+            if (known.first == function->name) {
+                offset_ = function->offset;
+                fail("function " + std::string(function->name) + " is already defined", function);
+            }
+        }
+        if (script.functions.size() > UINT16_MAX) fail("too many functions", function);
+        functionIndex_.emplace_back(function->name, static_cast<uint16_t>(script.functions.size()));
+        script.functions.emplace_back().name = std::string(function->name);
+    }
+
+    // The script body runs first, then main() when the script defines one
+    function_ = &script.functions[0];
+    locals_.clear();
+    loops_.clear();
+    scopeDepth_ = 0;
+    nextLocal_ = 0;
+    stackDepth_ = 0;
+    statements(program.items);
+    for (const auto& known : functionIndex_) {
+        if (known.first == "main") {
+            emit(OpCode::Call);
+            emitU16(known.second);
+            emit(OpCode::Pop);
+        }
+    }
+    emit(OpCode::Halt);
+
+    for (const Node* item = program.items.first; item; item = item->next) {
+        if (item->kind != NodeKind::Function) continue;
+        const auto* function = static_cast<const FunctionNode*>(item);
+        for (const auto& known : functionIndex_) {
+            if (known.first == function->name) compileFunction(function, known.second);
+        }
+    }
+
+    script_ = nullptr;
+    function_ = nullptr;
+    return script;
+}
+
+void BytecodeCompiler::compileFunction(const FunctionNode* function, uint16_t index) {
+    function_ = &script_->functions[index];
+    locals_.clear();
+    loops_.clear();
+    scopeDepth_ = 1; // Declarations in a function body are locals
+    nextLocal_ = 0;
+    stackDepth_ = 0;
+    offset_ = function->offset;
+
+    statements(function->body->children);
+    // Falling off the end returns 0, which void callers drop
+    emitConstant(Value::integer(0));
+    emit(OpCode::Return);
+}
+
+void BytecodeCompiler::statements(const NodeList& list) {
+    const Node* const savedNode = node_;
+    const size_t savedParens = parenDepth_;
+    node_ = skipComments(list.first);
+    parenDepth_ = 0;
+    while (node_) statement();
+    node_ = savedNode;
+    parenDepth_ = savedParens;
+}
+
+void BytecodeCompiler::statement() {
+    const Node* const start = node_;
+    statementStart_ = start;
+    offset_ = start->offset;
+
+    switch (start->kind) {
+    case NodeKind::Block:
+        advance();
+        beginScope();
+        statements(static_cast<const BlockNode*>(start)->children);
+        endScope();
+        return;
+    case NodeKind::Function:
+        // Compiled on their own once the script body is done
+        if (function_ != &script_->functions[0] || scopeDepth_ != 0) {
+            fail("functions can only be defined at the top level", start);
+        }
+        advance();
+        return;
+    case NodeKind::Class:
+        fail("classes are not supported by the bytecode compiler", start);
+    default:
+        break;
+    }
+
+    const std::string_view text = textOf(start);
+    if (text == ";") {
+        advance();
+        return;
+    } else if (text == "if") {
+        ifStatement();
+        return;
+    } else if (text == "while") {
+        whileStatement();
+        return;
+    } else if (text == "for") {
+        forStatement();
+        return;
+    } else if (text == kRuneTable[U'ᚠ' - kRuneBlockFirst]) {
+        output();
+    } else if (text == "return") {
+        returnStatement();
+    } else if (text == "break" || text == "continue") {
+        jumpStatement(text == "break");
+    } else if (isTypeName(text)) {
+        declaration();
+    } else {
+        expression();
+        emit(OpCode::Pop);
+    }
+
+    if (!atEnd() && !match(";")) fail("unexpected " + std::string(peekText()), node_);
+}
+
+void BytecodeCompiler::body() {
+    if (!node_) fail("expected a statement");
+    // A block body opens a scope of its own in statement()
+    statement();
+}
+
+void BytecodeCompiler::declaration() {
+    const std::string_view type = textOf(advance());
+    do {
+        const Node* nameNode = node_;
+        const std::string_view name = textOf(nameNode);
+        if (!isIdentifier(name) || atEnd()) fail("expected a variable name after " + std::string(type), nameNode);
+        advance();
+
+        if (match("=")) {
+            expression();
+        } else if (type == "std::string") {
+            emitString(std::string());
+        } else if (type == "bool") {
+            emitConstant(Value::boolean(false));
+        } else if (type == "float" || type == "double") {
+            emitConstant(Value::real(0));
+        } else {
+            emitConstant(Value::integer(0));
+        }
+
+        offset_ = nameNode->offset;
+        const uint16_t slot = declareVariable(name, conversionFor(type));
+        emitStore(scopeDepth_ == 0 ? OpCode::LoadGlobal : OpCode::LoadLocal, slot);
+        emit(OpCode::Pop);
+    } while (!atEnd() && match(","));
+}
+
+void BytecodeCompiler::output() {
+    advance(); // ᚠ
+    // Items may be separated by << or simply follow each other, so they
+    // are parsed above shift precedence
+    while (!atEnd() && peekText() != ";") {
+        match("<<");
+        binary(kShiftPrecedence + 1);
+        emit(OpCode::Print);
+    }
+}
+
+void BytecodeCompiler::ifStatement() {
+    advance();
+    expect("(");
+    parenDepth_++;
+    expression();
+    parenDepth_--;
+    expect(")");
+
+    const size_t skipThen = emitJump(OpCode::JumpIfFalse);
+    body();
+    if (peekText() == "else") {
+        const size_t skipElse = emitJump(OpCode::Jump);
+        patchJump(skipThen);
+        advance();
+        body();
+        patchJump(skipElse);
+    } else {
+        patchJump(skipThen);
+    }
+}
+
+void BytecodeCompiler::whileStatement() {
+    advance();
+    const size_t loopStart = function_->code.size();
+    expect("(");
+    parenDepth_++;
+    expression();
+    parenDepth_--;
+    expect(")");
+
+    const size_t exit = emitJump(OpCode::JumpIfFalse);
+    loops_.emplace_back();
+    body();
+    emitLoop(loopStart);
+    patchJump(exit);
+
+    Loop loop = std::move(loops_.back());
+    loops_.pop_back();
+    for (size_t at : loop.breaks) patchJump(at);
+    for (size_t at : loop.continues) {
+        const int32_t distance = static_cast<int32_t>(loopStart) - static_cast<int32_t>(at + 4);
+        std::memcpy(&function_->code[at], &distance, sizeof(distance));
+    }
+}
+
+void BytecodeCompiler::forStatement() {
+    advance();
+    expect("(");
+    parenDepth_++;
+    beginScope();
+
+    if (peekText() != ";") {
+        if (isTypeName(peekText())) {
+            declaration();
+        } else {
+            expression();
+            emit(OpCode::Pop);
+        }
+    }
+    expect(";");
+
+    const size_t condition = function_->code.size();
+    size_t exit = SIZE_MAX;
+    if (peekText() != ";") {
+        expression();
+        exit = emitJump(OpCode::JumpIfFalse);
+    }
+    expect(";");
+
+    // The step is compiled before the body but runs after it
+    const size_t skipStep = emitJump(OpCode::Jump);
+    const size_t step = function_->code.size();
+    if (peekText() != ")") {
+        expression();
+        emit(OpCode::Pop);
+    }
+    emitLoop(condition);
+    parenDepth_--;
+    expect(")");
+
+    patchJump(skipStep);
+    loops_.emplace_back();
+    body();
+    emitLoop(step);
+    if (exit != SIZE_MAX) patchJump(exit);
+
+    Loop loop = std::move(loops_.back());
+    loops_.pop_back();
+    for (size_t at : loop.breaks) patchJump(at);
+    for (size_t at : loop.continues) {
+        const int32_t distance = static_cast<int32_t>(step) - static_cast<int32_t>(at + 4);
+        std::memcpy(&function_->code[at], &distance, sizeof(distance));
+    }
+    endScope();
+}
+
+void BytecodeCompiler::returnStatement() {
+    advance();
+    if (atEnd() || peekText() == ";") {
+        emitConstant(Value::integer(0));
+    } else {
+        expression();
+    }
+    emit(OpCode::Return);
+}
+
+void BytecodeCompiler::jumpStatement(bool isBreak) {
+    const Node* keyword = advance();
+    if (loops_.empty()) fail(std::string(textOf(keyword)) + " outside of a loop", keyword);
+    const size_t at = emitJump(OpCode::Jump);
+    (isBreak ? loops_.back().breaks : loops_.back().continues).push_back(at);
+}
+
+void BytecodeCompiler::expression() {
+    assignment();
+}
+
+void BytecodeCompiler::assignment() {
+    const size_t start = function_->code.size();
+    binary(1);
+    if (atEnd()) return;
+
+    const Node* after = nullptr;
+    const Node* opNode = node_;
+    const BinaryOperator* op = findOperator(kAssignmentOperators, peekText(&after));
+    if (!op) return;
+    if (lastLoad_ != start) fail("left side of " + std::string(op->text) + " is not a variable", opNode);
+
+    // Turn the load of the target back into a store
+    const OpCode load = static_cast<OpCode>(function_->code[start]);
+    const uint16_t slot = readU16(&function_->code[start + 1]);
+    function_->code.resize(start);
+    while (!function_->offsets.empty() && function_->offsets.back().first >= start) {
+        function_->offsets.pop_back();
+    }
+    adjustStack(-1);
+    node_ = skipComments(after);
+
+    if (op->op != OpCode::Halt) emitVariable(load, slot);
+    assignment();
+    offset_ = opNode->offset;
+    if (op->op != OpCode::Halt) emit(op->op);
+    emitStore(load, slot);
+}
+
+void BytecodeCompiler::binary(int minPrecedence) {
+    unary();
+    while (!atEnd()) {
+        const Node* after = nullptr;
+        const Node* opNode = node_;
+        const BinaryOperator* op = findOperator(kBinaryOperators, peekText(&after));
+        if (!op || op->precedence < minPrecedence) return;
+        node_ = skipComments(after);
+
+        if (op->op == OpCode::JumpIfFalseOrPop || op->op == OpCode::JumpIfTrueOrPop) {
+            offset_ = opNode->offset;
+            const size_t shortCircuit = emitJump(op->op);
+            binary(op->precedence + 1);
+            patchJump(shortCircuit);
+            emit(OpCode::ToBool);
+        } else {
+            binary(op->precedence + 1);
+            offset_ = opNode->offset;
+            emit(op->op);
+        }
+    }
+}
+
+void BytecodeCompiler::unary() {
+    if (atEnd()) fail("expected an expression");
+    const Node* opNode = node_;
+    const Node* after = nullptr;
+    const std::string_view op = peekText(&after);
+
+    if (op == "-" || op == "!" || op == "~" || op == "+") {
+        node_ = skipComments(after);
+        unary();
+        offset_ = opNode->offset;
+        if (op == "-") emit(OpCode::Negate);
+        if (op == "!") emit(OpCode::Not);
+        if (op == "~") emit(OpCode::BitNot);
+        return;
+    }
+    if (op == "++" || op == "--") {
+        node_ = skipComments(after);
+        const size_t start = function_->code.size();
+        postfix();
+        if (lastLoad_ != start) fail(std::string(op) + " needs a variable", opNode);
+        const OpCode load = static_cast<OpCode>(function_->code[start]);
+        const uint16_t slot = readU16(&function_->code[start + 1]);
+        offset_ = opNode->offset;
+        emitConstant(Value::integer(1));
+        emit(op == "++" ? OpCode::Add : OpCode::Subtract);
+        emitStore(load, slot);
+        return;
+    }
+    postfix();
+}
+
+void BytecodeCompiler::postfix() {
+    const size_t start = function_->code.size();
+    primary();
+    if (atEnd() || lastLoad_ != start) return;
+
+    const Node* after = nullptr;
+    const Node* opNode = node_;
+    const std::string_view op = peekText(&after);
+    if (op != "++" && op != "--") return;
+    node_ = skipComments(after);
+
+    // Leaves the old value: load, load, ±1, store, pop
+    const OpCode load = static_cast<OpCode>(function_->code[start]);
+    const uint16_t slot = readU16(&function_->code[start + 1]);
+    offset_ = opNode->offset;
+    emitVariable(load, slot);
+    emitConstant(Value::integer(1));
+    emit(op == "++" ? OpCode::Add : OpCode::Subtract);
+    emitStore(load, slot);
+    emit(OpCode::Pop);
+}
+
+void BytecodeCompiler::primary() {
+    const Node* node = node_;
+    offset_ = node->offset;
+
+    switch (node->kind) {
+    case NodeKind::String:
+        advance();
+        emitString(unescape(static_cast<const StringNode*>(node)->value));
+        return;
+    case NodeKind::Operation: {
+        const auto* operation = static_cast<const OperationNode*>(node);
+        advance();
+        const std::string qualified = std::string(operation->prefix) + std::string(operation->name);
+        if (operation->name.empty()) fail("expected an operation name after " + qualified, node);
+        const int index = findBuiltin(operation->prefix, operation->name);
+        if (index < 0) fail("unknown operation " + qualified, node);
+
+        const size_t argc = !atEnd() && peekText() == "(" ? arguments() : 0;
+        const Builtin& target = builtin(static_cast<uint16_t>(index));
+        if (argc < target.minArgs || argc > target.maxArgs) {
+            fail(qualified + " takes " + std::to_string(target.minArgs) +
+                     (target.maxArgs != target.minArgs ? " to " + std::to_string(target.maxArgs) : "") +
+                     " arguments",
+                 node);
+        }
+        offset_ = node->offset;
+        emit(OpCode::CallBuiltin);
+        emitU16(static_cast<uint16_t>(index));
+        emitU8(static_cast<uint8_t>(argc));
+        adjustStack(1 - static_cast<int>(argc));
+        return;
+    }
+    case NodeKind::Text:
+        break;
+    default:
+        fail("expected an expression", node);
+    }
+
+    const std::string_view text = textOf(node);
+    if (text == "(") {
+        advance();
+        parenDepth_++;
+        expression();
+        parenDepth_--;
+        expect(")");
+        return;
+    }
+    if (text == "true" || text == "false") {
+        advance();
+        emitConstant(Value::boolean(text == "true"));
+        return;
+    }
+    if (std::isdigit(static_cast<unsigned char>(text[0]))) {
+        advance();
+        // Integer and float suffixes do not matter to the VM
+        std::string digits(text);
+        const bool hex = digits.size() > 1 && (digits[1] == 'x' || digits[1] == 'X');
+        while (!digits.empty() && std::strchr(hex ? "uUlL" : "fFuUlL", digits.back())) digits.pop_back();
+        const bool real = !hex && digits.find_first_of(".eE") != std::string::npos;
+        char* end = nullptr;
+        errno = 0;
+        if (real) {
+            const double value = std::strtod(digits.c_str(), &end);
+            if (*end) fail("invalid number " + std::string(text), node);
+            emitConstant(Value::real(value));
+        } else {
+            const long long value = std::strtoll(digits.c_str(), &end, 0);
+            if (*end || errno == ERANGE) fail("invalid number " + std::string(text), node);
+            emitConstant(Value::integer(value));
+        }
+        return;
+    }
+    if (!isIdentifier(text)) fail("unexpected " + std::string(text), node);
+    advance();
+
+    if (!atEnd() && peekText() == "(") {
+        for (const auto& known : functionIndex_) {
+            if (known.first != text) continue;
+            if (arguments() != 0) fail("rune functions take no arguments", node);
+            offset_ = node->offset;
+            emit(OpCode::Call);
+            emitU16(known.second);
+            return;
+        }
+    }
+
+    OpCode load;
+    uint16_t slot;
+    if (!resolve(text, load, slot)) fail("unknown name " + std::string(text), node);
+    emitVariable(load, slot);
+}
+
+size_t BytecodeCompiler::arguments() {
+    expect("(");
+    parenDepth_++;
+    size_t argc = 0;
+    if (peekText() != ")") {
+        do {
+            expression();
+            if (++argc > UINT8_MAX) fail("too many arguments");
+        } while (match(","));
+    }
+    parenDepth_--;
+    expect(")");
+    return argc;
+}
+
+bool BytecodeCompiler::atEnd() const {
+    // Statements end at a line break unless a parenthesis is still open
+    return !node_ || (parenDepth_ == 0 && (node_->flags & NewlineBefore) && node_ != statementStart_);
+}
+
+const Node* BytecodeCompiler::advance() {
+    const Node* node = node_;
+    node_ = skipComments(node_->next);
+    return node;
+}
+
+std::string_view BytecodeCompiler::peekText(const Node** after) const {
+    const std::string_view text = textOf(node_);
+    const Node* next = node_ ? node_->next : nullptr;
+    std::string_view op = text;
+
+    // Punctuation reaches the parser one character at a time, so operators
+    // are put back together from adjacent tokens, longest match first
+    if (isOperatorText(text)) {
+        std::string joined(text);
+        for (; next && !(next->flags & (SpaceBefore | NewlineBefore)); next = next->next) {
+            const std::string_view piece = textOf(next);
+            if (!isOperatorText(piece)) break;
+            const auto it = std::find(std::begin(kCompoundOperators), std::end(kCompoundOperators),
+                                      joined + std::string(piece));
+            if (it == std::end(kCompoundOperators)) break;
+            joined += piece;
+            op = *it;
+        }
+    }
+    if (after) *after = next;
+    return op;
+}
+
+bool BytecodeCompiler::match(std::string_view text) {
+    const Node* after = nullptr;
+    if (!node_ || peekText(&after) != text) return false;
+    node_ = skipComments(after);
+    return true;
+}
+
+void BytecodeCompiler::expect(std::string_view text) {
+    if (!match(text)) fail("expected " + std::string(text), node_);
+}
+
+void BytecodeCompiler::fail(const std::string& message, const Node* at) const {
+    throw RuneSourceError(message, at ? at->offset : offset_);
+}
+
+void BytecodeCompiler::beginScope() {
+    scopeDepth_++;
+}
+
+void BytecodeCompiler::endScope() {
+    scopeDepth_--;
+    // Slots of the closed scope are reused by the next declarations
+    while (!locals_.empty() && locals_.back().depth > scopeDepth_) {
+        nextLocal_ = locals_.back().slot;
+        locals_.pop_back();
+    }
+}
+
+bool BytecodeCompiler::resolve(std::string_view name, OpCode& load, uint16_t& slot) const {
+    for (auto it = locals_.rbegin(); it != locals_.rend(); ++it) {
+        if (it->name == name) {
+            load = OpCode::LoadLocal;
+            slot = it->slot;
+            return true;
+        }
+    }
+    for (const Global& global : globalIndex_) {
+        if (global.name == name) {
+            load = OpCode::LoadGlobal;
+            slot = global.slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t BytecodeCompiler::declareVariable(std::string_view name, OpCode conversion) {
+    if (scopeDepth_ == 0) {
+        for (const Global& global : globalIndex_) {
+            if (global.name == name) fail(std::string(name) + " is already declared");
+        }
+        if (script_->globals == UINT16_MAX) fail("too many variables");
+        globalIndex_.push_back({name, script_->globals, conversion});
+        return script_->globals++;
+    }
+
+    for (auto it = locals_.rbegin(); it != locals_.rend() && it->depth == scopeDepth_; ++it) {
+        if (it->name == name) fail(std::string(name) + " is already declared");
+    }
+    if (nextLocal_ == UINT16_MAX) fail("too many variables");
+    locals_.push_back({name, nextLocal_, scopeDepth_, conversion});
+    function_->locals = std::max<uint16_t>(function_->locals, ++nextLocal_);
+    return locals_.back().slot;
+}
+
+void BytecodeCompiler::emit(OpCode op) {
+    std::vector<uint8_t>& code = function_->code;
+    if (function_->offsets.empty() || function_->offsets.back().second != offset_) {
+        function_->offsets.emplace_back(static_cast<uint32_t>(code.size()), offset_);
+    }
+    code.push_back(static_cast<uint8_t>(op));
+    lastLoad_ = SIZE_MAX;
+    adjustStack(stackEffect(op));
+}
+
+void BytecodeCompiler::emitU8(uint8_t value) {
+    function_->code.push_back(value);
+}
+
+void BytecodeCompiler::emitU16(uint16_t value) {
+    function_->code.push_back(static_cast<uint8_t>(value));
+    function_->code.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void BytecodeCompiler::emitVariable(OpCode op, uint16_t slot) {
+    const size_t at = function_->code.size();
+    emit(op);
+    emitU16(slot);
+    if (op == OpCode::LoadGlobal || op == OpCode::LoadLocal) lastLoad_ = at;
+}
+
+void BytecodeCompiler::emitStore(OpCode load, uint16_t slot) {
+    OpCode conversion = OpCode::Halt;
+    if (load == OpCode::LoadGlobal) {
+        conversion = globalIndex_[slot].conversion;
+    } else {
+        // Slots are reused across scopes; the innermost local holding
+        // one is the variable in scope
+        for (auto it = locals_.rbegin(); it != locals_.rend(); ++it) {
+            if (it->slot == slot) {
+                conversion = it->conversion;
+                break;
+            }
+        }
+    }
+    if (conversion != OpCode::Halt) emit(conversion);
+    emitVariable(load == OpCode::LoadGlobal ? OpCode::StoreGlobal : OpCode::StoreLocal, slot);
+}
+
+size_t BytecodeCompiler::emitJump(OpCode op) {
+    emit(op);
+    const size_t at = function_->code.size();
+    function_->code.insert(function_->code.end(), 4, 0);
+    return at;
+}
+
+void BytecodeCompiler::patchJump(size_t at) {
+    const size_t distance = function_->code.size() - (at + 4);
+    if (distance > INT32_MAX) fail("function too large");
+    const int32_t value = static_cast<int32_t>(distance);
+    std::memcpy(&function_->code[at], &value, sizeof(value));
+}
+
+void BytecodeCompiler::emitLoop(size_t target) {
+    const size_t at = emitJump(OpCode::Jump);
+    const int32_t distance = static_cast<int32_t>(target) - static_cast<int32_t>(at + 4);
+    std::memcpy(&function_->code[at], &distance, sizeof(distance));
+}
+
+void BytecodeCompiler::emitConstant(Value value) {
+    if (script_->constants.size() > UINT16_MAX) fail("too many constants");
+    emit(OpCode::Constant);
+    emitU16(static_cast<uint16_t>(script_->constants.size()));
+    script_->constants.push_back(value);
+}
+
+void BytecodeCompiler::emitString(std::string text) {
+    script_->strings.push_back(std::move(text));
+    emitConstant(Value::string(&script_->strings.back()));
+}
+
+void BytecodeCompiler::adjustStack(int delta) {
+    stackDepth_ += delta;
+    if (stackDepth_ > function_->maxStack) function_->maxStack = static_cast<uint16_t>(stackDepth_);
+}
+
+Script compileScript(std::string_view source) {
+    RuneParser parser;
+    RuneArena arena;
+    try {
+        Program* program = parser.parse(source, arena);
+        return BytecodeCompiler().compile(*program);
+    } catch (const RuneSourceError& e) {
+        const SourcePosition position = LineIndex(source).locate(e.getOffset());
+        throw RuneParseError(e.what(), position.line, position.column);
+    }
+}
+
+} // namespace RuneLang
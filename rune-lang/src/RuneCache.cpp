@@ -0,0 +1,269 @@
+#include "../include/RuneCache.hpp"
+#include "../include/RuneError.hpp"
+#include "../include/RuneHash.hpp"
+#include "../include/RuneMappedFile.hpp"
+#include "../include/RuneTable.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace RuneLang {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kEntryExtension[] = ".rnc";
+constexpr char kTempPrefix[] = "tmp-";
+constexpr char kMagic[4] = {'R', 'N', 'C', '1'};
+
+// Leftovers of writers that died; live writers rename long before this
+constexpr auto kStaleTempAge = std::chrono::hours(1);
+
+struct EntryHeader {
+    char magic[4];
+    uint32_t reserved;
+    uint64_t keyHigh;
+    uint64_t keyLow;
+    uint64_t codeSize;
+};
+
+// Hash of everything besides the source that decides the generated code
+uint64_t compilerFingerprint() {
+    static const uint64_t fingerprint = [] {
+        uint64_t h = hash64(RuneCache::kCompilerVersion.data(), RuneCache::kCompilerVersion.size());
+        for (const RuneMapping& mapping : kRuneMappings) {
+            h = hash64(&mapping.rune, sizeof(mapping.rune), h);
+            h = hash64(mapping.keyword.data(), mapping.keyword.size(), h);
+        }
+        return h;
+    }();
+    return fingerprint;
+}
+
+bool parseHex(std::string_view text, uint64_t& value) {
+    value = 0;
+    for (char c : text) {
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else {
+            return false;
+        }
+        value = (value << 4) | static_cast<uint64_t>(digit);
+    }
+    return true;
+}
+
+void writeAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to write cache entry");
+        }
+        p += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+} // namespace
+
+std::string CacheKey::hex() const {
+    char text[33];
+    std::snprintf(text, sizeof(text), "%016llx%016llx",
+                  static_cast<unsigned long long>(high), static_cast<unsigned long long>(low));
+    return text;
+}
+
+RuneCache::RuneCache(const std::string& directory, uint64_t maxBytes)
+    : directory_(directory), maxBytes_(maxBytes) {
+    std::error_code error;
+    fs::create_directories(directory_, error);
+    if (error || !fs::is_directory(directory_)) {
+        RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to create cache directory " + directory_);
+    }
+    load();
+}
+
+CacheKey RuneCache::keyFor(std::string_view source, uint64_t options) {
+    const uint64_t seed = options ? hash64(&options, sizeof(options), compilerFingerprint()) : compilerFingerprint();
+    return CacheKey{hash64(source.data(), source.size(), seed),
+                    hash64(source.data(), source.size(), ~seed)};
+}
+
+std::string RuneCache::pathFor(const CacheKey& key) const {
+    return directory_ + "/" + key.hex() + kEntryExtension;
+}
+
+void RuneCache::load() {
+    struct Found {
+        CacheKey key;
+        uint64_t size;
+        fs::file_time_type used;
+    };
+    std::vector<Found> found;
+    std::error_code error;
+    const auto now = fs::file_time_type::clock::now();
+
+    for (fs::directory_iterator it(directory_, error), end; !error && it != end; it.increment(error)) {
+        const std::string name = it->path().filename().string();
+        const fs::file_time_type used = it->last_write_time(error);
+        if (error) break;
+
+        if (name.compare(0, sizeof(kTempPrefix) - 1, kTempPrefix) == 0) {
+            if (now - used > kStaleTempAge) fs::remove(it->path(), error);
+            continue;
+        }
+        CacheKey key;
+        if (name.size() != 32 + sizeof(kEntryExtension) - 1 || it->path().extension() != kEntryExtension ||
+            !parseHex(std::string_view(name).substr(0, 16), key.high) ||
+            !parseHex(std::string_view(name).substr(16, 16), key.low)) {
+            continue;
+        }
+        found.push_back(Found{key, it->file_size(error), used});
+        if (error) break;
+    }
+    if (error) {
+        RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to scan cache directory " + directory_);
+    }
+
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.used > b.used; });
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Found& entry : found) {
+        lru_.push_back(entry.key);
+        index_.emplace(entry.key, Entry{entry.size, std::prev(lru_.end())});
+        stats_.diskBytes += entry.size;
+    }
+    stats_.entries = index_.size();
+    evict();
+}
+
+bool RuneCache::lookup(const CacheKey& key, uint64_t sourceSize, OutputSink& out) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            stats_.misses++;
+            return false;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.position);
+    }
+
+    const std::string path = pathFor(key);
+    bool valid = false;
+    try {
+        RuneMappedFile entry(path);
+        const std::string_view contents = entry.contents();
+        EntryHeader header;
+        if (contents.size() >= sizeof(header)) {
+            std::memcpy(&header, contents.data(), sizeof(header));
+            valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                    header.keyHigh == key.high && header.keyLow == key.low &&
+                    header.codeSize == contents.size() - sizeof(header);
+        }
+        if (valid) out.append(contents.substr(sizeof(header)));
+    } catch (const RuneError&) {
+        // Evicted by another process in the meantime
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!valid) {
+        forget(key);
+        ::unlink(path.c_str());
+        stats_.misses++;
+        return false;
+    }
+    stats_.hits++;
+    stats_.bytesSaved += sourceSize;
+    // Keeps the LRU order for the next process that loads the directory
+    ::utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    return true;
+}
+
+void RuneCache::store(const CacheKey& key, std::string_view code) {
+    std::string tempPath;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index_.count(key)) return;
+        tempPath = directory_ + "/" + kTempPrefix + std::to_string(::getpid()) + "-" +
+                   std::to_string(tempCounter_++);
+    }
+
+    EntryHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.reserved = 0;
+    header.keyHigh = key.high;
+    header.keyLow = key.low;
+    header.codeSize = code.size();
+
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        LOG_WARNING("Failed to create cache entry ", tempPath);
+        return;
+    }
+    try {
+        writeAll(fd, &header, sizeof(header));
+        writeAll(fd, code.data(), code.size());
+    } catch (const RuneError&) {
+        ::close(fd);
+        ::unlink(tempPath.c_str());
+        return;
+    }
+    ::close(fd);
+
+    if (::rename(tempPath.c_str(), pathFor(key).c_str()) != 0) {
+        LOG_WARNING("Failed to publish cache entry ", tempPath);
+        ::unlink(tempPath.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.stores++;
+    insert(key, sizeof(header) + code.size());
+    evict();
+}
+
+CacheStats RuneCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void RuneCache::insert(const CacheKey& key, uint64_t size) {
+    // Another thread may have published the same entry
+    forget(key);
+    lru_.push_front(key);
+    index_.emplace(key, Entry{size, lru_.begin()});
+    stats_.diskBytes += size;
+    stats_.entries = index_.size();
+}
+
+void RuneCache::evict() {
+    while (stats_.diskBytes > maxBytes_ && !lru_.empty()) {
+        const CacheKey victim = lru_.back();
+        ::unlink(pathFor(victim).c_str());
+        forget(victim);
+        stats_.evictions++;
+    }
+}
+
+void RuneCache::forget(const CacheKey& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) return;
+    stats_.diskBytes -= it->second.size;
+    lru_.erase(it->second.position);
+    index_.erase(it);
+    stats_.entries = index_.size();
+}
+
+} // namespace RuneLang
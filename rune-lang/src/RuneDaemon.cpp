@@ -0,0 +1,350 @@
+#include "../include/RuneDaemon.hpp"
+#include "../include/RuneMappedFile.hpp"
+#include "../include/RuneParser.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace RuneLang {
+
+namespace {
+
+constexpr size_t kRequestHeader = 6;  // type, flags, length
+constexpr size_t kResponseHeader = 5; // status, length
+
+sockaddr_un addressOf(const std::string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        RUNE_THROW(RuneError::ErrorCode::NETWORK_ERROR, "Socket path too long: " + socketPath);
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return address;
+}
+
+// -1 when nothing listens on `socketPath`
+int connectTo(const std::string& socketPath) {
+    const sockaddr_un address = addressOf(socketPath);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        RUNE_THROW(RuneError::ErrorCode::NETWORK_ERROR, "Failed to create a socket");
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// False when the peer closed the connection or it failed
+bool readFully(int fd, char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t received = ::recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+bool writeFully(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        // A client that went away must not kill the daemon with SIGPIPE
+        const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Header and payload of one frame, sent together
+bool sendFrame(int fd, const char* header, size_t headerSize, std::string_view payload) {
+    std::string frame(header, headerSize);
+    frame.append(payload);
+    return writeFully(fd, frame.data(), frame.size());
+}
+
+bool sendResponse(int fd, DaemonStatus status, std::string_view payload) {
+    char header[kResponseHeader];
+    header[0] = static_cast<char>(status);
+    const uint32_t length = static_cast<uint32_t>(payload.size());
+    std::memcpy(header + 1, &length, sizeof(length));
+    return sendFrame(fd, header, sizeof(header), payload);
+}
+
+} // namespace
+
+std::string DaemonStats::format() const {
+    return "requests " + std::to_string(requests) + ", hits " + std::to_string(hits) + ", misses " +
+           std::to_string(misses) + ", evictions " + std::to_string(evictions) + ", entries " +
+           std::to_string(entries) + ", bytes " + std::to_string(bytes);
+}
+
+RuneDaemon::RuneDaemon(const std::string& socketPath, unsigned workers, uint64_t cacheBytes)
+    : socketPath_(socketPath), workers_(std::max(1u, workers)), cacheBytes_(cacheBytes) {
+    const sockaddr_un address = addressOf(socketPath);
+    const int live = connectTo(socketPath);
+    if (live >= 0) {
+        ::close(live);
+        RUNE_THROW(RuneError::ErrorCode::NETWORK_ERROR, "A daemon already listens on " + socketPath);
+    }
+    // Left behind by a daemon that did not shut down cleanly
+    ::unlink(socketPath.c_str());
+
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0 || ::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd_, SOMAXCONN) != 0) {
+        const std::string reason = std::strerror(errno);
+        if (listenFd_ >= 0) ::close(listenFd_);
+        RUNE_THROW(RuneError::ErrorCode::NETWORK_ERROR, "Failed to listen on " + socketPath + ": " + reason);
+    }
+    if (::pipe2(wakeFds_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        ::close(listenFd_);
+        ::unlink(socketPath.c_str());
+        RUNE_THROW(RuneError::ErrorCode::SYSTEM_ERROR, "Failed to create a pipe");
+    }
+}
+
+RuneDaemon::~RuneDaemon() {
+    ::close(listenFd_);
+    ::close(wakeFds_[0]);
+    ::close(wakeFds_[1]);
+    ::unlink(socketPath_.c_str());
+}
+
+void RuneDaemon::stop() {
+    stopping_ = true;
+    const char wake = 1;
+    // The pipe is non-blocking; a full one has a wakeup pending already
+    [[maybe_unused]] const ssize_t written = ::write(wakeFds_[1], &wake, 1);
+}
+
+void RuneDaemon::serve() {
+    std::vector<std::thread> threads;
+    threads.reserve(workers_);
+    for (unsigned i = 0; i < workers_; i++) threads.emplace_back(&RuneDaemon::work, this);
+
+    pollfd fds[2] = {{listenFd_, POLLIN, 0}, {wakeFds_[0], POLLIN, 0}};
+    while (!stopping_) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) continue;
+        const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue; // The client gave up already, or fds ran out for now
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        pending_.push_back(fd);
+        queueReady_.notify_one();
+    }
+
+    {
+        // Connections that are waiting or idle between requests end here;
+        // requests being handled still get their reply
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        closed_ = true;
+        for (int fd : pending_) ::close(fd);
+        pending_.clear();
+        for (int fd : active_) ::shutdown(fd, SHUT_RD);
+        queueReady_.notify_all();
+    }
+    for (std::thread& thread : threads) thread.join();
+}
+
+void RuneDaemon::work() {
+    RuneParser parser;
+    for (;;) {
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueReady_.wait(lock, [this] { return closed_ || !pending_.empty(); });
+            if (closed_) return;
+            fd = pending_.front();
+            pending_.pop_front();
+            active_.insert(fd);
+        }
+        serveConnection(fd, parser);
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            active_.erase(fd);
+        }
+        ::close(fd);
+    }
+}
+
+void RuneDaemon::serveConnection(int fd, RuneParser& parser) {
+    char header[kRequestHeader];
+    std::string payload;
+    while (readFully(fd, header, sizeof(header))) {
+        const auto type = static_cast<DaemonRequest>(header[0]);
+        const auto flags = static_cast<uint8_t>(header[1]);
+        uint32_t length;
+        std::memcpy(&length, header + 2, sizeof(length));
+        if (length > kMaxPayload) {
+            sendResponse(fd, DaemonStatus::Error, "Request too large");
+            return;
+        }
+        payload.resize(length);
+        if (!readFully(fd, &payload[0], length)) return;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            stats_.requests++;
+        }
+
+        DaemonStatus status = DaemonStatus::Ok;
+        std::string reply;
+        try {
+            switch (type) {
+            case DaemonRequest::Parse:
+                reply = generate(parser, payload, flags);
+                break;
+            case DaemonRequest::Compile: {
+                const size_t split = payload.find('\0');
+                if (split == std::string::npos) {
+                    status = DaemonStatus::Error;
+                    reply = "Compile request without an output path";
+                    break;
+                }
+                RuneMappedFile file(payload.substr(0, split));
+                const std::string code = generate(parser, file.contents(), flags);
+                reply = RuneParser::writeTranslationUnit(payload.substr(split + 1), code) ? "written" : "unchanged";
+                break;
+            }
+            case DaemonRequest::Stats:
+                reply = stats().format();
+                break;
+            case DaemonRequest::Shutdown:
+                sendResponse(fd, DaemonStatus::Ok, "");
+                stop();
+                return;
+            default:
+                status = DaemonStatus::Error;
+                reply = "Unknown request " + std::to_string(header[0]);
+                break;
+            }
+        } catch (const RuneParseError& e) {
+            status = DaemonStatus::ParseError;
+            reply = e.what();
+        } catch (const std::exception& e) {
+            status = DaemonStatus::Error;
+            reply = e.what();
+        }
+        if (!sendResponse(fd, status, reply)) return;
+    }
+}
+
+std::string RuneDaemon::generate(RuneParser& parser, std::string_view source, uint8_t flags) {
+    const bool optimize = (flags & DaemonOptimize) != 0;
+    const CacheKey key = RuneCache::keyFor(source, optimize ? 1 : 0);
+    std::string code;
+    if (lookup(key, code)) return code;
+    parser.setOptimize(optimize);
+    code = parser.parseRuneCode(std::string(source));
+    store(key, code);
+    return code;
+}
+
+bool RuneDaemon::lookup(const CacheKey& key, std::string& code) {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    auto found = cache_.find(key);
+    if (found == cache_.end()) {
+        stats_.misses++;
+        return false;
+    }
+    stats_.hits++;
+    lru_.splice(lru_.begin(), lru_, found->second.position);
+    code = found->second.code;
+    return true;
+}
+
+void RuneDaemon::store(const CacheKey& key, const std::string& code) {
+    if (code.size() > cacheBytes_) return;
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    // Another worker may have compiled the same source meanwhile
+    if (cache_.count(key)) return;
+    while (stats_.bytes + code.size() > cacheBytes_ && !lru_.empty()) {
+        auto evicted = cache_.find(lru_.back());
+        stats_.bytes -= evicted->second.code.size();
+        cache_.erase(evicted);
+        lru_.pop_back();
+        stats_.evictions++;
+    }
+    lru_.push_front(key);
+    cache_.emplace(key, CachedCode{code, lru_.begin()});
+    stats_.bytes += code.size();
+}
+
+DaemonStats RuneDaemon::stats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    DaemonStats current = stats_;
+    current.entries = cache_.size();
+    return current;
+}
+
+RuneDaemonClient::RuneDaemonClient(const std::string& socketPath) : fd_(connectTo(socketPath)) {
+    if (fd_ < 0) {
+        RUNE_THROW(RuneError::ErrorCode::NETWORK_ERROR, "No daemon listens on " + socketPath);
+    }
+}
+
+RuneDaemonClient::~RuneDaemonClient() {
+    ::close(fd_);
+}
+
+std::string RuneDaemonClient::request(DaemonRequest type, uint8_t flags, std::string_view payload) {
+    char header[kRequestHeader];
+    header[0] = static_cast<char>(type);
+    header[1] = static_cast<char>(flags);
+    const uint32_t length = static_cast<uint32_t>(payload.size());
+    std::memcpy(header + 2, &length, sizeof(length));
+    if (payload.size() > RuneDaemon::kMaxPayload || !sendFrame(fd_, header, sizeof(header), payload)) {
+        RUNE_THROW(RuneError::ErrorCode::NETWORK_ERROR, "Failed to send a request to the daemon");
+    }
+
+    char responseHeader[kResponseHeader];
+    uint32_t replyLength;
+    std::string reply;
+    if (readFully(fd_, responseHeader, sizeof(responseHeader))) {
+        std::memcpy(&replyLength, responseHeader + 1, sizeof(replyLength));
+        reply.resize(replyLength);
+        if (readFully(fd_, &reply[0], replyLength)) {
+            switch (static_cast<DaemonStatus>(responseHeader[0])) {
+            case DaemonStatus::Ok:
+                return reply;
+            case DaemonStatus::ParseError:
+                throw RuneParseError(reply);
+            default:
+                RUNE_THROW(RuneError::ErrorCode::SYSTEM_ERROR, reply);
+            }
+        }
+    }
+    RUNE_THROW(RuneError::ErrorCode::NETWORK_ERROR, "The daemon closed the connection");
+}
+
+std::string RuneDaemonClient::parse(std::string_view source, uint8_t flags) {
+    return request(DaemonRequest::Parse, flags, source);
+}
+
+bool RuneDaemonClient::compile(const std::string& input, const std::string& output, uint8_t flags) {
+    return request(DaemonRequest::Compile, flags, input + '\0' + output) == "written";
+}
+
+std::string RuneDaemonClient::stats() {
+    return request(DaemonRequest::Stats, 0, "");
+}
+
+void RuneDaemonClient::shutdown() {
+    request(DaemonRequest::Shutdown, 0, "");
+}
+
+} // namespace RuneLang
@@ -0,0 +1,57 @@
+#include "../include/RuneDiagnostic.hpp"
+#include <algorithm>
+
+namespace RuneLang {
+
+const char* diagnosticText(DiagnosticCode code) {
+    switch (code) {
+    case DiagnosticCode::InvalidUtf8: return "Invalid UTF-8 sequence";
+    case DiagnosticCode::UnknownRune: return "Unknown rune symbol";
+    case DiagnosticCode::UnterminatedString: return "Unterminated string literal";
+    case DiagnosticCode::UnterminatedRuneString: return "Unterminated rune string";
+    case DiagnosticCode::UnmatchedBlockEnd: return "Unmatched end of block";
+    case DiagnosticCode::UnterminatedBlock: return "Unterminated block";
+    case DiagnosticCode::ExpectedClassName: return "Expected class name";
+    case DiagnosticCode::NestingTooDeep: return "Blocks nested too deeply";
+    case DiagnosticCode::DuplicateDefinition: return "Duplicate definition";
+    }
+    return "Unknown error";
+}
+
+std::string Diagnostic::message() const {
+    std::string text = diagnosticText(code);
+    if (!detail.empty()) {
+        text += ": ";
+        text += detail;
+    }
+    return text;
+}
+
+DiagnosticList::DiagnosticList(size_t capacity) : capacity_(capacity) {
+    items_.reserve(capacity);
+}
+
+void DiagnosticList::report(DiagnosticCode code, uint64_t offset, std::string_view detail) {
+    if (items_.size() < capacity_) {
+        items_.push_back(Diagnostic{code, offset, detail, SourcePosition()});
+    } else {
+        dropped_++;
+    }
+}
+
+void DiagnosticList::resolve(const LineIndex& lines) {
+    // The lexer reports before the parser does; present them in source order
+    std::sort(items_.begin(), items_.end(), [](const Diagnostic& a, const Diagnostic& b) {
+        return a.offset < b.offset;
+    });
+    for (Diagnostic& diagnostic : items_) {
+        diagnostic.position = lines.locate(diagnostic.offset);
+    }
+}
+
+void DiagnosticList::clear() {
+    items_.clear();
+    dropped_ = 0;
+}
+
+} // namespace RuneLang
@@ -0,0 +1,137 @@
+#include "../include/RuneDriver.hpp"
+#include "../include/RuneError.hpp"
+#include "../include/RuneParser.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+namespace RuneLang {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+CompileJob makeJob(const fs::path& input, const fs::path& output) {
+    std::error_code error;
+    CompileJob job;
+    job.input = input.string();
+    job.output = output.string();
+    job.size = fs::file_size(input, error);
+    if (error) {
+        RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to stat " + job.input);
+    }
+    return job;
+}
+
+fs::path outputFor(const fs::path& relative, const fs::path& outputRoot) {
+    fs::path output = outputRoot / relative;
+    output.replace_extension(".cpp");
+    return output;
+}
+
+} // namespace
+
+double CompileReport::percentile(double fraction) const {
+    if (latencies.empty()) return 0;
+    const size_t rank = static_cast<size_t>(fraction * (latencies.size() - 1) + 0.5);
+    return latencies[std::min(rank, latencies.size() - 1)];
+}
+
+std::vector<CompileJob> RuneDriver::planJobs(const std::vector<std::string>& inputs, const std::string& outputDir) {
+    std::vector<CompileJob> jobs;
+    std::error_code error;
+
+    for (const std::string& input : inputs) {
+        const fs::path path(input);
+        if (fs::is_directory(path, error)) {
+            const fs::path root = outputDir.empty() ? path : fs::path(outputDir);
+            for (fs::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error)) {
+                if (it->is_regular_file(error) && it->path().extension() == kSourceExtension) {
+                    jobs.push_back(makeJob(it->path(), outputFor(fs::relative(it->path(), path), root)));
+                }
+            }
+            if (error) {
+                RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to scan " + input);
+            }
+        } else {
+            const fs::path root = outputDir.empty() ? path.parent_path() : fs::path(outputDir);
+            jobs.push_back(makeJob(path, outputFor(path.filename(), root)));
+        }
+    }
+
+    // Two inputs writing one file would race and keep only one of them
+    std::unordered_map<std::string, const CompileJob*> byOutput;
+    for (CompileJob& job : jobs) {
+        job.output = fs::path(job.output).lexically_normal().string();
+        const auto [it, inserted] = byOutput.emplace(job.output, &job);
+        if (!inserted) {
+            RUNE_THROW(RuneError::ErrorCode::FILE_ERROR,
+                       it->second->input + " and " + job.input + " both compile to " + job.output);
+        }
+    }
+
+    for (const CompileJob& job : jobs) {
+        const fs::path parent = fs::path(job.output).parent_path();
+        if (!parent.empty() && !fs::create_directories(parent, error) && error) {
+            RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to create " + parent.string());
+        }
+    }
+    return jobs;
+}
+
+CompileReport RuneDriver::compile(const std::vector<CompileJob>& jobs, unsigned workers, RuneCache* cache,
+                                  bool optimize) {
+    using Clock = std::chrono::steady_clock;
+
+    CompileReport report;
+    report.files = jobs.size();
+    report.workers = std::max(1u, workers);
+    report.latencies.assign(jobs.size(), 0);
+    for (const CompileJob& job : jobs) report.bytes += job.size;
+
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        return jobs[a].size > jobs[b].size;
+    });
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> unchanged{0};
+    std::mutex failureMutex;
+    auto work = [&]() {
+        RuneParser parser;
+        parser.setCache(cache);
+        parser.setOptimize(optimize);
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < order.size();) {
+            const CompileJob& job = jobs[order[i]];
+            const Clock::time_point start = Clock::now();
+            try {
+                if (!parser.compileFile(job.input, job.output)) unchanged.fetch_add(1, std::memory_order_relaxed);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                report.failures.push_back(CompileFailure{job.input, e.what()});
+            }
+            report.latencies[i] = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+    };
+
+    const Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < report.workers; i++) threads.emplace_back(work);
+    work(); // The calling thread is a worker too
+    for (std::thread& thread : threads) thread.join();
+    report.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    report.unchanged = unchanged.load();
+
+    std::sort(report.latencies.begin(), report.latencies.end());
+    std::sort(report.failures.begin(), report.failures.end(),
+              [](const CompileFailure& a, const CompileFailure& b) { return a.input < b.input; });
+    return report;
+}
+
+} // namespace RuneLang
@@ -0,0 +1,188 @@
+#include "../include/RuneEmitter.hpp"
+#include "../include/RuneLexer.hpp"
+
+namespace RuneLang {
+
+namespace {
+
+// A name generated code may use and the header that declares it
+struct Facility {
+    std::string_view name;
+    uint8_t header; // Index into kHeaders
+};
+
+constexpr std::string_view kHeaders[] = {
+    "#include <iostream>\n",
+    "#include <string>\n",
+    "#include <vector>\n",
+    // The runtime classes live in RuneLang, generated code names them bare
+    "#include \"RuneSystem.hpp\"\nusing namespace RuneLang;\n",
+};
+
+constexpr Facility kFacilities[] = {
+    {"std::cout", 0}, {"std::cin", 0}, {"std::cerr", 0}, {"std::clog", 0}, {"std::endl", 0},
+    {"std::string", 1}, {"std::vector", 2},
+    {"RuneSystem::", 3}, {"RuneProcess::", 3}, {"RuneThread::", 3}, {"RuneFileSystem::", 3},
+    {"RuneMemory::", 3},
+};
+
+constexpr size_t kHeaderCount = sizeof(kHeaders) / sizeof(kHeaders[0]);
+static_assert(kHeaderCount <= 8, "UsedHeaders keeps a bit per header");
+
+bool isIdentChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Characters of a qualified name
+bool isNameChar(char c) {
+    return isIdentChar(c) || c == ':';
+}
+
+// Bit per header for the facilities named in `code`, which must not start
+// or end inside a qualified name
+uint8_t headersIn(std::string_view code) {
+    uint8_t used = 0;
+    // Every facility is qualified, so only names in front of :: are looked at
+    for (size_t colon = code.find("::"); colon != std::string_view::npos; colon = code.find("::", colon + 2)) {
+        size_t start = colon;
+        while (start > 0 && isIdentChar(code[start - 1])) start--;
+        for (const Facility& facility : kFacilities) {
+            if (code.compare(start, facility.name.size(), facility.name) != 0) continue;
+            const size_t end = start + facility.name.size();
+            // std::string_view is not std::string
+            if (facility.name.back() != ':' && end < code.size() && isIdentChar(code[end])) continue;
+            used |= 1 << facility.header;
+        }
+    }
+    return used;
+}
+
+std::string prologueOf(uint8_t used) {
+    std::string prologue;
+    for (size_t i = 0; i < kHeaderCount; i++) {
+        if (used >> i & 1) prologue += kHeaders[i];
+    }
+    if (!prologue.empty()) prologue += '\n';
+    return prologue;
+}
+
+} // namespace
+
+std::string prologueFor(std::string_view code) {
+    return prologueOf(headersIn(code));
+}
+
+void UsedHeaders::scan(std::string_view code) {
+    size_t first = 0;
+    while (first < code.size() && isNameChar(code[first])) first++;
+    if (first == code.size()) {
+        tail_.append(code);
+        return;
+    }
+    // The name held back ends before `first`, and the last one in `code`
+    // may go on in the next piece
+    tail_.append(code, 0, first);
+    used_ |= headersIn(tail_);
+    tail_.clear();
+    size_t last = code.size();
+    while (isNameChar(code[last - 1])) last--;
+    used_ |= headersIn(code.substr(first, last - first));
+    tail_.assign(code, last, code.size() - last);
+}
+
+std::string UsedHeaders::prologue() const {
+    return prologueOf(used_ | headersIn(tail_));
+}
+
+void CppEmitter::emit(const Program& program) {
+    emitList(program.items);
+}
+
+void CppEmitter::emit(const Node* item) {
+    emitSeparator(item->flags);
+    emitNode(item);
+}
+
+void CppEmitter::write(std::string_view text) {
+    if (text.empty()) return;
+    out_.append(text);
+    last_ = text.back();
+}
+
+void CppEmitter::write(char c) {
+    out_.append(c);
+    last_ = c;
+}
+
+void CppEmitter::emitSeparator(uint8_t flags) {
+    // Keep line structure, collapse other whitespace to a single space
+    if (last_ == '\0' || last_ == '\n') return;
+    if (flags & NewlineBefore) {
+        write('\n');
+    } else if ((flags & SpaceBefore) && last_ != ' ') {
+        write(' ');
+    }
+}
+
+void CppEmitter::emitList(const NodeList& list) {
+    for (const Node* node = list.first; node; node = node->next) {
+        emitSeparator(node->flags);
+        emitNode(node);
+    }
+}
+
+void CppEmitter::emitBlock(const BlockNode* block) {
+    write('{');
+    emitList(block->children);
+    emitSeparator(block->closeFlags);
+    write('}');
+}
+
+void CppEmitter::emitNode(const Node* node) {
+    switch (node->kind) {
+    case NodeKind::Text:
+        write(static_cast<const TextNode*>(node)->text);
+        break;
+    case NodeKind::String:
+        write('"');
+        write(static_cast<const StringNode*>(node)->value);
+        write('"');
+        break;
+    case NodeKind::Comment:
+        write("//");
+        write(static_cast<const CommentNode*>(node)->text);
+        write('\n');
+        break;
+    case NodeKind::Operation: {
+        const auto* operation = static_cast<const OperationNode*>(node);
+        write(operation->prefix);
+        write(operation->name);
+        break;
+    }
+    case NodeKind::Block:
+        emitBlock(static_cast<const BlockNode*>(node));
+        break;
+    case NodeKind::Function: {
+        const auto* function = static_cast<const FunctionNode*>(node);
+        write(function->returnType);
+        write(' ');
+        write(function->name);
+        write("() ");
+        emitBlock(function->body);
+        break;
+    }
+    case NodeKind::Class: {
+        const auto* cls = static_cast<const ClassNode*>(node);
+        write("class ");
+        write(cls->name);
+        if (cls->body) {
+            write(' ');
+            emitBlock(cls->body);
+        }
+        write(';');
+        break;
+    }
+    }
+}
+
+} // namespace RuneLang
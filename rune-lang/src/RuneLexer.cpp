@@ -0,0 +1,349 @@
+#include "../include/RuneLexer.hpp"
+#include "../include/RuneScan.hpp"
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <thread>
+
+namespace RuneLang {
+
+namespace {
+
+inline bool isSpace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+inline bool isDigit(unsigned char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline bool isIdentStart(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool isIdentChar(unsigned char c) {
+    return isIdentStart(c) || isDigit(c);
+}
+
+inline bool isContinuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// Offset just past the last source byte of `token`, closing delimiters included
+uint64_t tokenEnd(const Token& token, const char* source) {
+    uint64_t end = static_cast<uint64_t>(token.text.data() + token.text.size() - source);
+    if (token.kind == TokenKind::String) end += token.hasFlag(RuneDelimited) ? 3 : 1;
+    return end;
+}
+
+// Offset just past the first newline at or after `from`, or the end
+uint64_t nextLineStart(std::string_view source, uint64_t from, const ScanKernels& scan) {
+    const char* end = source.data() + source.size();
+    const char* p = scan.findByte(source.data() + from, end, '\n');
+    return p == end ? source.size() : static_cast<uint64_t>(p + 1 - source.data());
+}
+
+} // namespace
+
+size_t decodeUtf8(const char* p, const char* end, char32_t& codepoint) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    size_t length;
+    char32_t min;
+
+    if (c < 0x80) {
+        codepoint = c;
+        return 1;
+    } else if ((c & 0xE0) == 0xC0) {
+        length = 2;
+        min = 0x80;
+        codepoint = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        length = 3;
+        min = 0x800;
+        codepoint = c & 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+        length = 4;
+        min = 0x10000;
+        codepoint = c & 0x07;
+    } else {
+        return 0;
+    }
+
+    if (end - p < static_cast<std::ptrdiff_t>(length)) return 0;
+    for (size_t i = 1; i < length; i++) {
+        const unsigned char cc = static_cast<unsigned char>(p[i]);
+        if (!isContinuation(cc)) return 0;
+        codepoint = (codepoint << 6) | (cc & 0x3F);
+    }
+
+    // Reject overlong encodings, surrogates and out-of-range values
+    if (codepoint < min || codepoint > 0x10FFFF ||
+        (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+std::string encodeUtf8(char32_t codepoint) {
+    std::string out;
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    return out;
+}
+
+void RuneLexer::report(DiagnosticCode code, uint64_t offset, std::string_view detail) const {
+    if (!diagnostics_) {
+        throw RuneSourceError(Diagnostic{code, offset, detail, SourcePosition()}.message(), offset);
+    }
+    diagnostics_->report(code, offset, detail);
+}
+
+void RuneLexer::reset() {
+    base_ = nullptr;
+    baseOffset_ = 0;
+    offset_ = 0;
+    flags_ = 0;
+}
+
+void RuneLexer::rewind(const Token& token) {
+    offset_ = token.offset;
+    flags_ = token.flags & (SpaceBefore | NewlineBefore);
+}
+
+void RuneLexer::startLine(uint64_t offset) {
+    offset_ = offset;
+    flags_ = SpaceBefore | NewlineBefore;
+}
+
+void RuneLexer::tokenize(std::string_view source, std::vector<Token>& tokens) {
+    reset();
+    // Typical rune sources average well over four bytes per token
+    tokens.reserve(tokens.size() + source.size() / 4);
+    tokenizeChunk(source, true, tokens);
+}
+
+void RuneLexer::tokenizeParallel(std::string_view source, std::vector<Token>& tokens,
+                                 unsigned workers, size_t minChunk) {
+    const size_t pieces = std::min<size_t>(workers, source.size() / std::max<size_t>(minChunk, 1));
+    if (pieces < 2 || diagnostics_) {
+        tokenize(source, tokens);
+        return;
+    }
+
+    // Piece i covers [starts[i], starts[i + 1]) and begins at a line start
+    const ScanKernels& scan = activeScanKernels();
+    std::vector<uint64_t> starts = {0};
+    for (size_t i = 1; i < pieces; i++) {
+        const uint64_t start = nextLineStart(source, std::max(starts.back(), source.size() * i / pieces), scan);
+        if (start < source.size() && start > starts.back()) starts.push_back(start);
+    }
+    const size_t count = starts.size();
+    starts.push_back(source.size());
+
+    struct Piece {
+        RuneLexer lexer;
+        std::vector<Token> tokens;
+        std::exception_ptr error; // Guessed state may make valid code look broken
+    };
+    std::vector<Piece> parts(count);
+    auto lexPiece = [&](size_t i) {
+        Piece& part = parts[i];
+        const std::string_view text = source.substr(starts[i], starts[i + 1] - starts[i]);
+        part.tokens.reserve(text.size() / 4);
+        if (i == 0) {
+            part.lexer.reset();
+        } else {
+            part.lexer.startLine(starts[i]);
+        }
+        try {
+            part.lexer.tokenizeChunk(text, i + 1 == count, part.tokens);
+        } catch (...) {
+            part.error = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (size_t i = 1; i < count; i++) threads.emplace_back(lexPiece, i);
+    lexPiece(0);
+    for (std::thread& thread : threads) thread.join();
+
+    // Piece 0 was lexed from the real state; the others were guesses
+    if (parts[0].error) std::rethrow_exception(parts[0].error);
+    reset();
+    size_t total = 0;
+    for (const Piece& part : parts) total += part.tokens.size();
+    tokens.reserve(tokens.size() + total);
+    tokens.insert(tokens.end(), parts[0].tokens.begin(), parts[0].tokens.end());
+    RuneLexer* real = &parts[0].lexer;
+
+    for (size_t i = 1; i < count; i++) {
+        Piece& part = parts[i];
+        if (!part.error && real->offset() == starts[i]) {
+            tokens.insert(tokens.end(), part.tokens.begin(), part.tokens.end());
+            real = &part.lexer;
+            continue;
+        }
+
+        // A string is open at the piece start. Lex on from the real state a
+        // few lines at a time until both lexers are between tokens at the
+        // same line start; from there on the guessed tokens are right.
+        const uint64_t end = starts[i + 1];
+        const bool last = i + 1 == count;
+        uint64_t window = starts[i];
+        while (window < end) {
+            const uint64_t from = real->offset();
+            window = nextLineStart(source, std::max(window, from + 2 * (window - std::min(window, from))), scan);
+            window = std::min(window, end);
+            real->tokenizeChunk(source.substr(from, window - from), last && window == end, tokens);
+            if (part.error || real->offset() != window || window == end ||
+                window > part.lexer.offset()) {
+                continue;
+            }
+            auto rejoin = std::lower_bound(part.tokens.begin(), part.tokens.end(), window,
+                                           [](const Token& token, uint64_t offset) { return token.offset < offset; });
+            if (rejoin != part.tokens.begin() && tokenEnd(*std::prev(rejoin), source.data()) > window) continue;
+            tokens.insert(tokens.end(), rejoin, part.tokens.end());
+            real = &part.lexer;
+            break;
+        }
+    }
+    offset_ = real->offset();
+    flags_ = real->flags_;
+}
+
+size_t RuneLexer::tokenizeChunk(std::string_view chunk, bool last, std::vector<Token>& tokens) {
+    const char* p = chunk.data();
+    const char* end = p + chunk.size();
+    base_ = p;
+    baseOffset_ = offset_;
+    const ScanKernels& scan = activeScanKernels();
+
+    while (p < end) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+
+        if (isSpace(c)) {
+            flags_ |= SpaceBefore;
+            size_t newlines = 0;
+            const char* lastNewline = nullptr;
+            p = scan.skipWhitespace(p, end, newlines, lastNewline);
+            if (newlines) flags_ |= NewlineBefore;
+            continue;
+        }
+
+        Token token;
+        token.flags = flags_;
+        token.rune = 0;
+        token.offset = offsetOf(p);
+
+        // Whether the token could still grow if more input followed
+        bool open = false;
+        const char* start = p;
+        if (isIdentStart(c)) {
+            token.kind = TokenKind::Identifier;
+            while (++p < end && isIdentChar(static_cast<unsigned char>(*p))) {}
+            token.text = std::string_view(start, p - start);
+            open = p == end;
+        } else if (isDigit(c)) {
+            token.kind = TokenKind::Number;
+            while (++p < end && (isIdentChar(static_cast<unsigned char>(*p)) || *p == '.')) {}
+            token.text = std::string_view(start, p - start);
+            open = p == end;
+        } else if (c == '"') {
+            token.kind = TokenKind::String;
+            const char* contentStart = ++p;
+            while (p < end && *p != '"') {
+                if (*p == '\\' && p + 1 < end) p++;
+                p++;
+            }
+            if (p >= end) {
+                if (!last) {
+                    open = true;
+                } else {
+                    // Recover by closing the literal at the end of the input
+                    report(DiagnosticCode::UnterminatedString, token.offset);
+                    token.text = std::string_view(contentStart, p - contentStart);
+                }
+            } else {
+                token.text = std::string_view(contentStart, p - contentStart);
+                p++;
+            }
+        } else if (c < 0x80) {
+            token.kind = TokenKind::Punct;
+            token.text = std::string_view(p, 1);
+            p++;
+        } else {
+            char32_t codepoint;
+            const size_t length = decodeUtf8(p, end, codepoint);
+            if (length == 0) {
+                // A sequence cut off by the end of the chunk is not an error yet
+                const size_t expected = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+                if (!last && end - p < static_cast<std::ptrdiff_t>(expected)) break;
+                report(DiagnosticCode::InvalidUtf8, offsetOf(p));
+                p++;
+                continue;
+            }
+            if (codepoint < kRuneBlockFirst || codepoint > kRuneBlockLast) {
+                report(DiagnosticCode::UnknownRune, offsetOf(p), std::string_view(p, length));
+                p += length;
+                continue;
+            }
+            p += length;
+
+            if (codepoint == kStringRune) {
+                token.kind = TokenKind::String;
+                token.flags |= RuneDelimited;
+                const char* contentStart = p;
+                // ᛟ is the only sequence starting with these three bytes
+                p = scan.findSequence3(p, end, start);
+                if (p >= end) {
+                    if (!last) {
+                        open = true;
+                    } else {
+                        report(DiagnosticCode::UnterminatedRuneString, token.offset);
+                        token.text = std::string_view(contentStart, end - contentStart);
+                        p = end;
+                    }
+                } else {
+                    token.text = std::string_view(contentStart, p - contentStart);
+                    p += 3;
+                }
+            } else if (codepoint == kCommentRune) {
+                token.kind = TokenKind::Comment;
+                const char* contentStart = p;
+                p = scan.findByte(p, end, '\n');
+                token.text = std::string_view(contentStart, p - contentStart);
+                open = p == end;
+            } else {
+                token.kind = TokenKind::Rune;
+                token.rune = static_cast<uint8_t>(codepoint - kRuneBlockFirst);
+                token.text = std::string_view(start, length);
+            }
+        }
+
+        if (open && !last) {
+            // Leave the token for the next chunk, as if it had not been seen
+            p = start;
+            break;
+        }
+        flags_ = 0;
+        tokens.push_back(token);
+    }
+
+    offset_ = offsetOf(p);
+    return p - chunk.data();
+}
+
+} // namespace RuneLang
@@ -0,0 +1,68 @@
+#include "../include/RuneLineIndex.hpp"
+#include "../include/RuneScan.hpp"
+#include <algorithm>
+
+namespace RuneLang {
+
+namespace {
+
+uint32_t countCodepoints(const char* p, const char* end) {
+    uint32_t count = 0;
+    for (; p < end; p++) {
+        count += (static_cast<unsigned char>(*p) & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+} // namespace
+
+LineIndex::LineIndex(std::string_view source, uint64_t baseOffset, SourcePosition basePosition)
+    : source_(source), baseOffset_(baseOffset), basePosition_(basePosition) {}
+
+void LineIndex::build() const {
+    const ScanKernels& scan = activeScanKernels();
+    const char* begin = source_.data();
+    const char* end = begin + source_.size();
+    for (const char* p = begin; (p = scan.findByte(p, end, '\n')) < end; p++) {
+        newlines_.push_back(static_cast<size_t>(p - begin));
+    }
+    built_ = true;
+}
+
+SourcePosition LineIndex::locate(uint64_t offset) const {
+    if (!built_) build();
+
+    size_t relative = 0;
+    if (offset > baseOffset_) {
+        relative = static_cast<size_t>(std::min<uint64_t>(offset - baseOffset_, source_.size()));
+    }
+    // Newlines strictly before the offset
+    const size_t lines = std::lower_bound(newlines_.begin(), newlines_.end(), relative) - newlines_.begin();
+
+    const char* target = source_.data() + relative;
+    SourcePosition position;
+    if (lines == 0) {
+        position.line = basePosition_.line;
+        position.column = basePosition_.column + countCodepoints(source_.data(), target);
+    } else {
+        position.line = basePosition_.line + static_cast<uint32_t>(lines);
+        position.column = 1 + countCodepoints(source_.data() + newlines_[lines - 1] + 1, target);
+    }
+    return position;
+}
+
+SourcePosition LineIndex::advance(SourcePosition from, std::string_view text) {
+    const ScanKernels& scan = activeScanKernels();
+    const char* p = text.data();
+    const char* end = p + text.size();
+    const char* lineStart = p;
+    for (; (p = scan.findByte(p, end, '\n')) < end; p++) {
+        from.line++;
+        from.column = 1;
+        lineStart = p + 1;
+    }
+    from.column += countCodepoints(lineStart, end);
+    return from;
+}
+
+} // namespace RuneLang
@@ -0,0 +1,43 @@
+#include "../include/RuneMappedFile.hpp"
+#include "../include/RuneError.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace RuneLang {
+
+RuneMappedFile::RuneMappedFile(const std::string& path) : data_(nullptr), size_(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to open " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to stat " + path);
+    }
+
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ > 0) {
+        data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            ::close(fd);
+            RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to map " + path);
+        }
+        // The lexer reads front to back exactly once
+        madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+    // The mapping keeps the file referenced
+    ::close(fd);
+}
+
+RuneMappedFile::~RuneMappedFile() {
+    if (data_) {
+        munmap(data_, size_);
+    }
+}
+
+} // namespace RuneLang
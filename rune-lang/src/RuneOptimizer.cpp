@@ -0,0 +1,817 @@
+#include "../include/RuneOptimizer.hpp"
+#include "../include/RuneLexer.hpp"
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace RuneLang {
+
+namespace {
+
+constexpr int kCannotStart = -1;
+// Deeper expressions are left as they are rather than risk the stack
+constexpr size_t kMaxDepth = 256;
+
+struct BinaryOperator {
+    std::string_view text;
+    int precedence;
+};
+
+// C++ precedence, loosest first
+constexpr BinaryOperator kBinaryOperators[] = {
+    {"||", 1}, {"&&", 2}, {"|", 3}, {"^", 4}, {"&", 5}, {"==", 6}, {"!=", 6},
+    {"<", 7}, {"<=", 7}, {">", 7}, {">=", 7}, {"<<", 8}, {">>", 8},
+    {"+", 9}, {"-", 9}, {"*", 10}, {"/", 10}, {"%", 10},
+};
+
+constexpr std::string_view kAssignmentOperators[] = {
+    "=", "+=", "-=", "*=", "/=", "%=", "<<=", ">>=", "&=", "|=", "^=",
+};
+
+// Everything adjacent punctuation nodes can spell, longest first
+constexpr std::string_view kSpellings[] = {
+    "<<=", ">>=", "->", "::", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "+", "-", "*", "/", "%", "<", ">",
+    "&", "|", "^", "=", "!", "~", "(", ")", "[", "]", ",", ";", "{", "}", "?", ":", ".",
+};
+
+// Tokens after which an expression starts afresh
+constexpr std::string_view kSeparators[] = {"(", "[", ",", ";", "{", "}", "?", ":"};
+constexpr std::string_view kStatementKeywords[] = {"return", "case", "else", "do", "throw"};
+
+// Operators that make their operands take part in arithmetic
+constexpr std::string_view kArithmeticOperators[] = {"+", "-", "*", "/", "%", "<<", ">>", "&", "|", "^"};
+constexpr std::string_view kPromotingUnary[] = {"-", "+", "~", "!"};
+
+// The entry of kSpellings equal to `text`, empty when there is none
+std::string_view findSpelling(std::string_view text) {
+    for (std::string_view spelling : kSpellings) {
+        if (spelling[0] == text[0] && spelling == text) return spelling;
+    }
+    return std::string_view();
+}
+
+template <size_t N>
+bool contains(const std::string_view (&table)[N], std::string_view text) {
+    for (std::string_view entry : table) {
+        if (entry == text) return true;
+    }
+    return false;
+}
+
+int binaryPrecedence(std::string_view text) {
+    for (const BinaryOperator& op : kBinaryOperators) {
+        if (op.text == text) return op.precedence;
+    }
+    return kCannotStart;
+}
+
+std::string_view textOf(const Node* node) {
+    return node->kind == NodeKind::Text ? static_cast<const TextNode*>(node)->text : std::string_view();
+}
+
+bool isPunct(char c) {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+}
+
+bool isPunctuation(std::string_view text) {
+    if (text.empty()) return false;
+    for (char c : text) {
+        if (!isPunct(c)) return false;
+    }
+    return true;
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool isIdentStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool isIdentifier(std::string_view text) {
+    if (text.empty() || !isIdentStart(text[0])) return false;
+    for (char c : text) {
+        if (!(isIdentStart(c) || isDigit(c))) return false;
+    }
+    return true;
+}
+
+bool joined(const Node* node) {
+    return (node->flags & (SpaceBefore | NewlineBefore)) == 0;
+}
+
+// Value of an int or double literal. Ints stay inside int and above
+// INT_MIN, which has no literal spelling.
+struct Literal {
+    bool isFloat = false;
+    int64_t i = 0;
+    double f = 0;
+
+    double asDouble() const { return isFloat ? f : static_cast<double>(i); }
+};
+
+bool fitsInt(int64_t value) {
+    return value > INT_MIN && value <= INT_MAX;
+}
+
+// Plain decimal and hex ints that have type int, and unsuffixed doubles
+bool parseLiteral(std::string_view text, Literal& value) {
+    if (text.empty() || !isDigit(text[0])) return false;
+
+    const bool hex = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+    const size_t digitsFrom = hex ? 2 : 0;
+    int64_t integer = 0;
+    size_t i = digitsFrom;
+    for (; i < text.size(); i++) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (!(hex ? std::isxdigit(c) : std::isdigit(c))) break;
+        integer = integer * (hex ? 16 : 10) + (std::isdigit(c) ? c - '0' : std::tolower(c) - 'a' + 10);
+        if (integer > INT_MAX) return false; // long or unsigned
+    }
+    if (i == text.size()) {
+        if (!hex && text.size() > 1 && text[0] == '0') return false; // Octal
+        value.isFloat = false;
+        value.i = integer;
+        return true;
+    }
+    if (hex) return false;
+
+    // digits [. digits] [e digits], nothing after: a double
+    bool dot = false;
+    bool exponent = false;
+    for (; i < text.size(); i++) {
+        const char c = text[i];
+        if (c == '.' && !dot && !exponent) {
+            dot = true;
+        } else if ((c == 'e' || c == 'E') && !exponent && i + 1 < text.size()) {
+            exponent = true;
+        } else if (!isDigit(c)) {
+            return false;
+        }
+    }
+    const std::string spelled(text);
+    char* end = nullptr;
+    value.f = std::strtod(spelled.c_str(), &end);
+    value.isFloat = true;
+    return end == spelled.c_str() + spelled.size() && std::isfinite(value.f);
+}
+
+std::string formatLiteral(const Literal& value) {
+    std::string text;
+    if (value.isFloat) {
+        // 17 significant digits read back as the same double
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", value.f);
+        text = buffer;
+        if (text.find_first_of(".e") == std::string::npos) text += ".0";
+    } else {
+        text = std::to_string(value.i);
+    }
+    // Kept apart from a preceding - or +
+    return text[0] == '-' ? "(" + text + ")" : text;
+}
+
+bool evaluate(std::string_view op, const Literal& a, const Literal& b, Literal& result) {
+    if (a.isFloat || b.isFloat) {
+        const double x = a.asDouble();
+        const double y = b.asDouble();
+        double r;
+        if (op == "+") {
+            r = x + y;
+        } else if (op == "-") {
+            r = x - y;
+        } else if (op == "*") {
+            r = x * y;
+        } else if (op == "/" && y != 0) {
+            r = x / y;
+        } else {
+            return false;
+        }
+        if (!std::isfinite(r)) return false;
+        result.isFloat = true;
+        result.f = r;
+        return true;
+    }
+
+    const int64_t x = a.i;
+    const int64_t y = b.i;
+    int64_t r;
+    if (op == "+") {
+        r = x + y;
+    } else if (op == "-") {
+        r = x - y;
+    } else if (op == "*") {
+        r = x * y;
+    } else if ((op == "/" || op == "%") && y != 0) {
+        r = op == "/" ? x / y : x % y; // Both truncate like C++
+    } else if (op == "<<" && x >= 0 && y >= 0 && y < 31) {
+        r = x << y;
+    } else if (op == ">>" && x >= 0 && y >= 0 && y < 32) {
+        r = x >> y;
+    } else if (op == "&") {
+        r = x & y;
+    } else if (op == "|") {
+        r = x | y;
+    } else if (op == "^") {
+        r = x ^ y;
+    } else {
+        return false;
+    }
+    if (!fitsInt(r)) return false;
+    result.isFloat = false;
+    result.i = r;
+    return true;
+}
+
+bool evaluate(std::string_view op, const Literal& a, Literal& result) {
+    result = a;
+    if (op == "+") return true;
+    if (op == "-") {
+        if (a.isFloat) {
+            result.f = -a.f;
+        } else {
+            result.i = -a.i;
+        }
+        return true;
+    }
+    if (op == "~" && !a.isFloat) {
+        result.i = ~a.i;
+        return fitsInt(result.i);
+    }
+    return false;
+}
+
+enum class ExprKind : uint8_t {
+    Leaf,     // Identifier, string, operation or literal that is not folded
+    Constant, // int or double literal
+    Unary,
+    Binary,
+    Group,    // ( ... )
+    Postfix   // Call, subscript, member access, ++ or --
+};
+
+struct Expr {
+    ExprKind kind;
+    size_t first;           // Nodes [first, end) of the list
+    size_t end;
+    std::string_view op;    // Unary and binary operators
+    size_t partsFrom = 0;   // Subexpressions in source order, in ExpressionParser::parts
+    size_t partsEnd = 0;
+    Literal value;
+    bool constant = false;  // `value` is known
+    bool changed = false;   // Has to be emitted from its parts
+    bool folded = false;    // Emitted as `value`
+    int identity = -1;      // Operand this operation reduces to in arithmetic
+    int keep = -1;          // Set once the reduction applies; emitted instead
+
+    Expr(ExprKind k, size_t f, size_t e) : kind(k), first(f), end(e) {}
+};
+
+// Recovers C++ expressions from a list of sibling nodes, folding as it
+// builds them
+class ExpressionParser {
+public:
+    explicit ExpressionParser(const std::vector<Node*>& nodes) : nodes_(nodes) {
+        // Every position is looked at several times, so spell them once
+        operators_.reserve(nodes.size());
+        for (size_t at = 0; at < nodes.size(); at++) operators_.push_back(spellOperator(at));
+    }
+
+    std::vector<Expr> exprs;
+    std::vector<int> parts;
+
+    // Longest expression at `start` made of operators binding at least
+    // `minPrecedence`, or -1 when there is none
+    int parse(size_t start, int minPrecedence) {
+        exprs.clear();
+        parts.clear();
+        pos_ = start;
+        templates_ = 0;
+        return parseBinary(minPrecedence, 0);
+    }
+    size_t end() const { return pos_; }
+
+    // Operator spelled by the punctuation nodes at `at`, and how many
+    // nodes it takes
+    std::pair<std::string_view, size_t> peekOperator(size_t at) const {
+        return at < operators_.size() ? operators_[at] : std::pair<std::string_view, size_t>();
+    }
+
+private:
+    const std::vector<Node*>& nodes_;
+    std::vector<std::pair<std::string_view, size_t>> operators_;
+    size_t pos_ = 0;
+    size_t templates_ = 0; // `<` read after a name, which may open template arguments
+
+    std::pair<std::string_view, size_t> spellOperator(size_t at) const {
+        char spelled[3];
+        size_t lengths[3];
+        size_t count = 0;
+        size_t length = 0;
+        for (; count < 3 && at + count < nodes_.size(); count++) {
+            const Node* node = nodes_[at + count];
+            const std::string_view text = textOf(node);
+            if (text.empty() || length + text.size() > 3 || !isPunctuation(text) || (count > 0 && !joined(node))) {
+                break;
+            }
+            text.copy(spelled + length, text.size());
+            length += text.size();
+            lengths[count] = length;
+        }
+        for (; count > 0; count--) {
+            const std::string_view spelling = findSpelling(std::string_view(spelled, lengths[count - 1]));
+            if (!spelling.empty()) return {spelling, count};
+        }
+        return {std::string_view(), 0};
+    }
+
+    int add(Expr expr) {
+        exprs.push_back(std::move(expr));
+        return static_cast<int>(exprs.size() - 1);
+    }
+
+    // Records `list` as the subexpressions of `e`
+    void setParts(Expr& e, std::initializer_list<int> list) {
+        e.partsFrom = parts.size();
+        parts.insert(parts.end(), list);
+        e.partsEnd = parts.size();
+    }
+
+    bool isArithmetic(int index) const {
+        const Expr& e = exprs[index];
+        if (e.kind == ExprKind::Binary) return contains(kArithmeticOperators, e.op);
+        if (e.kind == ExprKind::Unary) return e.op == "-" || e.op == "+" || e.op == "~";
+        if (e.kind == ExprKind::Group) return isArithmetic(parts[e.partsFrom]);
+        return false;
+    }
+
+    // Whether the expression still promotes its operands once the
+    // identities reduced inside it are dropped
+    bool promotes(int index) const {
+        const Expr& e = exprs[index];
+        if (e.keep >= 0) return promotes(e.keep);
+        if (e.kind == ExprKind::Group) return promotes(parts[e.partsFrom]);
+        return isArithmetic(index);
+    }
+
+    // Called by parents that promote their operands
+    void reduceIdentity(int index) {
+        Expr& e = exprs[index];
+        if (e.identity >= 0 && e.keep < 0) {
+            e.keep = e.identity;
+            e.changed = true;
+        }
+    }
+
+    int parseBinary(int minPrecedence, size_t depth) {
+        if (depth > kMaxDepth) return -1;
+        int lhs = parseUnary(depth + 1);
+        if (lhs < 0) return -1;
+        for (;;) {
+            const auto [op, count] = peekOperator(pos_);
+            const int precedence = binaryPrecedence(op);
+            if (precedence < minPrecedence || precedence == kCannotStart) break;
+            // A > that may close template arguments is not an operator: the
+            // group after static_cast<int> is its argument
+            if ((op == ">" || op == ">>") && (templates_ > 0 || peekOperator(pos_ + count).first == "(")) return -1;
+            if (op == "<" && pos_ > 0 && isIdentifier(textOf(nodes_[pos_ - 1]))) templates_++;
+            pos_ += count;
+            const int rhs = parseBinary(precedence + 1, depth + 1);
+            if (rhs < 0) return -1;
+            lhs = makeBinary(op, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    int parseUnary(size_t depth) {
+        if (depth > kMaxDepth) return -1;
+        const auto [op, count] = peekOperator(pos_);
+        if (op == "-" || op == "+" || op == "~" || op == "!" || op == "*" || op == "&" ||
+            op == "++" || op == "--") {
+            const size_t first = pos_;
+            pos_ += count;
+            const int operand = parseUnary(depth + 1);
+            if (operand < 0) return -1;
+            return makeUnary(op, first, operand);
+        }
+        const int primary = parsePrimary(depth);
+        return primary < 0 ? -1 : parsePostfix(primary, depth);
+    }
+
+    int parsePrimary(size_t depth) {
+        if (pos_ >= nodes_.size()) return -1;
+        const Node* node = nodes_[pos_];
+        const size_t at = pos_;
+        if (node->kind == NodeKind::String || node->kind == NodeKind::Operation) {
+            return add(Expr(ExprKind::Leaf, at, ++pos_));
+        }
+        const std::string_view text = textOf(node);
+        Literal value;
+        if (parseLiteral(text, value)) {
+            Expr e(ExprKind::Constant, at, ++pos_);
+            e.value = value;
+            e.constant = true;
+            return add(std::move(e));
+        }
+        if (isIdentifier(text) || (!text.empty() && isDigit(text[0]))) {
+            return add(Expr(ExprKind::Leaf, at, ++pos_));
+        }
+        if (peekOperator(pos_).first == "(") {
+            const size_t first = pos_++;
+            const int inner = parseBinary(1, depth + 1);
+            if (inner < 0 || peekOperator(pos_).first != ")") return -1;
+            Expr e(ExprKind::Group, first, ++pos_);
+            setParts(e, {inner});
+            e.constant = exprs[inner].constant;
+            e.value = exprs[inner].value;
+            e.changed = exprs[inner].changed;
+            return add(std::move(e));
+        }
+        return -1;
+    }
+
+    int parsePostfix(int base, size_t depth) {
+        for (;;) {
+            const auto [op, count] = peekOperator(pos_);
+            const size_t first = exprs[base].first;
+            if (op == "(" || op == "[") {
+                // A literal followed by brackets is left for the caller to refuse
+                if (exprs[base].kind == ExprKind::Constant) return base;
+                const std::string_view close = op == "(" ? ")" : "]";
+                pos_ += count;
+                std::vector<int> arguments{base};
+                bool changed = exprs[base].changed;
+                if (peekOperator(pos_).first != close) {
+                    for (;;) {
+                        const int argument = parseBinary(1, depth + 1);
+                        if (argument < 0) return -1;
+                        arguments.push_back(argument);
+                        changed = changed || exprs[argument].changed;
+                        const std::string_view next = peekOperator(pos_).first;
+                        if (next == close) break;
+                        if (next != "," || op == "[") return -1;
+                        pos_++;
+                    }
+                }
+                Expr e(ExprKind::Postfix, first, ++pos_);
+                e.partsFrom = parts.size();
+                parts.insert(parts.end(), arguments.begin(), arguments.end());
+                e.partsEnd = parts.size();
+                e.changed = changed;
+                base = add(std::move(e));
+            } else if (op == "." || op == "->" || op == "::") {
+                if (pos_ + count >= nodes_.size() || !isIdentifier(textOf(nodes_[pos_ + count]))) return -1;
+                pos_ += count + 1;
+                base = makeWrapper(first, base);
+            } else if (op == "++" || op == "--") {
+                pos_ += count;
+                base = makeWrapper(first, base);
+            } else {
+                return base;
+            }
+        }
+    }
+
+    int makeWrapper(size_t first, int base) {
+        Expr e(ExprKind::Postfix, first, pos_);
+        setParts(e, {base});
+        e.changed = exprs[base].changed;
+        return add(std::move(e));
+    }
+
+    int makeUnary(std::string_view op, size_t first, int operand) {
+        if (contains(kPromotingUnary, op)) reduceIdentity(operand);
+        const Expr& x = exprs[operand];
+        Expr e(ExprKind::Unary, first, x.end);
+        e.op = op;
+        setParts(e, {operand});
+        e.changed = x.changed;
+        if (x.constant && evaluate(op, x.value, e.value)) {
+            e.constant = true;
+            // -1 stays as written unless its operand was folded already
+            e.folded = x.changed;
+        }
+        return add(std::move(e));
+    }
+
+    int makeBinary(std::string_view op, int lhs, int rhs) {
+        reduceIdentity(lhs);
+        reduceIdentity(rhs);
+        const Expr& a = exprs[lhs];
+        const Expr& b = exprs[rhs];
+        Expr e(ExprKind::Binary, a.first, b.end);
+        e.op = op;
+        setParts(e, {lhs, rhs});
+        e.changed = a.changed || b.changed;
+        if (a.constant && b.constant && evaluate(op, a.value, b.value, e.value)) {
+            e.constant = true;
+            e.folded = true;
+            e.changed = true;
+            return add(std::move(e));
+        }
+
+        auto is = [](const Expr& x, int64_t value) {
+            return x.constant && !x.value.isFloat && x.value.i == value;
+        };
+        if (((op == "*") && is(a, 1)) || ((op == "|" || op == "^") && is(a, 0))) {
+            e.identity = rhs;
+        } else if ((op == "*" || op == "/") ? is(b, 1)
+                   : (op == "-" || op == "|" || op == "^" || op == "<<" || op == ">>") && is(b, 0)) {
+            e.identity = lhs;
+        }
+        const int identity = e.identity;
+        const int index = add(std::move(e));
+        if (identity >= 0 && promotes(identity)) reduceIdentity(index);
+        return index;
+    }
+};
+
+} // namespace
+
+FoldStats ConstantFolder::fold(Program& program) {
+    stats_ = FoldStats();
+    foldList(program.items);
+    return stats_;
+}
+
+void ConstantFolder::foldList(NodeList& list) {
+    std::vector<Node*> nodes;
+    for (Node* node = list.first; node; node = node->next) {
+        nodes.push_back(node);
+        if (node->kind == NodeKind::Block) {
+            foldList(static_cast<BlockNode*>(node)->children);
+        } else if (node->kind == NodeKind::Function && static_cast<FunctionNode*>(node)->body) {
+            foldList(static_cast<FunctionNode*>(node)->body->children);
+        } else if (node->kind == NodeKind::Class && static_cast<ClassNode*>(node)->body) {
+            foldList(static_cast<ClassNode*>(node)->body->children);
+        }
+    }
+
+    ExpressionParser parser(nodes);
+    std::vector<Node*> out;
+    out.reserve(nodes.size());
+
+    // How tightly the tokens before `at` bind an expression starting there
+    auto leftBinding = [&](size_t at) {
+        if (at == 0) return 0;
+        const Node* prev = nodes[at - 1];
+        switch (prev->kind) {
+        case NodeKind::Comment:
+        case NodeKind::Block:
+        case NodeKind::Function:
+        case NodeKind::Class:
+            return 0;
+        case NodeKind::Text:
+            break;
+        default:
+            return kCannotStart;
+        }
+        // A start glued to punctuation may be the end of an operator
+        for (size_t from = at >= 2 ? at - 2 : 0; from < at; from++) {
+            if (from + parser.peekOperator(from).second > at) return kCannotStart;
+        }
+
+        std::string_view op = textOf(prev);
+        const size_t space = op.find_last_not_of(' ');
+        if (space != std::string_view::npos && op.find(' ') != std::string_view::npos) {
+            // Expansions like "std::cout << " end in an operator word
+            op = op.substr(0, space + 1);
+            op = op.substr(op.find_last_of(' ') + 1);
+        } else if (isPunctuation(op)) {
+            // Longest operator ending at `at` spelled by adjacent nodes
+            size_t from = at - 1;
+            while (from > 0 && at - from < 3 && joined(nodes[from]) && isPunctuation(textOf(nodes[from - 1]))) {
+                from--;
+            }
+            for (; from < at; from++) {
+                const auto [spelling, count] = parser.peekOperator(from);
+                if (from + count == at) {
+                    op = spelling;
+                    break;
+                }
+            }
+        }
+        if (isIdentifier(op)) return contains(kStatementKeywords, op) ? 0 : kCannotStart;
+        // A group after a > may be the argument of a cast or constructor
+        if ((op == ">" || op == ">>") && parser.peekOperator(at).first == "(") return kCannotStart;
+        if (contains(kSeparators, op) || contains(kAssignmentOperators, op)) return 0;
+        return binaryPrecedence(op);
+    };
+
+    // Whether the node after an expression leaves it alone
+    auto rightFree = [&](size_t at, int minPrecedence) {
+        if (at >= nodes.size()) return true;
+        const std::string_view op = parser.peekOperator(at).first;
+        if (op == "(" || op == "[" || op == "." || op == "->" || op == "::" || op == "++" || op == "--") {
+            return false;
+        }
+        return binaryPrecedence(op) < minPrecedence;
+    };
+
+    auto emit = [&](auto& self, int index) -> void {
+        const Expr& e = parser.exprs[index];
+        if (!e.changed) {
+            out.insert(out.end(), nodes.begin() + e.first, nodes.begin() + e.end);
+            return;
+        }
+        const Node* lead = nodes[e.first];
+        if (e.folded) {
+            stats_.constants++;
+            const std::string_view text = arena_.copy(formatLiteral(e.value));
+            out.push_back(arena_.make<TextNode>(lead->flags, lead->offset, text));
+            return;
+        }
+        if (e.keep >= 0) {
+            stats_.identities++;
+            const uint8_t flags = lead->flags;
+            const size_t at = out.size();
+            self(self, e.keep);
+            out[at]->flags = flags;
+            return;
+        }
+        size_t pos = e.first;
+        for (size_t k = e.partsFrom; k < e.partsEnd; k++) {
+            const int part = parser.parts[k];
+            const Expr& p = parser.exprs[part];
+            out.insert(out.end(), nodes.begin() + pos, nodes.begin() + p.first);
+            self(self, part);
+            pos = p.end;
+        }
+        out.insert(out.end(), nodes.begin() + pos, nodes.begin() + e.end);
+    };
+
+    for (size_t i = 0; i < nodes.size();) {
+        const int binding = leftBinding(i);
+        if (binding != kCannotStart) {
+            const int root = parser.parse(i, binding + 1);
+            if (root >= 0 && rightFree(parser.end(), binding + 1)) {
+                // Nothing inside is foldable unless the root changed
+                emit(emit, root);
+                i = parser.end();
+                continue;
+            }
+        }
+        out.push_back(nodes[i++]);
+    }
+
+    // ᚷ with a constant condition and { } bodies
+    nodes.swap(out);
+    out.clear();
+    auto conditionOf = [](const Node* node, bool& value) {
+        const std::string_view text = textOf(node);
+        Literal literal;
+        if (text == "true" || text == "false") {
+            value = text == "true";
+        } else if (parseLiteral(text, literal)) {
+            value = literal.asDouble() != 0;
+        } else {
+            return false;
+        }
+        return true;
+    };
+    // Whether an else follows `at` with only comments before it; folding
+    // would leave it dangling or drop the comments, so such chains stay
+    auto commentedElse = [&](size_t at) {
+        if (at >= nodes.size() || nodes[at]->kind != NodeKind::Comment) return false;
+        while (at < nodes.size() && nodes[at]->kind == NodeKind::Comment) at++;
+        return at < nodes.size() && textOf(nodes[at]) == "else";
+    };
+    // Index just past the block or if statement at `at`, 0 when unclear
+    auto statementEnd = [&](auto& self, size_t at, size_t depth) -> size_t {
+        if (at >= nodes.size() || depth > kMaxDepth) return 0;
+        if (nodes[at]->kind == NodeKind::Block) return at + 1;
+        if (textOf(nodes[at]) != "if" || at + 1 >= nodes.size() || textOf(nodes[at + 1]) != "(") return 0;
+        size_t j = at + 2;
+        for (int parens = 1; parens > 0; j++) {
+            if (j >= nodes.size()) return 0;
+            const std::string_view text = textOf(nodes[j]);
+            parens += text == "(" ? 1 : text == ")" ? -1 : 0;
+        }
+        if (j >= nodes.size() || nodes[j]->kind != NodeKind::Block) return 0;
+        j++;
+        if (j < nodes.size() && textOf(nodes[j]) == "else") return self(self, j + 1, depth + 1);
+        return commentedElse(j) ? 0 : j;
+    };
+
+    for (size_t i = 0; i < nodes.size();) {
+        bool value = false;
+        if (i + 4 < nodes.size() && textOf(nodes[i]) == "if" && textOf(nodes[i + 1]) == "(" &&
+            conditionOf(nodes[i + 2], value) && textOf(nodes[i + 3]) == ")" &&
+            nodes[i + 4]->kind == NodeKind::Block) {
+            const size_t after = i + 5;
+            const bool hasElse = after < nodes.size() && textOf(nodes[after]) == "else";
+            const size_t end = hasElse ? statementEnd(statementEnd, after + 1, 0) : commentedElse(after) ? 0 : after;
+            if (end) {
+                stats_.branches++;
+                const Node* statement = nodes[i];
+                if (value) {
+                    nodes[i + 4]->flags = statement->flags;
+                    out.push_back(nodes[i + 4]);
+                    i = end;
+                } else if (hasElse) {
+                    nodes[after + 1]->flags = statement->flags;
+                    i = after + 1;
+                } else {
+                    // Dropped outright only where a statement ended before
+                    const Node* prev = out.empty() ? nullptr : out.back();
+                    if (prev && prev->kind == NodeKind::Text && textOf(prev) != ";") {
+                        out.push_back(arena_.make<BlockNode>(statement->flags, statement->offset));
+                    }
+                    i = after;
+                }
+                continue;
+            }
+        }
+        out.push_back(nodes[i++]);
+    }
+
+    list.first = nullptr;
+    list.last = nullptr;
+    for (Node* node : out) {
+        node->next = nullptr;
+        list.append(node);
+    }
+}
+
+size_t pruneUnreferenced(Program& program) {
+    std::vector<Node*> items;
+    std::unordered_map<std::string_view, std::vector<size_t>> definitions;
+    for (Node* node = program.items.first; node; node = node->next) {
+        if (node->kind == NodeKind::Function) {
+            definitions[static_cast<FunctionNode*>(node)->name].push_back(items.size());
+        } else if (node->kind == NodeKind::Class) {
+            definitions[static_cast<ClassNode*>(node)->name].push_back(items.size());
+        }
+        items.push_back(node);
+    }
+    if (definitions.empty()) return 0;
+
+    std::vector<bool> kept(items.size(), false);
+    std::vector<const Node*> pending;
+    auto keep = [&](size_t item) {
+        if (kept[item]) return;
+        kept[item] = true;
+        pending.push_back(items[item]);
+    };
+    for (size_t i = 0; i < items.size(); i++) {
+        const NodeKind kind = items[i]->kind;
+        if ((kind != NodeKind::Function && kind != NodeKind::Class) ||
+            (kind == NodeKind::Function && static_cast<FunctionNode*>(items[i])->name == "main")) {
+            keep(i);
+        }
+    }
+
+    // Any text equal to a definition's name keeps it, wherever it appears
+    while (!pending.empty()) {
+        const Node* node = pending.back();
+        pending.pop_back();
+        switch (node->kind) {
+        case NodeKind::Text: {
+            const auto found = definitions.find(static_cast<const TextNode*>(node)->text);
+            if (found != definitions.end()) {
+                for (size_t item : found->second) keep(item);
+            }
+            break;
+        }
+        case NodeKind::Block:
+            for (const Node* child = static_cast<const BlockNode*>(node)->children.first; child; child = child->next) {
+                pending.push_back(child);
+            }
+            break;
+        case NodeKind::Function:
+            if (const BlockNode* body = static_cast<const FunctionNode*>(node)->body) pending.push_back(body);
+            break;
+        case NodeKind::Class:
+            if (const BlockNode* body = static_cast<const ClassNode*>(node)->body) pending.push_back(body);
+            break;
+        default:
+            break;
+        }
+    }
+
+    size_t dropped = 0;
+    program.items.first = nullptr;
+    program.items.last = nullptr;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (!kept[i]) {
+            dropped++;
+            continue;
+        }
+        items[i]->next = nullptr;
+        program.items.append(items[i]);
+    }
+    return dropped;
+}
+
+} // namespace RuneLang
@@ -0,0 +1,40 @@
+#include "../include/RuneOutput.hpp"
+#include "../include/RuneError.hpp"
+#include <cerrno>
+#include <unistd.h>
+
+namespace RuneLang {
+
+void OutputSink::appendSlow(std::string_view text) {
+    flush();
+    if (text.size() >= kBufferSize) {
+        // Large pieces skip the staging buffer entirely
+        drain(text.data(), text.size());
+        written_ += text.size();
+    } else {
+        std::memcpy(cur_, text.data(), text.size());
+        cur_ += text.size();
+    }
+}
+
+FdSink::~FdSink() {
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to flush generated code: ", e.what());
+    }
+}
+
+void FdSink::drain(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd_, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to write generated code");
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+} // namespace RuneLang
@@ -1,217 +1,567 @@
 #include "../include/RuneParser.hpp"
-#include <sstream>
-#include <fstream>
+#include "../include/RuneEmitter.hpp"
+#include "../include/RuneMappedFile.hpp"
+#include "../include/RuneOptimizer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace RuneLang {
 
-RuneParser::RuneParser() : currentLine(1), currentColumn(1) {
-    initializeRuneMap();
-}
-
-void RuneParser::initializeRuneMap() {
-    runeToKeyword = {
-        {"ᚠ", "std::cout << "}, // Output to console
-        {"ᚱ", "for"},           // For-loop
-        {"ᚷ", "if"},            // If-condition
-        {"ᛏ", "return"},        // Return from function
-        {"ᚢ", "+"},             // Addition operator
-        {"ᚦ", "-"},             // Subtraction operator
-        {"ᛉ", "while"},         // While-loop
-        {"ᚨ", "std::vector<"},  // Array declaration
-        {"ᛜ", "std::cin >> "},  // Input from console
-        {"ᛝ", "std::string"},   // String type
-        {"ᛞ", "#"},             // Comment marker
-        {"ᛟ", "\""},            // String delimiter
-        {"ᛗ", "->"},            // Arrow operator
-        {"ᚹ", "*"},             // Multiplication
-        {"ᚺ", "/"},             // Division
-        {"ᚻ", "%"},             // Modulo
-        {"ᚼ", "<<"},            // Left shift
-        {"ᚽ", ">>"},            // Right shift
-        {"ᚾ", "&"},             // Bitwise AND
-        {"ᚿ", "|"},             // Bitwise OR
-        {"ᛀ", "^"},             // Bitwise XOR
-        {"ᛁ", "~"},             // Bitwise NOT
-        {"ᛚ", "float"},         // Float array type
-        {"ᛦ", "double"},        // Double array type
-        {"ᛙ", "char"},          // Char type
-        {"ᛠ", "double"},        // Double type
-        {"ᛡ", "bool"},          // Boolean type
-        {"ᛤ", "void"},          // Void return type
-        {"ᛥ", "class"},         // Class declaration
-        {"ᛦ", "namespace"},     // Namespace declaration
-        {"ᛧ", "struct"},        // Struct declaration
-        {"ᛨ", "RuneSystem::"},  // System operations prefix
-        {"ᛩ", "RuneProcess::"}, // Process operations prefix
-        {"ᛪ", "RuneThread::"},  // Thread operations prefix
-        {"᛫", "RuneFileSystem::"}, // File system operations prefix
-        {"᛬", "allocateMemory"}, // Allocate memory
-        {"ᛮ", "freeMemory"},     // Free memory
-        {"ᛯ", "createProcess"}, // Create new process
-        {"ᛰ", "createThread"}, // Create new thread
-        {"ᛱ", "terminate"},    // Terminate process/thread
-        {"ᛲ", "createFile"},    // Create file
-        {"ᛳ", "deleteFile"},    // Delete file
-        {"ᛴ", "readFile"},      // Read file
-        {"ᛵ", "writeFile"},     // Write file
-    };
-}
-
-void RuneParser::updatePosition(const std::string& code, size_t& pos) {
-    if (code[pos] == '\n') {
-        currentLine++;
-        currentColumn = 1;
+namespace {
+
+// Offsets of runes with special meaning inside the Runic block
+constexpr uint8_t runeOffset(char32_t rune) {
+    return static_cast<uint8_t>(rune - kRuneBlockFirst);
+}
+
+constexpr uint8_t kSystemRune = runeOffset(U'ᛨ');
+constexpr uint8_t kProcessRune = runeOffset(U'ᛩ');
+constexpr uint8_t kFileRune = runeOffset(U'᛫');
+constexpr uint8_t kClassRune = runeOffset(U'ᛥ');
+constexpr uint8_t kBlockStartRune = runeOffset(U'ᛒ');
+constexpr uint8_t kBlockEndRune = runeOffset(U'ᛘ');
+
+// Closes the generated code of compileToCpp; the prologue depends on
+// what the code uses, see prologueFor()
+constexpr std::string_view kEpilogue = "\nint main() {\n\treturn 0;\n}";
+
+// Cache key option of output that went through ConstantFolder
+constexpr uint64_t kOptimizedOutput = 1;
+
+// Block size for comparing generated code with an existing file
+constexpr size_t kCompareBlock = 64 * 1024;
+
+// Deeper nesting is rejected instead of risking the stack
+constexpr size_t kMaxBlockDepth = 10000;
+
+// What setOptimize turns on for whole-source parses
+void optimizeProgram(Program& program, RuneArena& arena) {
+    ConstantFolder(arena).fold(program);
+    pruneUnreferenced(program);
+}
+
+RuneParseError locatedError(const char* message, SourcePosition position) {
+    return RuneParseError(message, position.line, position.column);
+}
+
+// The process umask. It can only be read by setting it, so that is done
+// once rather than on every write, where other threads could create
+// files under the temporary mask.
+mode_t creationMask() {
+    static const mode_t mask = [] {
+        const mode_t previous = ::umask(0);
+        ::umask(previous);
+        return previous;
+    }();
+    return mask;
+}
+
+// Raised while streaming when an item runs past the tokens lexed so far
+struct NeedMoreInput {};
+
+// Whether the file at `path` holds exactly `pieces`, one after another.
+// Missing and unreadable files differ from everything.
+template <size_t N>
+bool hasContents(const std::string& path, const std::string_view (&pieces)[N]) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    size_t total = 0;
+    for (std::string_view piece : pieces) total += piece.size();
+    struct stat info;
+    bool same = fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_size) == total;
+
+    // Streamed in blocks: most differences show up in the first one
+    std::string block(kCompareBlock, '\0');
+    for (size_t i = 0; same && i < N; i++) {
+        std::string_view piece = pieces[i];
+        while (same && !piece.empty()) {
+            const ssize_t received = ::read(fd, &block[0], std::min(piece.size(), block.size()));
+            if (received < 0 && errno == EINTR) continue;
+            same = received > 0 && piece.compare(0, received, block.data(), received) == 0;
+            if (same) piece.remove_prefix(received);
+        }
+    }
+    ::close(fd);
+    return same;
+}
+
+bool isTypeRune(uint8_t rune) {
+    switch (rune) {
+    case runeOffset(U'ᛤ'): // void
+    case runeOffset(U'ᛚ'): // float
+    case runeOffset(U'ᛦ'): // double
+    case runeOffset(U'ᛙ'): // char
+    case runeOffset(U'ᛠ'): // double
+    case runeOffset(U'ᛡ'): // bool
+    case runeOffset(U'ᛝ'): // std::string
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isBlockStart(const Token& token) {
+    return (token.kind == TokenKind::Rune && token.rune == kBlockStartRune) ||
+           (token.kind == TokenKind::Punct && token.text[0] == '{');
+}
+
+bool isBlockEnd(const Token& token) {
+    return (token.kind == TokenKind::Rune && token.rune == kBlockEndRune) ||
+           (token.kind == TokenKind::Punct && token.text[0] == '}');
+}
+
+} // namespace
+
+RuneParser::RuneParser() : arena(nullptr), moreInput(false), diagnostics(nullptr), cache(nullptr), lexerThreads(1), optimize(false), currentClass(kNoSymbol), currentOffset(0) {}
+
+void RuneParser::report(DiagnosticCode code, uint64_t offset, std::string_view detail) {
+    if (!diagnostics) {
+        throw RuneSourceError(Diagnostic{code, offset, detail, SourcePosition()}.message(), offset);
+    }
+    diagnostics->report(code, offset, detail);
+}
+
+SymbolId RuneParser::declare(SymbolKind kind, const Token& name, SymbolId owner, bool defined) {
+    const SymbolId symbol = interner.intern(name.text);
+    // Redefinitions are left to the C++ compiler unless diagnostics are wanted
+    if (!symbols.declare(kind, symbol, owner, name.offset, defined) && diagnostics) {
+        diagnostics->report(DiagnosticCode::DuplicateDefinition, name.offset, name.text);
+    }
+    return symbol;
+}
+
+void RuneParser::handleIdentifier(const std::vector<Token>& tokens, size_t pos) {
+    const Token& token = tokens[pos];
+    // <type rune> <name> directly in a class body declares a member
+    if (currentClass != kNoSymbol && pos > 0 && tokens[pos - 1].kind == TokenKind::Rune &&
+        isTypeRune(tokens[pos - 1].rune)) {
+        declare(SymbolKind::Member, token, currentClass);
     } else {
-        currentColumn++;
+        symbols.reference(interner.intern(token.text));
     }
-    pos++;
 }
 
-void RuneParser::skipWhitespace(const std::string& code, size_t& pos) {
-    while (pos < code.length() && std::isspace(code[pos])) {
-        updatePosition(code, pos);
+void RuneParser::synchronize(const std::vector<Token>& tokens, size_t& pos) const {
+    // Panic mode: drop tokens up to the next statement or brace boundary
+    while (pos < tokens.size()) {
+        const Token& token = tokens[pos];
+        if (token.hasFlag(NewlineBefore) || isBlockStart(token) || isBlockEnd(token)) return;
+        pos++;
+        if (token.kind == TokenKind::Punct && token.text[0] == ';') return;
     }
 }
 
-std::string RuneParser::handleString(const std::string& code, size_t& pos) {
-    std::string result = "\"";
-    pos++; // Skip opening quote rune
-    
-    while (pos < code.length()) {
-        if (std::string(1, code[pos]) == "ᛟ") { // Check for closing quote
-            pos++;
-            break;
+void RuneParser::skipBlock(const std::vector<Token>& tokens, size_t& pos) const {
+    // `pos` is just past an opening brace; stop just past its partner
+    for (size_t depth = 1; pos < tokens.size() && depth > 0; pos++) {
+        if (isBlockStart(tokens[pos])) {
+            depth++;
+        } else if (isBlockEnd(tokens[pos])) {
+            depth--;
         }
-        result += code[pos];
-        updatePosition(code, pos);
     }
-    
-    return result + "\"";
 }
 
-std::string RuneParser::handleComment(const std::string& code, size_t& pos) {
-    std::string result = "//";
-    pos++; // Skip comment rune
-    
-    while (pos < code.length() && code[pos] != '\n') {
-        result += code[pos];
-        pos++;
+void RuneParser::requireTokens(const std::vector<Token>& tokens, size_t pos, size_t count) const {
+    if (moreInput && pos + count > tokens.size()) {
+        throw NeedMoreInput();
     }
-    
-    return result + "\n";
-}
-
-std::string RuneParser::handleSystemCall(const std::string& code, size_t& pos) {
-    std::string result = "RuneSystem::";
-    pos++; // Skip the system operation rune
-    
-    // Parse system call parameters
-    while (pos < code.length() && !std::isspace(code[pos])) {
-        result += code[pos];
-        updatePosition(code, pos);
+}
+
+Node* RuneParser::handleString(const std::vector<Token>& tokens, size_t& pos) {
+    const Token& token = tokens[pos++];
+    return makeNode<StringNode>(token, token.text);
+}
+
+Node* RuneParser::handleComment(const std::vector<Token>& tokens, size_t& pos) {
+    const Token& token = tokens[pos++];
+    return makeNode<CommentNode>(token, token.text);
+}
+
+Node* RuneParser::handleOperation(const std::vector<Token>& tokens, size_t& pos, std::string_view prefix) {
+    const Token& token = tokens[pos++]; // Skip the operation prefix rune
+    std::string_view name;
+    requireTokens(tokens, pos, 1);
+
+    // The operation name has to follow its prefix rune directly
+    if (pos < tokens.size() && tokens[pos].kind == TokenKind::Identifier && tokens[pos].flags == 0) {
+        name = tokens[pos++].text;
     }
-    
-    return result;
+    return makeNode<OperationNode>(token, prefix, name);
+}
+
+Node* RuneParser::handleSystemCall(const std::vector<Token>& tokens, size_t& pos) {
+    return handleOperation(tokens, pos, "RuneSystem::");
 }
 
-std::string RuneParser::handleProcessManagement(const std::string& code, size_t& pos) {
-    std::string result = "RuneProcess::";
-    pos++; // Skip the process operation rune
-    
-    // Parse process management parameters
-    while (pos < code.length() && !std::isspace(code[pos])) {
-        result += code[pos];
-        updatePosition(code, pos);
+Node* RuneParser::handleProcessManagement(const std::vector<Token>& tokens, size_t& pos) {
+    return handleOperation(tokens, pos, "RuneProcess::");
+}
+
+Node* RuneParser::handleFileOperation(const std::vector<Token>& tokens, size_t& pos) {
+    return handleOperation(tokens, pos, "RuneFileSystem::");
+}
+
+bool RuneParser::isFunctionHeader(const std::vector<Token>& tokens, size_t pos) const {
+    // <type rune> <name> ᛒ
+    requireTokens(tokens, pos, 3);
+    return pos + 2 < tokens.size() &&
+           tokens[pos + 1].kind == TokenKind::Identifier &&
+           isBlockStart(tokens[pos + 2]);
+}
+
+Node* RuneParser::handleFunction(const std::vector<Token>& tokens, size_t& pos, size_t depth) {
+    const Token& typeToken = tokens[pos++];
+    const Token& nameToken = tokens[pos++];
+
+    const SymbolKind kind = currentClass != kNoSymbol ? SymbolKind::Method : SymbolKind::Function;
+    const SymbolId symbol = declare(kind, nameToken, currentClass);
+    auto* function = makeNode<FunctionNode>(typeToken, kRuneTable[typeToken.rune], nameToken.text, symbol);
+
+    // Declarations in the body are locals, not members
+    const SymbolId owner = currentClass;
+    currentClass = kNoSymbol;
+    function->body = handleBlock(tokens, pos, depth);
+    currentClass = owner;
+    return function->body ? function : nullptr;
+}
+
+Node* RuneParser::handleClass(const std::vector<Token>& tokens, size_t& pos, size_t depth) {
+    const Token& classToken = tokens[pos++]; // Skip class rune
+    requireTokens(tokens, pos, 2);
+
+    if (pos >= tokens.size() || tokens[pos].kind != TokenKind::Identifier) {
+        report(DiagnosticCode::ExpectedClassName, classToken.offset);
+        synchronize(tokens, pos);
+        return nullptr;
     }
-    
-    return result;
+
+    const Token& nameToken = tokens[pos++];
+    const bool defined = pos < tokens.size() && isBlockStart(tokens[pos]);
+    const SymbolId symbol = declare(SymbolKind::Class, nameToken, kNoSymbol, defined);
+    auto* cls = makeNode<ClassNode>(classToken, nameToken.text, symbol);
+    if (defined) {
+        const SymbolId owner = currentClass;
+        currentClass = symbol;
+        cls->body = handleBlock(tokens, pos, depth);
+        currentClass = owner;
+    }
+    return cls;
 }
 
-std::string RuneParser::handleFileOperation(const std::string& code, size_t& pos) {
-    std::string result = "RuneFileSystem::";
-    pos++; // Skip the file operation rune
-    
-    // Parse file operation parameters
-    while (pos < code.length() && !std::isspace(code[pos])) {
-        result += code[pos];
-        updatePosition(code, pos);
+BlockNode* RuneParser::handleBlock(const std::vector<Token>& tokens, size_t& pos, size_t depth) {
+    const Token& open = tokens[pos++];
+    if (depth >= kMaxBlockDepth) {
+        report(DiagnosticCode::NestingTooDeep, open.offset);
+        skipBlock(tokens, pos);
+        return nullptr;
     }
-    
-    return result;
+
+    auto* block = makeNode<BlockNode>(open);
+    parseSequence(tokens, pos, block->children, block, depth + 1);
+    return block;
 }
 
-std::string RuneParser::parseRuneCode(const std::string& runeCode) {
-    std::string parsedCode;
-    size_t pos = 0;
-    
-    try {
-        while (pos < runeCode.length()) {
-            skipWhitespace(runeCode, pos);
-            if (pos >= runeCode.length()) break;
-            
-            std::string runeStr(1, runeCode[pos]);
-            
-            if (runeStr == "ᛟ") { // String
-                parsedCode += handleString(runeCode, pos);
-            } else if (runeStr == "ᛞ") { // Comment
-                parsedCode += handleComment(runeCode, pos);
-            } else if (runeStr == "ᛨ") { // System call
-                parsedCode += handleSystemCall(runeCode, pos);
-            } else if (runeStr == "ᛩ") { // Process management
-                parsedCode += handleProcessManagement(runeCode, pos);
-            } else if (runeStr == "᛫") { // File operation
-                parsedCode += handleFileOperation(runeCode, pos);
-            } else if (runeToKeyword.find(runeStr) != runeToKeyword.end()) {
-                parsedCode += runeToKeyword[runeStr];
-                updatePosition(runeCode, pos);
-            } else {
-                throw RuneParseError("Unknown rune symbol: " + runeStr, currentLine, currentColumn);
+Node* RuneParser::parseNode(const std::vector<Token>& tokens, size_t& pos, size_t depth) {
+    const Token& token = tokens[pos];
+    currentOffset = token.offset;
+
+    switch (token.kind) {
+    case TokenKind::String:
+        return handleString(tokens, pos);
+    case TokenKind::Comment:
+        return handleComment(tokens, pos);
+    case TokenKind::Rune:
+        if (token.rune == kSystemRune) { // System call
+            return handleSystemCall(tokens, pos);
+        } else if (token.rune == kProcessRune) { // Process management
+            return handleProcessManagement(tokens, pos);
+        } else if (token.rune == kFileRune) { // File operation
+            return handleFileOperation(tokens, pos);
+        } else if (token.rune == kClassRune) { // Class declaration
+            return handleClass(tokens, pos, depth);
+        } else if (token.rune == kBlockStartRune) { // Block
+            return handleBlock(tokens, pos, depth);
+        } else if (isTypeRune(token.rune) && isFunctionHeader(tokens, pos)) { // Function
+            return handleFunction(tokens, pos, depth);
+        } else if (kRuneTable[token.rune].empty()) {
+            report(DiagnosticCode::UnknownRune, token.offset, token.text);
+            pos++;
+            synchronize(tokens, pos);
+            return nullptr;
+        }
+        pos++;
+        return makeNode<TextNode>(token, kRuneTable[token.rune]);
+    case TokenKind::Punct:
+        if (token.text[0] == '{') {
+            return handleBlock(tokens, pos, depth);
+        }
+        [[fallthrough]];
+    default: // Identifiers, numbers and punctuation pass through
+        if (token.kind == TokenKind::Identifier) handleIdentifier(tokens, pos);
+        pos++;
+        return makeNode<TextNode>(token, token.text);
+    }
+}
+
+void RuneParser::parseSequence(const std::vector<Token>& tokens, size_t& pos, NodeList& list,
+                               BlockNode* block, size_t depth) {
+    while (pos < tokens.size()) {
+        const Token& token = tokens[pos];
+        if (isBlockEnd(token)) {
+            if (!block) {
+                report(DiagnosticCode::UnmatchedBlockEnd, token.offset);
+                pos++;
+                continue;
             }
+            block->closeFlags = token.flags;
+            pos++;
+            return;
         }
-    } catch (const std::exception& e) {
-        throw RuneParseError(e.what(), currentLine, currentColumn);
+        if (Node* node = parseNode(tokens, pos, depth)) list.append(node);
+    }
+
+    if (block) {
+        if (moreInput) throw NeedMoreInput();
+        // Recovery closes the block at the end of the input
+        report(DiagnosticCode::UnterminatedBlock, block->offset);
     }
-    
-    return parsedCode;
 }
 
-std::string RuneParser::handleFunction(const std::string& code, size_t& pos) {
-    std::string returnType = runeToKeyword[std::string(1, code[pos])];
-    pos++;
+Program* RuneParser::parse(std::string_view runeCode, RuneArena& parseArena) {
+    std::vector<Token> tokens;
+    if (lexerThreads > 1) {
+        lexer.tokenizeParallel(runeCode, tokens, lexerThreads);
+    } else {
+        lexer.tokenize(runeCode, tokens);
+    }
+    return parseTokens(tokens, parseArena);
+}
 
-    // Skip whitespace
-    while (pos < code.length() && std::isspace(code[pos])) pos++;
+Program* RuneParser::parse(const TokenBuffer& tokens, RuneArena& parseArena) {
+    std::vector<Token> expanded;
+    tokens.toTokens(expanded);
+    return parseTokens(expanded, parseArena);
+}
+
+// Starts the symbols of a new compilation
+void RuneParser::resetSymbols() {
+    symbols.clear();
+    // A long-lived parser, such as a daemon worker's, would otherwise keep
+    // every name it ever saw
+    if (interner.size() > kMaxIdentifiers) interner.clear();
+    currentClass = kNoSymbol;
+}
 
-    // Get function name
-    std::string functionName;
-    while (pos < code.length() && !std::isspace(code[pos]) && code[pos] != '(') {
-        functionName += code[pos++];
+Program* RuneParser::parseTokens(const std::vector<Token>& tokens, RuneArena& parseArena) {
+    size_t pos = 0;
+    moreInput = false;
+    resetSymbols();
+    // Every token yields at most one node, so this keeps the tree in one block
+    parseArena.reserve(sizeof(Program) + tokens.size() * sizeof(OperationNode));
+    arena = &parseArena;
+    Program* program = arena->make<Program>();
+    try {
+        parseSequence(tokens, pos, program->items, nullptr, 0);
+    } catch (...) {
+        arena = nullptr;
+        throw;
     }
+    arena = nullptr;
+    return program;
+}
 
-    if (functionName.empty()) {
-        throw RuneParseError("Expected function name");
+void RuneParser::parseSource(std::string_view runeCode, OutputSink& out) {
+    if (!cache) {
+        parseUncached(runeCode, out);
+        return;
     }
 
-    return returnType + " " + functionName + "() {\n";
+    const CacheKey key = RuneCache::keyFor(runeCode, optimize ? kOptimizedOutput : 0);
+    if (cache->lookup(key, runeCode.size(), out)) return;
+    std::string cppCode;
+    {
+        StringSink capture(cppCode, StringSink::estimateFor(runeCode.size()));
+        parseUncached(runeCode, capture);
+    }
+    cache->store(key, cppCode);
+    out.append(cppCode);
 }
 
-std::string RuneParser::handleClass(const std::string& code, size_t& pos) {
-    pos++; // Skip class rune
+void RuneParser::parseUncached(std::string_view runeCode, OutputSink& out) {
+    RuneArena parseArena;
+    CppEmitter(out).emit(*parseWhole(runeCode, parseArena));
+}
 
-    // Skip whitespace
-    while (pos < code.length() && std::isspace(code[pos])) pos++;
+// Parses and, if enabled, optimizes all of `runeCode`, with errors
+// located in it
+Program* RuneParser::parseWhole(std::string_view runeCode, RuneArena& parseArena) {
+    try {
+        Program* program = parse(runeCode, parseArena);
+        if (optimize) optimizeProgram(*program, parseArena);
+        return program;
+    } catch (const RuneSourceError& e) {
+        throw locatedError(e.what(), LineIndex(runeCode).locate(e.getOffset()));
+    } catch (const RuneParseError&) {
+        throw;
+    } catch (const std::exception& e) {
+        throw locatedError(e.what(), LineIndex(runeCode).locate(currentOffset));
+    }
+}
 
-    // Get class name
-    std::string className;
-    while (pos < code.length() && !std::isspace(code[pos]) && code[pos] != '{') {
-        className += code[pos++];
+void RuneParser::parseWithDiagnostics(std::string_view runeCode, OutputSink& out, DiagnosticList& found) {
+    // Problems are recorded instead of thrown; only system errors unwind
+    diagnostics = &found;
+    lexer.setDiagnostics(&found);
+    try {
+        RuneArena parseArena;
+        Program* program = parse(runeCode, parseArena);
+        if (optimize) optimizeProgram(*program, parseArena);
+        CppEmitter(out).emit(*program);
+    } catch (...) {
+        diagnostics = nullptr;
+        lexer.setDiagnostics(nullptr);
+        throw;
     }
+    diagnostics = nullptr;
+    lexer.setDiagnostics(nullptr);
 
-    if (className.empty()) {
-        throw RuneParseError("Expected class name");
+    if (!found.empty()) found.resolve(LineIndex(runeCode));
+}
+
+ParseResult RuneParser::parseWithDiagnostics(std::string_view runeCode, size_t maxDiagnostics) {
+    ParseResult result(maxDiagnostics);
+    {
+        StringSink out(result.code, StringSink::estimateFor(runeCode.size()));
+        parseWithDiagnostics(runeCode, out, result.diagnostics);
     }
+    return result;
+}
 
-    return "class " + className + " {\n";
+void RuneParser::parseRuneCode(const std::string& runeCode, OutputSink& out) {
+    parseSource(runeCode, out);
+}
+
+std::string RuneParser::parseRuneCode(const std::string& runeCode) {
+    std::string parsedCode;
+    StringSink out(parsedCode, StringSink::estimateFor(runeCode.size()));
+    parseRuneCode(runeCode, out);
+    out.flush();
+    return parsedCode;
+}
+
+void RuneParser::parseFile(const std::string& path, OutputSink& out) {
+    RuneMappedFile file(path);
+    parseSource(file.contents(), out);
+}
+
+std::string RuneParser::parseFile(const std::string& path) {
+    RuneMappedFile file(path);
+    std::string parsedCode;
+    StringSink out(parsedCode, StringSink::estimateFor(file.size()));
+    parseSource(file.contents(), out);
+    out.flush();
+    return parsedCode;
+}
+
+void RuneParser::parseChunks(const std::function<size_t(char*, size_t)>& read, OutputSink& out, size_t chunkSize) {
+    std::string window; // Source from the first token not yet parsed
+    SourcePosition windowPosition; // Where the window starts, for diagnostics
+    std::vector<Token> tokens;
+    RuneArena streamArena;
+    CppEmitter emitter(out);
+    bool eof = false;
+
+    lexer.reset();
+    resetSymbols();
+    currentOffset = 0;
+    arena = &streamArena;
+    uint64_t windowOffset = 0;
+    try {
+        while (!eof) {
+            // An item that outgrows the window doubles the next read, so the
+            // bytes re-lexed for it stay linear in its size
+            const size_t kept = window.size();
+            const size_t readSize = std::max(chunkSize, kept);
+            window.resize(kept + readSize);
+            const size_t received = read(&window[kept], readSize);
+            window.resize(kept + received);
+            eof = received == 0;
+            moreInput = !eof;
+
+            size_t keepFrom = lexer.tokenizeChunk(window, eof, tokens);
+
+            size_t pos = 0;
+            while (pos < tokens.size()) {
+                const size_t itemStart = pos;
+                const SymbolTable::Mark mark = symbols.mark();
+                const Token& token = tokens[pos];
+                if (isBlockEnd(token)) {
+                    report(DiagnosticCode::UnmatchedBlockEnd, token.offset);
+                    pos++;
+                    continue;
+                }
+                try {
+                    if (Node* node = parseNode(tokens, pos, 0)) emitter.emit(node);
+                } catch (const NeedMoreInput&) {
+                    // The item is parsed again, so forget what it declared
+                    symbols.rollback(mark);
+                    currentClass = kNoSymbol;
+                    pos = itemStart;
+                    break;
+                }
+            }
+
+            if (pos < tokens.size()) {
+                // Lex the unfinished item again once more input is there
+                keepFrom = tokens[pos].offset - windowOffset;
+                lexer.rewind(tokens[pos]);
+            }
+            windowPosition = LineIndex::advance(windowPosition, std::string_view(window).substr(0, keepFrom));
+            window.erase(0, keepFrom);
+            windowOffset += keepFrom;
+            tokens.clear();
+            streamArena.reset();
+        }
+    } catch (const std::exception& e) {
+        arena = nullptr;
+        moreInput = false;
+        // Errors only come from tokens of the current window
+        LineIndex lines(window, windowOffset, windowPosition);
+        if (const auto* source = dynamic_cast<const RuneSourceError*>(&e)) {
+            throw locatedError(e.what(), lines.locate(source->getOffset()));
+        }
+        throw locatedError(e.what(), lines.locate(currentOffset));
+    } catch (...) {
+        arena = nullptr;
+        moreInput = false;
+        throw;
+    }
+    arena = nullptr;
+    out.flush();
+}
+
+void RuneParser::parseStream(std::istream& in, OutputSink& out, size_t chunkSize) {
+    parseChunks([&in](char* buffer, size_t size) {
+        in.read(buffer, size);
+        return static_cast<size_t>(in.gcount());
+    }, out, chunkSize);
+}
+
+void RuneParser::parseStream(int fd, OutputSink& out, size_t chunkSize) {
+    parseChunks([fd](char* buffer, size_t size) {
+        for (;;) {
+            ssize_t received = ::read(fd, buffer, size);
+            if (received >= 0) return static_cast<size_t>(received);
+            if (errno != EINTR) {
+                RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to read rune source");
+            }
+        }
+    }, out, chunkSize);
 }
 
 std::string RuneParser::handleCustomType(const std::string& code, size_t& pos) {
@@ -224,52 +574,81 @@ std::string RuneParser::handleCustomType(const std::string& code, size_t& pos) {
     return "typedef int " + typeName + ";";
 }
 
-std::string RuneParser::handleSwitch(const std::string& code, size_t& pos) {
-    std::string switchCode;
-    pos++; // Move past the switch rune
-
-    // Skip whitespace
-    while (pos < code.length() && std::isspace(code[pos])) pos++;
-
-    // Get the switch variable
-    std::string switchVariable;
-    while (pos < code.length() && !std::isspace(code[pos]) && code[pos] != '{') {
-        switchVariable += code[pos++];
+void RuneParser::compileToCpp(const std::string& runeCode, OutputSink& out) {
+    if (cache) {
+        // Cached code comes back whole, so its headers are read off it
+        const std::string cppCode = parseRuneCode(runeCode);
+        out.append(prologueFor(cppCode));
+        out.append(cppCode);
+    } else {
+        // The headers go first but depend on the code, so the tree is
+        // emitted twice: once to find them, once into `out`
+        RuneArena parseArena;
+        const Program* program = parseWhole(runeCode, parseArena);
+        HeaderSink headers;
+        CppEmitter(headers).emit(*program);
+        out.append(headers.prologue());
+        CppEmitter(out).emit(*program);
     }
+    out.append(kEpilogue);
+    out.flush();
+}
 
-    switchCode += "switch (" + switchVariable + ") {\n";
+bool RuneParser::writeTranslationUnit(const std::string& outputPath, std::string_view cppCode) {
+    const std::string prologue = prologueFor(cppCode);
+    const std::string_view pieces[] = {prologue, cppCode, kEpilogue};
+    // An untouched file keeps its mtime, so build tools do not recompile it
+    if (hasContents(outputPath, pieces)) return false;
 
-    // Process cases
-    while (pos < code.length()) {
-        std::string caseRune(1, code[pos]);
-        if (caseRune == "ᚲ") { // If it's a case rune
-            pos++; // Move past the case rune
-            std::string caseValue;
-            while (pos < code.length() && !std::isspace(code[pos]) && code[pos] != '}') {
-                caseValue += code[pos++];
-            }
-            switchCode += "case " + caseValue + ": \n";
-        } else if (caseRune == "ᛞ") { // If it's a default case
-            pos++; // Move past the default rune
-            switchCode += "default: \n";
-        } else if (caseRune == "}") { // End of switch
-            switchCode += "}\n";
-            break;
-        } else {
-            // Handle unexpected characters
-            throw RuneParseError("Unexpected character in switch statement");
+    // Written beside the target and renamed over it, so readers see either
+    // the old file or the whole new one
+    std::string temporary = outputPath + ".XXXXXX";
+    int fd = ::mkstemp(&temporary[0]);
+    if (fd < 0) {
+        RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to create " + temporary);
+    }
+    try {
+        // Large pieces bypass the sink's staging buffer, so the generated
+        // code goes from cppCode to the kernel without another copy
+        FdSink outputFile(fd);
+        for (std::string_view piece : pieces) outputFile.append(piece);
+        outputFile.flush();
+        // mkstemp creates the file private to its owner; give it the mode
+        // a plain create would have
+        if (::fchmod(fd, 0666 & ~creationMask()) != 0) {
+            RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to set permissions of " + temporary);
         }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        throw;
     }
-
-    return switchCode;
+    if (::close(fd) != 0 || ::rename(temporary.c_str(), outputPath.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        RUNE_THROW(RuneError::ErrorCode::FILE_ERROR, "Failed to write " + outputPath);
+    }
+    return true;
 }
 
-std::string RuneParser::compileToCpp(const std::string& runeCode) {
+std::string RuneParser::compileToCpp(const std::string& runeCode, const std::string& outputPath) {
     std::string cppCode = parseRuneCode(runeCode);
-    std::ofstream outputFile("output.cpp");
-    outputFile << "#include <iostream>\n\n" << cppCode << "\nint main() {\n\treturn 0;\n}";
-    outputFile.close();
+    writeTranslationUnit(outputPath, cppCode);
     return cppCode;
 }
 
+std::string RuneParser::compileToCpp(const std::string& runeCode) {
+    return compileToCpp(runeCode, "output.cpp");
+}
+
+bool RuneParser::compileFile(const std::string& inputPath, const std::string& outputPath) {
+    RuneMappedFile file(inputPath);
+    // The includes depend on the code, so all of it is generated first
+    std::string cppCode;
+    {
+        StringSink out(cppCode, StringSink::estimateFor(file.size()));
+        parseSource(file.contents(), out);
+    }
+    return writeTranslationUnit(outputPath, cppCode);
+}
+
 } // namespace RuneLang
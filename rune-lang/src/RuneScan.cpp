@@ -0,0 +1,242 @@
+#include "../include/RuneScan.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define RUNE_SCAN_X86 1
+#endif
+
+namespace RuneLang {
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || (static_cast<unsigned char>(c) - 9u) < 5u;
+}
+
+inline unsigned lowestBit(uint32_t mask) {
+    return static_cast<unsigned>(__builtin_ctz(mask));
+}
+
+inline unsigned highestBit(uint32_t mask) {
+    return 31u - static_cast<unsigned>(__builtin_clz(mask));
+}
+
+// Accounts for the newlines in `mask`, whose bit i stands for block[i]
+inline void countNewlines(uint32_t mask, const char* block, size_t& newlines, const char*& lastNewline) {
+    if (mask) {
+        newlines += static_cast<size_t>(__builtin_popcount(mask));
+        lastNewline = block + highestBit(mask);
+    }
+}
+
+// Scalar kernels, also used for the tails the vector kernels leave over
+
+const char* findByteScalar(const char* p, const char* end, char c) {
+    while (p < end && *p != c) p++;
+    return p;
+}
+
+const char* skipWhitespaceScalar(const char* p, const char* end,
+                                 size_t& newlines, const char*& lastNewline) {
+    while (p < end && isSpace(*p)) {
+        if (*p == '\n') {
+            newlines++;
+            lastNewline = p;
+        }
+        p++;
+    }
+    return p;
+}
+
+const char* findSequence3Scalar(const char* p, const char* end, const char* sequence) {
+    while (end - p >= 3) {
+        if (p[0] == sequence[0] && p[1] == sequence[1] && p[2] == sequence[2]) return p;
+        p++;
+    }
+    return end;
+}
+
+#ifdef RUNE_SCAN_X86
+
+// SSE2 kernels, 16 bytes per step. SSE2 is part of the x86-64 baseline, so
+// the SIMD path is x86-64 only; 32-bit x86 keeps the scalar kernels.
+
+const char* findByteSSE2(const char* p, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        if (mask) return p + lowestBit(mask);
+        p += 16;
+    }
+    return findByteScalar(p, end, c);
+}
+
+const char* skipWhitespaceSSE2(const char* p, const char* end,
+                               size_t& newlines, const char*& lastNewline) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    while (end - p >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // '\t'..'\r' are the five bytes with (c - '\t') <= 4 unsigned
+        const __m128i control = _mm_sub_epi8(block, tab);
+        const __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(control, four), control);
+        const __m128i isSpaceByte = _mm_or_si128(_mm_cmpeq_epi8(block, space), isControl);
+
+        const uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(isSpaceByte)) & 0xFFFFu;
+        const uint32_t lines = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        if (stop) {
+            const unsigned n = lowestBit(stop);
+            countNewlines(lines & ((1u << n) - 1), p, newlines, lastNewline);
+            return p + n;
+        }
+        countNewlines(lines, p, newlines, lastNewline);
+        p += 16;
+    }
+    return skipWhitespaceScalar(p, end, newlines, lastNewline);
+}
+
+const char* findSequence3SSE2(const char* p, const char* end, const char* sequence) {
+    const __m128i first = _mm_set1_epi8(sequence[0]);
+    const __m128i second = _mm_set1_epi8(sequence[1]);
+    const __m128i third = _mm_set1_epi8(sequence[2]);
+
+    // Each step reads 18 bytes to test 16 starting positions
+    while (end - p >= 18) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+        const __m128i match = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, second)),
+                                            _mm_cmpeq_epi8(c, third));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+        if (mask) return p + lowestBit(mask);
+        p += 16;
+    }
+    return findSequence3Scalar(p, end, sequence);
+}
+
+// AVX2 kernels, 32 bytes per step, only called after a runtime check
+
+__attribute__((target("avx2")))
+const char* findByteAVX2(const char* p, const char* end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        if (mask) return p + lowestBit(mask);
+        p += 32;
+    }
+    return findByteSSE2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* skipWhitespaceAVX2(const char* p, const char* end,
+                               size_t& newlines, const char*& lastNewline) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    while (end - p >= 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i control = _mm256_sub_epi8(block, tab);
+        const __m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(control, four), control);
+        const __m256i isSpaceByte = _mm256_or_si256(_mm256_cmpeq_epi8(block, space), isControl);
+
+        const uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(isSpaceByte));
+        const uint32_t lines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        if (stop) {
+            const unsigned n = lowestBit(stop);
+            countNewlines(n ? lines & ((1u << n) - 1) : 0, p, newlines, lastNewline);
+            return p + n;
+        }
+        countNewlines(lines, p, newlines, lastNewline);
+        p += 32;
+    }
+    return skipWhitespaceSSE2(p, end, newlines, lastNewline);
+}
+
+__attribute__((target("avx2")))
+const char* findSequence3AVX2(const char* p, const char* end, const char* sequence) {
+    const __m256i first = _mm256_set1_epi8(sequence[0]);
+    const __m256i second = _mm256_set1_epi8(sequence[1]);
+    const __m256i third = _mm256_set1_epi8(sequence[2]);
+
+    while (end - p >= 34) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+        const __m256i match = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, second)),
+            _mm256_cmpeq_epi8(c, third));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(match));
+        if (mask) return p + lowestBit(mask);
+        p += 32;
+    }
+    return findSequence3SSE2(p, end, sequence);
+}
+
+#endif // RUNE_SCAN_X86
+
+const ScanKernels kScalarKernels = {findByteScalar, skipWhitespaceScalar, findSequence3Scalar};
+#ifdef RUNE_SCAN_X86
+const ScanKernels kSSE2Kernels = {findByteSSE2, skipWhitespaceSSE2, findSequence3SSE2};
+const ScanKernels kAVX2Kernels = {findByteAVX2, skipWhitespaceAVX2, findSequence3AVX2};
+#endif
+
+ScanLevel& currentLevel() {
+    static ScanLevel level = detectScanLevel();
+    return level;
+}
+
+} // namespace
+
+ScanLevel detectScanLevel() {
+#ifdef RUNE_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return ScanLevel::AVX2;
+    return ScanLevel::SSE2;
+#else
+    return ScanLevel::Scalar;
+#endif
+}
+
+const ScanKernels& scanKernels(ScanLevel level) {
+    if (level > detectScanLevel()) level = detectScanLevel();
+    switch (level) {
+#ifdef RUNE_SCAN_X86
+    case ScanLevel::AVX2:
+        return kAVX2Kernels;
+    case ScanLevel::SSE2:
+        return kSSE2Kernels;
+#endif
+    default:
+        return kScalarKernels;
+    }
+}
+
+const ScanKernels& activeScanKernels() {
+    return scanKernels(currentLevel());
+}
+
+ScanLevel activeScanLevel() {
+    return currentLevel();
+}
+
+void setScanLevel(ScanLevel level) {
+    currentLevel() = level > detectScanLevel() ? detectScanLevel() : level;
+}
+
+const char* scanLevelName(ScanLevel level) {
+    switch (level) {
+    case ScanLevel::SSE2: return "sse2";
+    case ScanLevel::AVX2: return "avx2";
+    case ScanLevel::Scalar:
+    default: return "scalar";
+    }
+}
+
+} // namespace RuneLang
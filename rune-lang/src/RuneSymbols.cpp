@@ -0,0 +1,156 @@
+#include "../include/RuneSymbols.hpp"
+
+namespace RuneLang {
+
+namespace {
+
+constexpr size_t kInitialSlots = 256;
+
+} // namespace
+
+StringInterner::StringInterner() : names_(1), hashes_(1), slots_(kInitialSlots, kNoSymbol) {}
+
+uint32_t StringInterner::hash(std::string_view text) {
+    // FNV-1a; identifiers are short, so this beats anything fancier
+    uint32_t h = 2166136261u;
+    for (char c : text) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+size_t StringInterner::slotFor(std::string_view text, uint32_t h) const {
+    const size_t mask = slots_.size() - 1;
+    size_t slot = h & mask;
+    while (slots_[slot] != kNoSymbol) {
+        const SymbolId id = slots_[slot];
+        if (hashes_[id] == h && names_[id] == text) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+SymbolId StringInterner::find(std::string_view text) const {
+    return slots_[slotFor(text, hash(text))];
+}
+
+SymbolId StringInterner::intern(std::string_view text) {
+    const uint32_t h = hash(text);
+    size_t slot = slotFor(text, h);
+    if (slots_[slot] != kNoSymbol) return slots_[slot];
+
+    const SymbolId id = static_cast<SymbolId>(names_.size());
+    names_.push_back(storage_.copy(text));
+    hashes_.push_back(h);
+    slots_[slot] = id;
+    // Keep the load factor at or below one half
+    if (names_.size() * 2 > slots_.size()) grow();
+    return id;
+}
+
+void StringInterner::clear() {
+    storage_.reset();
+    names_.resize(1);
+    hashes_.resize(1);
+    slots_.assign(kInitialSlots, kNoSymbol);
+}
+
+void StringInterner::grow() {
+    std::vector<SymbolId> slots(slots_.size() * 2, kNoSymbol);
+    const size_t mask = slots.size() - 1;
+    for (SymbolId id = 1; id < names_.size(); id++) {
+        size_t slot = hashes_[id] & mask;
+        while (slots[slot] != kNoSymbol) slot = (slot + 1) & mask;
+        slots[slot] = id;
+    }
+    slots_.swap(slots);
+}
+
+uint32_t* SymbolTable::scopeSlot(SymbolId owner, SymbolId name, bool create) {
+    if (owner == kNoSymbol) {
+        if (name >= globalScope_.size()) {
+            if (!create) return nullptr;
+            globalScope_.resize(name + 1, kNone);
+        }
+        return &globalScope_[name];
+    }
+    if (create) return &memberScopes_.try_emplace(memberKey(owner, name), kNone).first->second;
+    auto it = memberScopes_.find(memberKey(owner, name));
+    return it == memberScopes_.end() ? nullptr : &it->second;
+}
+
+bool SymbolTable::declare(SymbolKind kind, SymbolId name, SymbolId owner, uint64_t offset, bool defined) {
+    const uint32_t index = static_cast<uint32_t>(declarations_.size());
+    uint32_t* slot = scopeSlot(owner, name, true);
+    uint32_t previous = kNone;
+    bool duplicate = false;
+
+    if (*slot == kNone) {
+        *slot = index;
+    } else {
+        const Declaration& current = declarations_[*slot];
+        duplicate = defined && current.defined;
+        // A definition supersedes a forward declaration, nothing else does
+        if (!duplicate && defined && !current.defined) {
+            previous = *slot;
+            *slot = index;
+        }
+    }
+
+    declarations_.push_back(Declaration{kind, defined, name, owner, offset, previous});
+    if (duplicate) duplicates_.push_back(index);
+    return !duplicate;
+}
+
+void SymbolTable::reference(SymbolId name) {
+    if (name >= referenceCounts_.size()) referenceCounts_.resize(name + 1, 0);
+    if (referenceCounts_[name]++ == 0) referenced_.push_back(name);
+    if (marked_) pendingReferences_.push_back(name);
+}
+
+const Declaration* SymbolTable::lookup(SymbolId name, SymbolId owner) const {
+    uint32_t index = kNone;
+    if (owner == kNoSymbol) {
+        if (name < globalScope_.size()) index = globalScope_[name];
+    } else {
+        auto it = memberScopes_.find(memberKey(owner, name));
+        if (it != memberScopes_.end()) index = it->second;
+    }
+    return index == kNone ? nullptr : &declarations_[index];
+}
+
+SymbolTable::Mark SymbolTable::mark() {
+    marked_ = true;
+    pendingReferences_.clear();
+    return Mark{declarations_.size(), duplicates_.size()};
+}
+
+void SymbolTable::rollback(const Mark& mark) {
+    while (declarations_.size() > mark.declarations) {
+        const uint32_t index = static_cast<uint32_t>(declarations_.size() - 1);
+        const Declaration& declaration = declarations_.back();
+        uint32_t* slot = scopeSlot(declaration.owner, declaration.name, false);
+        if (slot && *slot == index) *slot = declaration.previous;
+        declarations_.pop_back();
+    }
+    for (SymbolId name : pendingReferences_) referenceCounts_[name]--;
+    pendingReferences_.clear();
+    duplicates_.resize(mark.duplicates);
+}
+
+void SymbolTable::clear() {
+    // Global scope slots are only set by declarations
+    for (const Declaration& declaration : declarations_) {
+        if (declaration.owner == kNoSymbol) globalScope_[declaration.name] = kNone;
+    }
+    for (SymbolId name : referenced_) referenceCounts_[name] = 0;
+    referenced_.clear();
+    declarations_.clear();
+    duplicates_.clear();
+    memberScopes_.clear();
+    pendingReferences_.clear();
+    marked_ = false;
+}
+
+} // namespace RuneLang
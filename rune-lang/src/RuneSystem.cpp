@@ -4,15 +4,73 @@
 #include <unistd.h>
 #include <iostream>
 #include <stdexcept>
+#include <cerrno>
 #include <cstring>
 #include <sys/wait.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <time.h>
+#include <sys/sysinfo.h>
+#include <sys/utsname.h>
 
 namespace RuneLang {
 
+// RuneSystem implementation
+std::string RuneSystem::getOSVersion() {
+    struct utsname name;
+    if (uname(&name) != 0) {
+        return "unknown";
+    }
+    return std::string(name.sysname) + " " + name.release;
+}
+
+std::string RuneSystem::getHostname() {
+    char name[256];
+    if (gethostname(name, sizeof(name)) != 0) {
+        return "unknown";
+    }
+    name[sizeof(name) - 1] = '\0';
+    return name;
+}
+
+unsigned RuneSystem::getCPUCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? static_cast<unsigned>(count) : 1;
+}
+
+uint64_t RuneSystem::getTotalMemory() {
+    struct sysinfo info;
+    if (sysinfo(&info) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(info.totalram) * info.mem_unit;
+}
+
+uint64_t RuneSystem::getAvailableMemory() {
+    struct sysinfo info;
+    if (sysinfo(&info) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(info.freeram + info.bufferram) * info.mem_unit;
+}
+
+uint64_t RuneSystem::getUptime() {
+    struct sysinfo info;
+    if (sysinfo(&info) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(info.uptime);
+}
+
+void RuneSystem::sleep(unsigned milliseconds) {
+    struct timespec remaining = {static_cast<time_t>(milliseconds / 1000),
+                                 static_cast<long>(milliseconds % 1000) * 1000000L};
+    while (nanosleep(&remaining, &remaining) != 0 && errno == EINTR) {
+    }
+}
+
 // RuneProcess implementation
 RuneProcess::RuneProcess() : pid_(0) {}
 
@@ -0,0 +1,120 @@
+#include "../include/RuneTokenBuffer.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace RuneLang {
+
+namespace {
+
+// Source bytes lexed per batch; the scratch tokens stay in L2
+constexpr size_t kLexBatch = 64 * 1024;
+
+void checkSize(std::string_view source) {
+    if (source.size() > std::numeric_limits<uint32_t>::max()) {
+        RUNE_THROW(RuneError::ErrorCode::MEMORY_ERROR,
+                   "Source of " + std::to_string(source.size()) + " bytes is too large for a TokenBuffer");
+    }
+}
+
+} // namespace
+
+void TokenBuffer::lex(std::string_view source) {
+    RuneLexer lexer;
+    lex(source, lexer);
+}
+
+void TokenBuffer::lex(std::string_view source, RuneLexer& lexer) {
+    checkSize(source);
+    clear();
+    source_ = source;
+    // A guess on the low side; growth and the trim below cover the rest
+    const size_t expected = source.size() / 8;
+    kinds_.reserve(expected);
+    flags_.reserve(expected);
+    offsets_.reserve(expected);
+    lengths_.reserve(expected);
+
+    std::vector<Token> batch;
+    batch.reserve(kLexBatch / 2);
+    lexer.reset();
+    size_t pos = 0;
+    size_t end = 0;
+    do {
+        // The window always grows, so a token longer than a batch is
+        // passed again with more input until it is complete
+        end = std::min(source.size(), end + kLexBatch);
+        pos += lexer.tokenizeChunk(source.substr(pos, end - pos), end == source.size(), batch);
+        append(batch);
+        batch.clear();
+    } while (end < source.size());
+
+    // The buffer usually outlives the lex, so give back what growth left over
+    if (kinds_.capacity() > kinds_.size() + kinds_.size() / 8) {
+        kinds_.shrink_to_fit();
+        flags_.shrink_to_fit();
+        offsets_.shrink_to_fit();
+        lengths_.shrink_to_fit();
+    }
+}
+
+void TokenBuffer::assign(std::string_view source, const std::vector<Token>& tokens) {
+    checkSize(source);
+    clear();
+    source_ = source;
+    kinds_.reserve(tokens.size());
+    flags_.reserve(tokens.size());
+    offsets_.reserve(tokens.size());
+    lengths_.reserve(tokens.size());
+    append(tokens);
+}
+
+void TokenBuffer::clear() {
+    source_ = std::string_view();
+    kinds_.clear();
+    flags_.clear();
+    offsets_.clear();
+    lengths_.clear();
+}
+
+void TokenBuffer::append(const std::vector<Token>& tokens) {
+    for (const Token& token : tokens) {
+        kinds_.push_back(static_cast<uint8_t>(token.kind));
+        flags_.push_back(token.flags);
+        offsets_.push_back(static_cast<uint32_t>(token.offset));
+        lengths_.push_back(static_cast<uint32_t>(token.text.size()));
+    }
+}
+
+uint8_t TokenBuffer::rune(size_t i) const {
+    if (kind(i) != TokenKind::Rune) return 0;
+    char32_t codepoint = 0;
+    const char* p = source_.data() + offsets_[i];
+    decodeUtf8(p, source_.data() + source_.size(), codepoint);
+    return static_cast<uint8_t>(codepoint - kRuneBlockFirst);
+}
+
+Token TokenBuffer::token(size_t i) const {
+    Token token;
+    token.kind = kind(i);
+    token.flags = flags_[i];
+    token.rune = rune(i);
+    token.offset = offsets_[i];
+    token.text = text(i);
+    return token;
+}
+
+void TokenBuffer::toTokens(std::vector<Token>& tokens) const {
+    tokens.reserve(tokens.size() + size());
+    for (size_t i = 0; i < size(); i++) tokens.push_back(token(i));
+}
+
+size_t TokenBuffer::lowerBound(uint64_t offset) const {
+    return static_cast<size_t>(std::lower_bound(offsets_.begin(), offsets_.end(), offset) - offsets_.begin());
+}
+
+size_t TokenBuffer::memoryUsage() const {
+    return kinds_.capacity() + flags_.capacity() +
+           (offsets_.capacity() + lengths_.capacity()) * sizeof(uint32_t);
+}
+
+} // namespace RuneLang
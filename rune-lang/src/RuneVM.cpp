@@ -0,0 +1,650 @@
+#include "../include/RuneVM.hpp"
+#include "../include/RuneError.hpp"
+#include "../include/RuneLineIndex.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// Computed goto saves the bounds check and the shared indirect branch of a
+// switch; every handler ends in its own jump, which predicts far better
+#if defined(__GNUC__) || defined(__clang__)
+#define RUNE_VM_THREADED 1
+#endif
+
+namespace RuneLang {
+
+namespace {
+
+// Builtins. Each one forwards to the runtime class its prefix names.
+
+Value systemOSVersion(RuneVM& vm, const Value*, uint8_t) {
+    return vm.makeString(RuneSystem::getOSVersion());
+}
+
+Value systemHostname(RuneVM& vm, const Value*, uint8_t) {
+    return vm.makeString(RuneSystem::getHostname());
+}
+
+Value systemCPUCount(RuneVM&, const Value*, uint8_t) {
+    return Value::integer(RuneSystem::getCPUCount());
+}
+
+Value systemTotalMemory(RuneVM&, const Value*, uint8_t) {
+    return Value::integer(static_cast<int64_t>(RuneSystem::getTotalMemory()));
+}
+
+Value systemAvailableMemory(RuneVM&, const Value*, uint8_t) {
+    return Value::integer(static_cast<int64_t>(RuneSystem::getAvailableMemory()));
+}
+
+Value systemUptime(RuneVM&, const Value*, uint8_t) {
+    return Value::integer(static_cast<int64_t>(RuneSystem::getUptime()));
+}
+
+Value systemSleep(RuneVM& vm, const Value* args, uint8_t) {
+    const int64_t milliseconds = vm.intArg(args, 0);
+    // Whatever was printed before the pause should be visible during it
+    vm.output().flush();
+    RuneSystem::sleep(milliseconds > 0 ? static_cast<unsigned>(milliseconds) : 0);
+    return Value::integer(0);
+}
+
+Value processStart(RuneVM& vm, const Value* args, uint8_t) {
+    return Value::integer(vm.startProcess(std::string(vm.stringArg(args, 0))));
+}
+
+Value processStop(RuneVM& vm, const Value* args, uint8_t) {
+    vm.process(vm.intArg(args, 0)).stop();
+    return Value::integer(0);
+}
+
+Value processIsRunning(RuneVM& vm, const Value* args, uint8_t) {
+    return Value::boolean(vm.process(vm.intArg(args, 0)).isRunning());
+}
+
+Value processGetPid(RuneVM& vm, const Value* args, uint8_t) {
+    return Value::integer(vm.process(vm.intArg(args, 0)).getPid());
+}
+
+Value fileCreateFile(RuneVM& vm, const Value* args, uint8_t argc) {
+    const std::string content = argc > 1 ? std::string(vm.stringArg(args, 1)) : std::string();
+    return Value::boolean(RuneFileSystem::createFile(std::string(vm.stringArg(args, 0)), content));
+}
+
+Value fileDeleteFile(RuneVM& vm, const Value* args, uint8_t) {
+    return Value::boolean(RuneFileSystem::deleteFile(std::string(vm.stringArg(args, 0))));
+}
+
+Value fileCreateDirectory(RuneVM& vm, const Value* args, uint8_t) {
+    return Value::boolean(RuneFileSystem::createDirectory(std::string(vm.stringArg(args, 0))));
+}
+
+Value fileDeleteDirectory(RuneVM& vm, const Value* args, uint8_t) {
+    return Value::boolean(RuneFileSystem::deleteDirectory(std::string(vm.stringArg(args, 0))));
+}
+
+constexpr std::string_view kSystem = "RuneSystem::";
+constexpr std::string_view kProcess = "RuneProcess::";
+constexpr std::string_view kFile = "RuneFileSystem::";
+
+// Process handles are indices into the VM's process list
+const Builtin kBuiltins[] = {
+    {kSystem, "getOSVersion", 0, 0, systemOSVersion},
+    {kSystem, "getHostname", 0, 0, systemHostname},
+    {kSystem, "getCPUCount", 0, 0, systemCPUCount},
+    {kSystem, "getTotalMemory", 0, 0, systemTotalMemory},
+    {kSystem, "getAvailableMemory", 0, 0, systemAvailableMemory},
+    {kSystem, "getUptime", 0, 0, systemUptime},
+    {kSystem, "sleep", 1, 1, systemSleep},
+    {kProcess, "start", 1, 1, processStart},
+    {kProcess, "stop", 1, 1, processStop},
+    {kProcess, "isRunning", 1, 1, processIsRunning},
+    {kProcess, "getPid", 1, 1, processGetPid},
+    {kFile, "createFile", 1, 2, fileCreateFile},
+    {kFile, "deleteFile", 1, 1, fileDeleteFile},
+    {kFile, "createDirectory", 1, 1, fileCreateDirectory},
+    {kFile, "deleteDirectory", 1, 1, fileDeleteDirectory},
+};
+
+inline bool isNumber(const Value& v) {
+    return v.type != ValueType::String;
+}
+
+inline double toDouble(const Value& v) {
+    switch (v.type) {
+    case ValueType::Float: return v.f;
+    case ValueType::Bool: return v.b ? 1.0 : 0.0;
+    default: return static_cast<double>(v.i);
+    }
+}
+
+inline int64_t toInt(const Value& v) {
+    switch (v.type) {
+    case ValueType::Float: return static_cast<int64_t>(v.f);
+    case ValueType::Bool: return v.b ? 1 : 0;
+    default: return v.i;
+    }
+}
+
+inline bool truthy(const Value& v) {
+    switch (v.type) {
+    case ValueType::Float: return v.f != 0;
+    case ValueType::Bool: return v.b;
+    case ValueType::String: return true; // A non-null const char* in C++
+    default: return v.i != 0;
+    }
+}
+
+inline uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline int32_t readI32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return static_cast<int32_t>(value);
+}
+
+} // namespace
+
+int findBuiltin(std::string_view prefix, std::string_view name) {
+    for (size_t i = 0; i < sizeof(kBuiltins) / sizeof(kBuiltins[0]); i++) {
+        if (kBuiltins[i].prefix == prefix && kBuiltins[i].name == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+const Builtin& builtin(uint16_t index) {
+    return kBuiltins[index];
+}
+
+RuneVM::RuneVM(OutputSink& out) : out_(out), stack_(new Value[kStackSize]) {}
+
+RuneVM::~RuneVM() = default;
+
+Value RuneVM::makeString(std::string text) {
+    if (heap_.size() >= collectAt_) collect();
+    heap_.push_back(std::make_unique<std::string>(std::move(text)));
+    return Value::string(heap_.back().get());
+}
+
+// Mark and sweep: a string survives when a global or a stack slot below
+// top_ points to it. Dead slots may keep a string alive a little longer;
+// nothing reachable is ever freed.
+void RuneVM::collect() {
+    std::vector<const std::string*> live;
+    auto mark = [&live](const Value& value) {
+        if (value.type == ValueType::String) live.push_back(value.s);
+    };
+    for (const Value& value : globals_) mark(value);
+    for (const Value* slot = stack_.get(); slot != top_; ++slot) mark(*slot);
+    std::sort(live.begin(), live.end());
+
+    heap_.erase(std::remove_if(heap_.begin(), heap_.end(),
+                               [&live](const std::unique_ptr<std::string>& text) {
+                                   return !std::binary_search(live.begin(), live.end(), text.get());
+                               }),
+                heap_.end());
+    // Collecting again only after the heap doubles keeps the cost per
+    // string constant
+    collectAt_ = std::max(kMinCollect, 2 * heap_.size());
+}
+
+std::string_view RuneVM::stringArg(const Value* args, uint8_t index) const {
+    if (args[index].type != ValueType::String) {
+        fail("argument " + std::to_string(index + 1) + " must be a string");
+    }
+    return *args[index].s;
+}
+
+int64_t RuneVM::intArg(const Value* args, uint8_t index) const {
+    if (!isNumber(args[index])) fail("argument " + std::to_string(index + 1) + " must be a number");
+    return toInt(args[index]);
+}
+
+RuneProcess& RuneVM::process(int64_t handle) {
+    if (handle < 1 || static_cast<uint64_t>(handle) > processes_.size()) {
+        fail("invalid process handle " + std::to_string(handle));
+    }
+    return *processes_[handle - 1];
+}
+
+int64_t RuneVM::startProcess(const std::string& command) {
+    auto process = std::make_unique<RuneProcess>();
+    if (!process->start(command)) return 0;
+    processes_.push_back(std::move(process));
+    return static_cast<int64_t>(processes_.size());
+}
+
+void RuneVM::fail(const std::string& message) const {
+    throw RuneSourceError(message, errorFunction_ ? errorFunction_->offsetAt(errorPc_) : 0);
+}
+
+void RuneVM::print(const Value& value) {
+    char buffer[32];
+    switch (value.type) {
+    case ValueType::Int: {
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value.i);
+        out_.append(std::string_view(buffer, result.ptr - buffer));
+        break;
+    }
+    case ValueType::Float: {
+        // Matches the default formatting of std::ostream
+        const int length = std::snprintf(buffer, sizeof(buffer), "%g", value.f);
+        out_.append(std::string_view(buffer, static_cast<size_t>(length)));
+        break;
+    }
+    case ValueType::Bool:
+        out_.append(value.b ? '1' : '0');
+        break;
+    case ValueType::Char:
+        out_.append(static_cast<char>(value.i));
+        break;
+    case ValueType::String:
+        out_.append(*value.s);
+        break;
+    }
+}
+
+void RuneVM::run(const Script& script) {
+    globals_.assign(script.globals, Value::integer(0));
+    frames_.clear();
+    frames_.reserve(kMaxCallDepth);
+    heap_.clear();
+    collectAt_ = kMinCollect;
+    top_ = stack_.get();
+    try {
+        execute(script);
+    } catch (...) {
+        out_.flush();
+        throw;
+    }
+    out_.flush();
+}
+
+void RuneVM::execute(const Script& script) {
+    const Value* const constants = script.constants.data();
+    Value* const globals = globals_.data();
+    Value* const stackEnd = stack_.get() + kStackSize;
+
+    const BytecodeFunction* function = &script.functions[0];
+    const uint8_t* code = function->code.data();
+    const uint8_t* pc = code;
+    Value* base = stack_.get();
+    Value* sp = base + function->locals;
+    if (sp + function->maxStack > stackEnd) fail("script needs too much stack");
+    for (Value* slot = base; slot != sp; ++slot) *slot = Value::integer(0);
+
+    const uint8_t* start = pc; // Start of the instruction being executed
+
+// Raises a runtime error located at the current instruction
+#define VM_ERROR(message)                              \
+    do {                                               \
+        errorFunction_ = function;                     \
+        errorPc_ = static_cast<size_t>(start - code);  \
+        fail(message);                                 \
+    } while (0)
+
+// Integer arithmetic when both sides are integers or bools, otherwise
+// floating point; strings are rejected
+#define VM_ARITHMETIC(op, name)                                                  \
+    do {                                                                         \
+        Value& a = sp[-2];                                                       \
+        const Value& b = sp[-1];                                                 \
+        if (a.type == ValueType::Float || b.type == ValueType::Float) {          \
+            if (!isNumber(a) || !isNumber(b)) VM_ERROR("cannot " name " a string"); \
+            a = Value::real(toDouble(a) op toDouble(b));                         \
+        } else {                                                                 \
+            if (!isNumber(a) || !isNumber(b)) VM_ERROR("cannot " name " a string"); \
+            a = Value::integer(static_cast<int64_t>(static_cast<uint64_t>(toInt(a)) op static_cast<uint64_t>(toInt(b)))); \
+        }                                                                        \
+        --sp;                                                                    \
+    } while (0)
+
+#define VM_INTEGER(op, name)                                                     \
+    do {                                                                         \
+        Value& a = sp[-2];                                                       \
+        const Value& b = sp[-1];                                                 \
+        if (a.type == ValueType::Float || b.type == ValueType::Float ||          \
+            !isNumber(a) || !isNumber(b)) {                                      \
+            VM_ERROR("operands of " name " must be integers");                  \
+        }                                                                        \
+        a = Value::integer(toInt(a) op toInt(b));                                \
+        --sp;                                                                    \
+    } while (0)
+
+#define VM_COMPARE(op)                                                           \
+    do {                                                                         \
+        Value& a = sp[-2];                                                       \
+        const Value& b = sp[-1];                                                 \
+        bool result;                                                             \
+        if (a.type == ValueType::String && b.type == ValueType::String) {        \
+            result = a.s->compare(*b.s) op 0;                                    \
+        } else if (!isNumber(a) || !isNumber(b)) {                               \
+            VM_ERROR("cannot compare a string with a number");                   \
+        } else if (a.type == ValueType::Float || b.type == ValueType::Float) {   \
+            result = toDouble(a) op toDouble(b);                                 \
+        } else {                                                                 \
+            result = toInt(a) op toInt(b);                                       \
+        }                                                                        \
+        a = Value::boolean(result);                                              \
+        --sp;                                                                    \
+    } while (0)
+
+// Converts the value on top to a variable's type, as C++ does on a store
+#define VM_CONVERT(type, converted)                                              \
+    do {                                                                         \
+        Value& a = sp[-1];                                                       \
+        if (!isNumber(a)) VM_ERROR("cannot convert a string to " type);          \
+        a = converted;                                                           \
+    } while (0)
+
+#ifdef RUNE_VM_THREADED
+    static const void* const kDispatch[] = {
+#define RUNE_OPCODE_LABEL(name) &&op_##name,
+        RUNE_OPCODES(RUNE_OPCODE_LABEL)
+#undef RUNE_OPCODE_LABEL
+    };
+#define VM_CASE(name) op_##name:
+#define VM_NEXT()                            \
+    do {                                     \
+        start = pc;                          \
+        goto *kDispatch[*pc++];              \
+    } while (0)
+    VM_NEXT();
+#else
+#define VM_CASE(name) case OpCode::name:
+#define VM_NEXT() continue
+    for (;;) {
+        start = pc;
+        switch (static_cast<OpCode>(*pc++)) {
+#endif
+
+    VM_CASE(Constant) {
+        *sp++ = constants[readU16(pc)];
+        pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(Pop) {
+        --sp;
+        VM_NEXT();
+    }
+    VM_CASE(LoadGlobal) {
+        *sp++ = globals[readU16(pc)];
+        pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(StoreGlobal) {
+        globals[readU16(pc)] = sp[-1];
+        pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(LoadLocal) {
+        *sp++ = base[readU16(pc)];
+        pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(StoreLocal) {
+        base[readU16(pc)] = sp[-1];
+        pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(Add) {
+        if (sp[-2].type == ValueType::String && sp[-1].type == ValueType::String) {
+            top_ = sp;
+            sp[-2] = makeString(*sp[-2].s + *sp[-1].s);
+            --sp;
+            VM_NEXT();
+        }
+        VM_ARITHMETIC(+, "add");
+        VM_NEXT();
+    }
+    VM_CASE(Subtract) {
+        VM_ARITHMETIC(-, "subtract");
+        VM_NEXT();
+    }
+    VM_CASE(Multiply) {
+        VM_ARITHMETIC(*, "multiply");
+        VM_NEXT();
+    }
+    VM_CASE(Divide) {
+        Value& a = sp[-2];
+        const Value& b = sp[-1];
+        if (!isNumber(a) || !isNumber(b)) VM_ERROR("cannot divide a string");
+        if (a.type == ValueType::Float || b.type == ValueType::Float) {
+            a = Value::real(toDouble(a) / toDouble(b));
+        } else {
+            const int64_t divisor = toInt(b);
+            if (divisor == 0) VM_ERROR("division by zero");
+            const int64_t dividend = toInt(a);
+            a = Value::integer(divisor == -1 ? static_cast<int64_t>(0 - static_cast<uint64_t>(dividend))
+                                             : dividend / divisor);
+        }
+        --sp;
+        VM_NEXT();
+    }
+    VM_CASE(Modulo) {
+        Value& a = sp[-2];
+        const Value& b = sp[-1];
+        if (!isNumber(a) || !isNumber(b)) VM_ERROR("cannot take the remainder of a string");
+        if (a.type == ValueType::Float || b.type == ValueType::Float) {
+            a = Value::real(std::fmod(toDouble(a), toDouble(b)));
+        } else {
+            const int64_t divisor = toInt(b);
+            if (divisor == 0) VM_ERROR("division by zero");
+            a = Value::integer(divisor == -1 ? 0 : toInt(a) % divisor);
+        }
+        --sp;
+        VM_NEXT();
+    }
+    VM_CASE(ShiftLeft) {
+        Value& a = sp[-2];
+        const Value& b = sp[-1];
+        if (a.type == ValueType::Float || b.type == ValueType::Float || !isNumber(a) || !isNumber(b)) {
+            VM_ERROR("operands of << must be integers");
+        }
+        a = Value::integer(static_cast<int64_t>(static_cast<uint64_t>(toInt(a)) << (toInt(b) & 63)));
+        --sp;
+        VM_NEXT();
+    }
+    VM_CASE(ShiftRight) {
+        Value& a = sp[-2];
+        const Value& b = sp[-1];
+        if (a.type == ValueType::Float || b.type == ValueType::Float || !isNumber(a) || !isNumber(b)) {
+            VM_ERROR("operands of >> must be integers");
+        }
+        a = Value::integer(toInt(a) >> (toInt(b) & 63));
+        --sp;
+        VM_NEXT();
+    }
+    VM_CASE(BitAnd) {
+        VM_INTEGER(&, "&");
+        VM_NEXT();
+    }
+    VM_CASE(BitOr) {
+        VM_INTEGER(|, "|");
+        VM_NEXT();
+    }
+    VM_CASE(BitXor) {
+        VM_INTEGER(^, "^");
+        VM_NEXT();
+    }
+    VM_CASE(Equal) {
+        VM_COMPARE(==);
+        VM_NEXT();
+    }
+    VM_CASE(NotEqual) {
+        VM_COMPARE(!=);
+        VM_NEXT();
+    }
+    VM_CASE(Less) {
+        VM_COMPARE(<);
+        VM_NEXT();
+    }
+    VM_CASE(LessEqual) {
+        VM_COMPARE(<=);
+        VM_NEXT();
+    }
+    VM_CASE(Greater) {
+        VM_COMPARE(>);
+        VM_NEXT();
+    }
+    VM_CASE(GreaterEqual) {
+        VM_COMPARE(>=);
+        VM_NEXT();
+    }
+    VM_CASE(Negate) {
+        Value& a = sp[-1];
+        if (a.type == ValueType::Float) {
+            a = Value::real(-a.f);
+        } else if (isNumber(a)) {
+            a = Value::integer(static_cast<int64_t>(0 - static_cast<uint64_t>(toInt(a))));
+        } else {
+            VM_ERROR("cannot negate a string");
+        }
+        VM_NEXT();
+    }
+    VM_CASE(Not) {
+        sp[-1] = Value::boolean(!truthy(sp[-1]));
+        VM_NEXT();
+    }
+    VM_CASE(BitNot) {
+        Value& a = sp[-1];
+        if (a.type == ValueType::Float || !isNumber(a)) VM_ERROR("operand of ~ must be an integer");
+        a = Value::integer(~toInt(a));
+        VM_NEXT();
+    }
+    VM_CASE(ToBool) {
+        sp[-1] = Value::boolean(truthy(sp[-1]));
+        VM_NEXT();
+    }
+    VM_CASE(ToInt) {
+        VM_CONVERT("int", Value::integer(static_cast<int32_t>(static_cast<uint32_t>(toInt(a)))));
+        VM_NEXT();
+    }
+    VM_CASE(ToLong) {
+        VM_CONVERT("long", Value::integer(toInt(a)));
+        VM_NEXT();
+    }
+    VM_CASE(ToUnsigned) {
+        VM_CONVERT("unsigned", Value::integer(static_cast<uint32_t>(toInt(a))));
+        VM_NEXT();
+    }
+    VM_CASE(ToFloat) {
+        VM_CONVERT("float", Value::real(static_cast<float>(toDouble(a))));
+        VM_NEXT();
+    }
+    VM_CASE(ToDouble) {
+        VM_CONVERT("double", Value::real(toDouble(a)));
+        VM_NEXT();
+    }
+    VM_CASE(ToChar) {
+        VM_CONVERT("char", Value::character(static_cast<char>(toInt(a))));
+        VM_NEXT();
+    }
+    VM_CASE(Jump) {
+        pc += 4 + readI32(pc);
+        VM_NEXT();
+    }
+    VM_CASE(JumpIfFalse) {
+        const int32_t distance = readI32(pc);
+        pc += 4;
+        if (!truthy(*--sp)) pc += distance;
+        VM_NEXT();
+    }
+    VM_CASE(JumpIfFalseOrPop) {
+        const int32_t distance = readI32(pc);
+        pc += 4;
+        if (!truthy(sp[-1])) {
+            pc += distance;
+        } else {
+            --sp;
+        }
+        VM_NEXT();
+    }
+    VM_CASE(JumpIfTrueOrPop) {
+        const int32_t distance = readI32(pc);
+        pc += 4;
+        if (truthy(sp[-1])) {
+            pc += distance;
+        } else {
+            --sp;
+        }
+        VM_NEXT();
+    }
+    VM_CASE(Print) {
+        print(*--sp);
+        VM_NEXT();
+    }
+    VM_CASE(Call) {
+        const BytecodeFunction* callee = &script.functions[readU16(pc)];
+        pc += 2;
+        if (frames_.size() == kMaxCallDepth) VM_ERROR("call stack overflow");
+        if (sp + callee->locals + callee->maxStack > stackEnd) VM_ERROR("stack overflow");
+        frames_.push_back({function, pc, base});
+        function = callee;
+        code = pc = callee->code.data();
+        base = sp;
+        sp += callee->locals;
+        for (Value* slot = base; slot != sp; ++slot) *slot = Value::integer(0);
+        VM_NEXT();
+    }
+    VM_CASE(CallBuiltin) {
+        const Builtin& target = kBuiltins[readU16(pc)];
+        const uint8_t argc = pc[2];
+        pc += 3;
+        errorFunction_ = function;
+        errorPc_ = static_cast<size_t>(start - code);
+        top_ = sp;
+        sp -= argc;
+        *sp = target.call(*this, sp, argc);
+        ++sp;
+        VM_NEXT();
+    }
+    VM_CASE(Return) {
+        const Value result = sp[-1];
+        if (frames_.empty()) return;
+        const Frame& caller = frames_.back();
+        sp = base;
+        *sp++ = result;
+        function = caller.function;
+        code = function->code.data();
+        pc = caller.returnPc;
+        base = caller.base;
+        frames_.pop_back();
+        VM_NEXT();
+    }
+    VM_CASE(Halt) {
+        return;
+    }
+
+#ifndef RUNE_VM_THREADED
+        default:
+            VM_ERROR("invalid instruction");
+        }
+    }
+#endif
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_ERROR
+#undef VM_ARITHMETIC
+#undef VM_INTEGER
+#undef VM_COMPARE
+#undef VM_CONVERT
+}
+
+void runScript(std::string_view source, OutputSink& out) {
+    const Script script = compileScript(source);
+    RuneVM vm(out);
+    try {
+        vm.run(script);
+    } catch (const RuneSourceError& e) {
+        const SourcePosition position = LineIndex(source).locate(e.getOffset());
+        throw RuneRuntimeError(e.what(), position.line, position.column);
+    }
+}
+
+} // namespace RuneLang
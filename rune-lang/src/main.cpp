@@ -1,7 +1,21 @@
+#include "../include/RuneDaemon.hpp"
+#include "../include/RuneDriver.hpp"
+#include "../include/RuneMappedFile.hpp"
+#include "../include/RuneOptimizer.hpp"
 #include "../include/RuneParser.hpp"
+#include "../include/RuneVM.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
 
-int main() {
+namespace {
+
+void runExamples() {
     RuneLang::RuneParser parser;
 
     // Example 1: Custom type definition
@@ -33,6 +47,246 @@ int main() {
     std::cout << "Example 5 - Function definition:\n";
     std::cout << "Rune code: " << runeCode5 << "\n";
     std::cout << "C++ code: " << parser.parseRuneCode(runeCode5) << "\n\n";
+}
 
+void printReport(const RuneLang::CompileReport& report) {
+    const double megabytes = report.bytes / (1024.0 * 1024.0);
+    std::printf("compiled %zu files (%.1f MB) on %u workers in %.3f s, %.1f MB/s\n",
+                report.files, megabytes, report.workers, report.wallSeconds,
+                report.wallSeconds > 0 ? megabytes / report.wallSeconds : 0.0);
+    std::printf("latency p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+                report.percentile(0.50) * 1e3, report.percentile(0.90) * 1e3,
+                report.percentile(0.99) * 1e3, report.percentile(1.0) * 1e3);
+    if (report.unchanged) std::printf("%zu outputs already up to date\n", report.unchanged);
+}
+
+int usage() {
+    std::cerr << "usage: rune_lang compile [-j workers] [-o output-dir] [--cache dir] [-O] [--scaling]"
+                 " <file or directory>...\n"
+                 "       rune_lang run [--disassemble] <file>\n"
+                 "       rune_lang ir [-O] <file>\n"
+                 "       rune_lang daemon [--socket path] [-j workers] [--cache-mb size]\n"
+                 "       rune_lang client [--socket path] [-O] parse <file> | compile <input> <output> | stats | stop\n";
+    return 2;
+}
+
+// Runs a script on the bytecode VM instead of going through C++
+int run(int argc, char** argv) {
+    bool disassemble = false;
+    const char* path = nullptr;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--disassemble") == 0) {
+            disassemble = true;
+        } else if (argv[i][0] == '-' || path) {
+            return usage();
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) return usage();
+
+    RuneLang::RuneMappedFile file(path);
+    if (disassemble) {
+        std::cout << RuneLang::compileScript(file.contents()).disassemble();
+        return 0;
+    }
+    RuneLang::FdSink out(STDOUT_FILENO);
+    try {
+        RuneLang::runScript(file.contents(), out);
+    } catch (const std::exception& e) {
+        std::cerr << path << ": " << e.what() << "\n";
+        return 1;
+    }
     return 0;
 }
+
+// Prints the syntax tree, and with -O the tree after the optimizations too
+int dumpIr(int argc, char** argv) {
+    bool optimize = false;
+    const char* path = nullptr;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "-O") == 0) {
+            optimize = true;
+        } else if (argv[i][0] == '-' || path) {
+            return usage();
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) return usage();
+
+    RuneLang::RuneMappedFile file(path);
+    RuneLang::RuneParser parser;
+    RuneLang::RuneArena arena;
+    RuneLang::Program* program = parser.parse(file.contents(), arena);
+    if (!optimize) {
+        std::cout << RuneLang::dumpProgram(*program);
+        return 0;
+    }
+    std::cout << "; before\n" << RuneLang::dumpProgram(*program);
+    const RuneLang::FoldStats stats = RuneLang::ConstantFolder(arena).fold(*program);
+    const size_t dropped = RuneLang::pruneUnreferenced(*program);
+    std::cout << "; after: " << stats.constants << " constants folded, " << stats.identities
+              << " identities removed, " << stats.branches << " branches resolved, " << dropped
+              << " unreferenced definitions dropped\n"
+              << RuneLang::dumpProgram(*program);
+    return 0;
+}
+
+int compile(int argc, char** argv) {
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    std::string outputDir;
+    std::string cacheDir;
+    bool scaling = false;
+    bool optimize = false;
+    std::vector<std::string> inputs;
+
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if (std::strcmp(argv[i], "-O") == 0) {
+            optimize = true;
+        } else if (argv[i][0] == '-') {
+            return usage();
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (inputs.empty()) return usage();
+
+    const std::vector<RuneLang::CompileJob> jobs = RuneLang::RuneDriver::planJobs(inputs, outputDir);
+    std::unique_ptr<RuneLang::RuneCache> cache;
+    if (!cacheDir.empty()) cache = std::make_unique<RuneLang::RuneCache>(cacheDir);
+    RuneLang::CompileReport report = RuneLang::RuneDriver::compile(jobs, workers, cache.get(), optimize);
+
+    if (scaling) {
+        // Same inputs on 1, 2, 4, ... workers; speedup is against one
+        // worker. Each run compiles everything: no cache, and an emptied
+        // scratch directory, so no output is found up to date.
+        const std::filesystem::path scratch =
+            std::filesystem::temp_directory_path() / ("rune_scaling." + std::to_string(getpid()));
+        std::printf("workers  wall s   speedup  efficiency\n");
+        double single = 0;
+        for (unsigned count = 1;; count = std::min(count * 2, workers)) {
+            std::filesystem::remove_all(scratch);
+            const std::vector<RuneLang::CompileJob> scratchJobs =
+                RuneLang::RuneDriver::planJobs(inputs, scratch.string());
+            const RuneLang::CompileReport run = RuneLang::RuneDriver::compile(scratchJobs, count, nullptr, optimize);
+            if (count == 1) single = run.wallSeconds;
+            const double speedup = run.wallSeconds > 0 ? single / run.wallSeconds : 0;
+            std::printf("%7u  %7.3f  %7.2f  %9.0f%%\n", count, run.wallSeconds, speedup, 100 * speedup / count);
+            if (count == workers) break;
+        }
+        std::filesystem::remove_all(scratch);
+    }
+
+    printReport(report);
+    if (cache) {
+        const RuneLang::CacheStats stats = cache->stats();
+        std::printf("cache %llu hits, %llu misses, %.1f MB not recompiled, %llu entries (%.1f MB), %llu evicted\n",
+                    static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                    stats.bytesSaved / (1024.0 * 1024.0), static_cast<unsigned long long>(stats.entries),
+                    stats.diskBytes / (1024.0 * 1024.0), static_cast<unsigned long long>(stats.evictions));
+    }
+    for (const RuneLang::CompileFailure& failure : report.failures) {
+        std::cerr << failure.input << ": " << failure.message << "\n";
+    }
+    return report.failures.empty() ? 0 : 1;
+}
+
+// Per user, so daemons of different users never meet
+std::string defaultSocketPath() {
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR")) return std::string(runtime) + "/rune_lang.sock";
+    return "/tmp/rune_lang-" + std::to_string(getuid()) + ".sock";
+}
+
+int serveDaemon(int argc, char** argv) {
+    std::string socketPath = defaultSocketPath();
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t cacheBytes = RuneLang::RuneDaemon::kDefaultCacheBytes;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            workers = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+            cacheBytes = static_cast<uint64_t>(std::max(0, std::atoi(argv[++i]))) << 20;
+        } else {
+            return usage();
+        }
+    }
+
+    RuneLang::RuneDaemon server(socketPath, workers, cacheBytes);
+    std::fprintf(stderr, "listening on %s with %u workers\n", socketPath.c_str(), workers);
+    server.serve();
+    std::fprintf(stderr, "%s\n", server.stats().format().c_str());
+    return 0;
+}
+
+// Sends one request to a running daemon
+int sendToDaemon(int argc, char** argv) {
+    std::string socketPath = defaultSocketPath();
+    uint8_t flags = 0;
+    int i = 0;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "-O") == 0) {
+            flags |= RuneLang::DaemonOptimize;
+        } else {
+            return usage();
+        }
+    }
+    const int operands = argc - i - 1;
+    if (operands < 0) return usage();
+    const char* command = argv[i];
+
+    RuneLang::RuneDaemonClient connection(socketPath);
+    if (std::strcmp(command, "parse") == 0 && operands == 1) {
+        RuneLang::RuneMappedFile file(argv[i + 1]);
+        const std::string code = connection.parse(file.contents(), flags);
+        std::fwrite(code.data(), 1, code.size(), stdout);
+    } else if (std::strcmp(command, "compile") == 0 && operands == 2) {
+        // The daemon resolves paths against its own working directory
+        connection.compile(std::filesystem::absolute(argv[i + 1]).string(),
+                           std::filesystem::absolute(argv[i + 2]).string(), flags);
+    } else if (std::strcmp(command, "stats") == 0 && operands == 0) {
+        std::printf("%s\n", connection.stats().c_str());
+    } else if (std::strcmp(command, "stop") == 0 && operands == 0) {
+        connection.shutdown();
+    } else {
+        return usage();
+    }
+    return 0;
+}
+
+int runCommand(const char* command, int argc, char** argv) {
+    if (std::strcmp(command, "compile") == 0) return compile(argc, argv);
+    if (std::strcmp(command, "ir") == 0) return dumpIr(argc, argv);
+    if (std::strcmp(command, "daemon") == 0) return serveDaemon(argc, argv);
+    if (std::strcmp(command, "client") == 0) return sendToDaemon(argc, argv);
+    if (std::strcmp(command, "run") == 0) return run(argc, argv);
+    return usage();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        runExamples();
+        return 0;
+    }
+    // Whatever stops a subcommand is reported the same way
+    try {
+        return runCommand(argv[1], argc - 2, argv + 2);
+    } catch (const std::exception& e) {
+        std::cerr << "rune_lang: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -3,12 +3,47 @@
 #include "RuneMonitor.hpp"
 #include "RuneLogger.hpp"
 #include "GhostSystem.hpp"
+#include "RuneCache.hpp"
+#include "RuneDaemon.hpp"
+#include "RuneDriver.hpp"
+#include "RuneEmitter.hpp"
+#include "RuneHash.hpp"
+#include "RuneOptimizer.hpp"
+#include "RuneParser.hpp"
+#include "RuneScan.hpp"
+#include "RuneVM.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace RuneLang;
 
+// Counts heap allocations so tests can put bounds on them
+static std::atomic<size_t> allocationCount{0};
+
+// Every form is replaced, array and sized ones included, so that no
+// allocation made by one pair is released by the other
+static void* countedAllocate(size_t size) {
+    allocationCount++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return countedAllocate(size); }
+void* operator new[](size_t size) { return countedAllocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
 void testSystemInitialization() {
     GhostSystem& system = GhostSystem::getInstance();
     assert(system.initialize() == true);
@@ -84,6 +119,985 @@ void testLogging() {
     LOG_CRITICAL("Critical message");
 }
 
+void testLexer() {
+    RuneLexer lexer;
+    std::vector<Token> tokens;
+    const std::string code = "ᚠ ᛟHello ᚢ 1ᛟ x42 ᛞ note\nᛨgetOSVersion()";
+    lexer.tokenize(code, tokens);
+
+    assert(tokens.size() == 8);
+    assert(tokens[0].kind == TokenKind::Rune && tokens[0].rune == 0x16A0 - kRuneBlockFirst);
+    assert(tokens[1].kind == TokenKind::String && tokens[1].text == "Hello ᚢ 1");
+    assert(tokens[1].hasFlag(RuneDelimited));
+    assert(tokens[2].kind == TokenKind::Identifier && tokens[2].text == "x42");
+    assert(tokens[3].kind == TokenKind::Comment && tokens[3].text == " note");
+    assert(tokens[4].kind == TokenKind::Rune && tokens[4].hasFlag(NewlineBefore));
+    assert(tokens[4].offset == 35);
+    assert(tokens[5].kind == TokenKind::Identifier && tokens[5].flags == 0);
+    assert(tokens[6].kind == TokenKind::Punct && tokens[6].text == "(");
+
+    // Positions are resolved on demand, with columns counted in codepoints
+    LineIndex lines(code);
+    SourcePosition position = lines.locate(tokens[2].offset);
+    assert(position.line == 1 && position.column == 15);
+    position = lines.locate(tokens[4].offset);
+    assert(position.line == 2 && position.column == 1);
+    position = LineIndex::advance(SourcePosition(), std::string_view(code).substr(0, tokens[5].offset));
+    assert(position.line == 2 && position.column == 2);
+    position = LineIndex(std::string_view(code).substr(22), 22, lines.locate(22)).locate(tokens[4].offset);
+    assert(position.line == 2 && position.column == 1);
+}
+
+void testRuneTable() {
+    static_assert(kRuneTable[U'ᚠ' - kRuneBlockFirst] == "std::cout << ");
+    static_assert(kRuneTable[U'ᛦ' - kRuneBlockFirst] == "double");
+    assert(kRuneTable[U'ᚸ' - kRuneBlockFirst].empty());
+}
+
+void testParser() {
+    RuneParser parser;
+    assert(parser.parseRuneCode("ᛚ x ᛃ 1 ᚹ 2") == "float x = 1 * 2");
+    assert(parser.parseRuneCode("ᚠ \"Hello, World!\\n\"") == "std::cout << \"Hello, World!\\n\"");
+    assert(parser.parseRuneCode("ᛏ x ᚢ 1") == "return x + 1");
+    assert(parser.parseRuneCode("ᚠ ᛟrunes ᚢ textᛟ") == "std::cout << \"runes ᚢ text\"");
+    assert(parser.parseRuneCode("ᛞ comment\nᚠ ᛨgetHostname()") == "// comment\nstd::cout << RuneSystem::getHostname()");
+    assert(parser.parseRuneCode("᛫deleteFile(path)") == "RuneFileSystem::deleteFile(path)");
+
+    try {
+        parser.parseRuneCode("ᚠ x\n  ᚸ");
+        assert(false && "Should not reach here");
+    } catch (const RuneParseError& e) {
+        assert(e.getLine() == 2);
+        assert(e.getColumn() == 3);
+    }
+
+    try {
+        parser.parseRuneCode("ᚠ ᛟunterminated");
+        assert(false && "Should not reach here");
+    } catch (const RuneParseError& e) {
+        assert(e.getLine() == 1);
+    }
+}
+
+void testSyntaxTree() {
+    RuneParser parser;
+    RuneArena arena;
+    std::string code = "ᛤ greet ᛒ ᚠ ᛟhiᛟ ᛘ\nᛥ Point { ᛚ x }";
+    Program* program = parser.parse(code, arena);
+
+    Node* node = program->items.first;
+    assert(node->kind == NodeKind::Function);
+    [[maybe_unused]] auto* function = static_cast<FunctionNode*>(node);
+    assert(function->returnType == "void" && function->name == "greet");
+    assert(function->body->children.first->kind == NodeKind::Text);
+    assert(function->body->children.last->kind == NodeKind::String);
+
+    node = node->next;
+    assert(node->kind == NodeKind::Class && node->next == nullptr);
+    assert(static_cast<ClassNode*>(node)->name == "Point");
+    assert(arena.blockCount() == 1);
+
+    assert(parser.parseRuneCode(code) == "void greet() { std::cout << \"hi\" }\nclass Point { float x };");
+    assert(parser.parseRuneCode("ᚷ(x) ᛒ ᛏ 1 ᛘ") == "if(x) { return 1 }");
+
+    try {
+        parser.parseRuneCode("ᛒ ᚠ x");
+        assert(false && "Should not reach here");
+    } catch (const RuneParseError& e) {
+        assert(e.getLine() == 1 && e.getColumn() == 1);
+    }
+
+    try {
+        parser.parseRuneCode("ᚠ x ᛘ");
+        assert(false && "Should not reach here");
+    } catch (const RuneParseError& e) {
+        assert(e.getColumn() == 5);
+    }
+}
+
+size_t parseAllocations(RuneParser& parser, const std::string& code) {
+    std::string out;
+    size_t before = allocationCount;
+    {
+        StringSink sink(out, StringSink::estimateFor(code.size()));
+        parser.parseRuneCode(code, sink);
+    }
+    return allocationCount - before;
+}
+
+void testOutputSinks() {
+    RuneParser parser;
+    std::string line = "ᚠ ᛟvalue: ᛟ ᛨgetUptime() ᚢ x ᛞ note\nᛤ f ᛒ ᛏ 1 ᛘ\n";
+    std::string small, large;
+    for (int i = 0; i < 10; i++) small += line;
+    for (int i = 0; i < 20000; i++) large += line;
+
+    // The symbol table keeps its storage for the next compilation, so a
+    // warm parser allocates only the output buffer, token vector, arena
+    // block and its bookkeeping
+    parseAllocations(parser, large);
+    assert(parseAllocations(parser, large) == parseAllocations(parser, small));
+    assert(parseAllocations(parser, large) <= 4);
+
+    std::string out;
+    {
+        StringSink sink(out);
+        parser.parseRuneCode(large, sink);
+        assert(sink.size() == parser.parseRuneCode(large).size());
+    }
+    assert(out == parser.parseRuneCode(large));
+
+    char path[] = "/tmp/rune_sink_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    {
+        FdSink sink(fd);
+        parser.compileToCpp("ᚠ x", sink);
+    }
+    close(fd);
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    assert(contents.str() == "#include <iostream>\n\nstd::cout << x\nint main() {\n\treturn 0;\n}");
+    unlink(path);
+}
+
+void testStreamingParse() {
+    RuneParser parser;
+    std::string code;
+    for (int i = 0; i < 200; i++) {
+        code += "ᛞ item " + std::to_string(i) + "\n";
+        code += "ᛤ f" + std::to_string(i) + " ᛒ ᚠ ᛟrune ᚢ textᛟ \"quoted\" ᛨgetUptime() ᛘ\n";
+        code += "ᛥ C" + std::to_string(i) + " { ᛚ value ᛃ 42 }\n";
+    }
+    const std::string expected = parser.parseRuneCode(code);
+
+    // Small chunks split runes, strings, comments and blocks at every offset
+    for (size_t chunkSize : {1, 2, 3, 7, 64, 4096}) {
+        std::istringstream in(code);
+        std::string out;
+        {
+            StringSink sink(out);
+            parser.parseStream(in, sink, chunkSize);
+        }
+        assert(out == expected);
+    }
+
+    try {
+        std::istringstream in("ᚠ x\nᛒ ᚠ y");
+        std::string out;
+        StringSink sink(out);
+        parser.parseStream(in, sink, 3);
+        assert(false && "Should not reach here");
+    } catch (const RuneParseError& e) {
+        assert(e.getLine() == 2 && e.getColumn() == 1);
+    }
+
+    // The error's line starts in a window that has already been dropped
+    try {
+        std::istringstream in("ᚠ x\nᚠ ᚠ ᚠ ᚠ ᚸ");
+        std::string out;
+        StringSink sink(out);
+        parser.parseStream(in, sink, 4);
+        assert(false && "Should not reach here");
+    } catch (const RuneParseError& e) {
+        assert(e.getLine() == 2 && e.getColumn() == 9);
+    }
+}
+
+void testParseFile() {
+    RuneParser parser;
+    std::string code = "ᛞ header\nᛤ main ᛒ ᚠ ᛟHello from a fileᛟ ᛏ 0 ᛘ\n";
+
+    char path[] = "/tmp/rune_file_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    [[maybe_unused]] const ssize_t written = write(fd, code.data(), code.size());
+    assert(written == static_cast<ssize_t>(code.size()));
+    close(fd);
+    assert(parser.parseFile(path) == parser.parseRuneCode(code));
+
+    // Empty files cannot be mapped but are valid input
+    fd = open(path, O_WRONLY | O_TRUNC);
+    close(fd);
+    assert(parser.parseFile(path).empty());
+    unlink(path);
+
+    try {
+        parser.parseFile(path);
+        assert(false && "Should not reach here");
+    } catch (const RuneError& e) {
+        assert(e.getCode() == RuneError::ErrorCode::FILE_ERROR);
+    }
+}
+
+void testScanKernels() {
+    // Whitespace runs, newlines and ᛟ at every alignment relative to a vector
+    std::string text;
+    for (int i = 0; i < 70; i++) {
+        text += std::string(i % 37, i % 3 ? ' ' : '\t') + (i % 5 ? "\n" : "") + "x";
+        text += std::string(i, 'a') + (i % 4 ? "ᛟ" : "ᛞ");
+    }
+    const char* end = text.data() + text.size();
+    [[maybe_unused]] const char* rune = "ᛟ";
+
+    [[maybe_unused]] const ScanKernels& scalar = scanKernels(ScanLevel::Scalar);
+    for (ScanLevel level : {ScanLevel::SSE2, ScanLevel::AVX2}) {
+        [[maybe_unused]] const ScanKernels& scan = scanKernels(level);
+        for (const char* p = text.data(); p < end; p++) {
+            assert(scan.findByte(p, end, '\n') == scalar.findByte(p, end, '\n'));
+            assert(scan.findSequence3(p, end, rune) == scalar.findSequence3(p, end, rune));
+
+            [[maybe_unused]] size_t newlines = 0, expectedNewlines = 0;
+            [[maybe_unused]] const char* lastNewline = nullptr;
+            [[maybe_unused]] const char* expectedLast = nullptr;
+            assert(scan.skipWhitespace(p, end, newlines, lastNewline) ==
+                   scalar.skipWhitespace(p, end, expectedNewlines, expectedLast));
+            assert(newlines == expectedNewlines && lastNewline == expectedLast);
+        }
+    }
+
+    // Every level lexes to the same tokens and positions
+    std::string code;
+    for (int i = 0; i < 50; i++) {
+        code += std::string(i, ' ') + "ᛞ comment " + std::to_string(i) + "\n\t\t";
+        code += "ᚠ ᛟmulti\nline " + std::string(i, 'r') + "ᛟ ᛨgetUptime()\n\n";
+    }
+    RuneLexer lexer;
+    std::vector<Token> expected;
+    const ScanLevel detected = activeScanLevel();
+    setScanLevel(ScanLevel::Scalar);
+    lexer.tokenize(code, expected);
+    for (ScanLevel level : {ScanLevel::SSE2, ScanLevel::AVX2}) {
+        setScanLevel(level);
+        std::vector<Token> tokens;
+        lexer.tokenize(code, tokens);
+        assert(tokens.size() == expected.size());
+        for (size_t i = 0; i < tokens.size(); i++) {
+            assert(tokens[i].text == expected[i].text && tokens[i].flags == expected[i].flags);
+            assert(tokens[i].offset == expected[i].offset);
+        }
+    }
+    setScanLevel(detected);
+}
+
+void testDiagnostics() {
+    RuneParser parser;
+    const std::string code = "ᚠ x ᚸ y\nᛘ\nᛥ ᛒ ᛘ\nᚠ ᛟokᛟ\n\xff ᚠ z\nᛤ f ᛒ ᚠ 1";
+    ParseResult result = parser.parseWithDiagnostics(code);
+    assert(!result.ok());
+
+    const auto& found = result.diagnostics.items();
+    [[maybe_unused]] const struct {
+        DiagnosticCode code;
+        uint32_t line;
+        uint32_t column;
+    } expected[] = {
+        {DiagnosticCode::UnknownRune, 1, 5},
+        {DiagnosticCode::UnmatchedBlockEnd, 2, 1},
+        {DiagnosticCode::ExpectedClassName, 3, 1},
+        {DiagnosticCode::InvalidUtf8, 5, 1},
+        {DiagnosticCode::UnterminatedBlock, 6, 5},
+    };
+    assert(found.size() == 5);
+    for (size_t i = 0; i < found.size(); i++) {
+        assert(found[i].code == expected[i].code);
+        assert(found[i].position.line == expected[i].line && found[i].position.column == expected[i].column);
+    }
+    assert(found[0].message() == "Unknown rune symbol: ᚸ");
+
+    // Everything around the errors is still translated
+    assert(result.code.find("std::cout << x") != std::string::npos);
+    assert(result.code.find("std::cout << \"ok\"") != std::string::npos);
+    assert(result.code.find("void f() { std::cout << 1}") != std::string::npos);
+
+    assert(parser.parseWithDiagnostics("ᛤ f ᛒ ᛏ 0 ᛘ").ok());
+
+    // The throwing interface reports the first problem with the same text
+    try {
+        parser.parseRuneCode("ᚠ x ᚸ y\nᛘ");
+        assert(false && "Should not reach here");
+    } catch (const RuneParseError& e) {
+        assert(std::string(e.what()) == "Line 1, Column 5: Unknown rune symbol: ᚸ");
+    }
+
+    // Reporting past the capacity only counts
+    std::string many;
+    for (int i = 0; i < 10; i++) many += "ᛘ\n";
+    DiagnosticList limited(4);
+    std::string out;
+    {
+        StringSink sink(out);
+        parser.parseWithDiagnostics(many, sink, limited);
+    }
+    assert(limited.items().size() == 4 && limited.dropped() == 6);
+}
+
+void testSymbols() {
+    StringInterner interner;
+    [[maybe_unused]] const SymbolId point = interner.intern("Point");
+    assert(point != kNoSymbol && interner.intern("Point") == point);
+    assert(interner.intern("point") != point);
+    assert(interner.find("missing") == kNoSymbol);
+    std::vector<SymbolId> ids;
+    for (int i = 0; i < 10000; i++) ids.push_back(interner.intern("name" + std::to_string(i)));
+    for (int i = 0; i < 10000; i++) assert(interner.name(ids[i]) == "name" + std::to_string(i));
+    assert(interner.find("Point") == point && interner.size() == 10002);
+
+    RuneParser parser;
+    const std::string code =
+        "ᛥ Point\n"
+        "ᛥ Point { ᛚ x ᛚ y ᛚ x ᛤ move ᛒ ᛚ step ᛘ }\n"
+        "ᛤ main ᛒ ᚠ x ᚢ y ᚢ Point ᛘ\n"
+        "ᛤ main ᛒ ᛏ 0 ᛘ\n";
+    parser.parseRuneCode(code);
+
+    const StringInterner& names = parser.identifiers();
+    const SymbolTable& symbols = parser.symbolTable();
+    const SymbolId cls = names.find("Point");
+    [[maybe_unused]] const Declaration* declaration = symbols.lookup(cls);
+    assert(declaration && declaration->kind == SymbolKind::Class && declaration->defined);
+    assert(symbols.lookup(names.find("x"), cls)->kind == SymbolKind::Member);
+    assert(symbols.lookup(names.find("move"), cls)->kind == SymbolKind::Method);
+    assert(symbols.lookup(names.find("step"), cls) == nullptr); // Local of move
+    assert(symbols.lookup(names.find("x")) == nullptr);
+    assert(symbols.lookup(names.find("main"))->kind == SymbolKind::Function);
+
+    // The second x member and the second main are duplicates; the forward
+    // declaration of Point is not
+    assert(symbols.duplicates().size() == 2);
+    assert(names.name(symbols.declarations()[symbols.duplicates()[0]].name) == "x");
+    assert(names.name(symbols.declarations()[symbols.duplicates()[1]].name) == "main");
+    assert(symbols.referenceCount(names.find("x")) == 1);
+    assert(symbols.referenceCount(cls) == 1);
+    [[maybe_unused]] const size_t declarations = symbols.declarations().size();
+
+    // Items parsed again while streaming do not declare twice
+    std::istringstream in(code);
+    std::string out;
+    {
+        StringSink sink(out);
+        parser.parseStream(in, sink, 1);
+    }
+    assert(symbols.declarations().size() == declarations && symbols.duplicates().size() == 2);
+    assert(symbols.referenceCount(names.find("x")) == 1);
+
+    ParseResult result = parser.parseWithDiagnostics(code);
+    assert(result.diagnostics.items().size() == 2);
+    assert(result.diagnostics.items()[1].code == DiagnosticCode::DuplicateDefinition);
+    assert(result.diagnostics.items()[1].position.line == 4);
+
+    // The next compilation starts with no symbols, whatever IDs the
+    // interner still holds
+    parser.parseRuneCode("ᛤ other ᛒ ᚠ y ᛘ\n");
+    assert(symbols.lookup(cls) == nullptr && symbols.lookup(names.find("main")) == nullptr);
+    assert(symbols.lookup(names.find("x"), cls) == nullptr);
+    assert(symbols.referenceCount(names.find("x")) == 0 && symbols.referenceCount(names.find("y")) == 1);
+    assert(symbols.lookup(names.find("other")) && symbols.declarations().size() == 1);
+
+    interner.clear();
+    assert(interner.size() == 0 && interner.find("Point") == kNoSymbol);
+    assert(interner.intern("name1") == 1 && interner.name(1) == "name1");
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+void testDriver() {
+    char root[] = "/tmp/rune_driver_XXXXXX";
+    [[maybe_unused]] const char* created = mkdtemp(root);
+    assert(created);
+    const std::string source = std::string(root) + "/src";
+    const std::string output = std::string(root) + "/out";
+    std::filesystem::create_directories(source + "/nested");
+
+    std::vector<std::string> files;
+    for (int i = 0; i < 24; i++) {
+        const std::string path = source + (i % 3 ? "/" : "/nested/") + "unit" + std::to_string(i) + ".rune";
+        std::ofstream(path) << "ᛤ unit" << i << " ᛒ ᚠ ᛟfile " << i << "ᛟ ᛘ\n";
+        files.push_back(path);
+    }
+    std::ofstream(source + "/broken.rune") << "ᛤ broken ᛒ ᚠ x\n";
+    std::ofstream(source + "/notes.txt") << "not rune source";
+
+    std::vector<CompileJob> jobs = RuneDriver::planJobs({source}, output);
+    assert(jobs.size() == 25);
+
+    CompileReport report = RuneDriver::compile(jobs, 3);
+    assert(report.files == 25 && report.workers == 3);
+    assert(report.latencies.size() == 25 && report.percentile(0.5) <= report.percentile(1.0));
+    assert(report.failures.size() == 1 && report.failures[0].input == source + "/broken.rune");
+
+    RuneParser parser;
+    std::string expected = parser.compileToCpp("ᛤ unit4 ᛒ ᚠ ᛟfile 4ᛟ ᛘ\n", output + "/single.cpp");
+    assert(readFile(output + "/nested/unit3.cpp").find("void unit3() { std::cout << \"file 3\" }") !=
+           std::string::npos);
+    assert(readFile(output + "/unit4.cpp") == readFile(output + "/single.cpp"));
+    assert(readFile(output + "/single.cpp").find(expected) != std::string::npos);
+
+    // Single files land next to their input without an output directory
+    jobs = RuneDriver::planJobs({files[1]});
+    assert(jobs.size() == 1 && jobs[0].output == source + "/unit1.cpp");
+
+    // Inputs that would share an output file are refused up front
+    const std::string first = std::string(root) + "/d1";
+    const std::string second = std::string(root) + "/d2";
+    std::filesystem::create_directories(first);
+    std::filesystem::create_directories(second);
+    std::ofstream(first + "/a.rune") << "ᚠ 1\n";
+    std::ofstream(second + "/a.rune") << "ᚠ 2\n";
+    [[maybe_unused]] bool refused = false;
+    try {
+        RuneDriver::planJobs({first, second}, output);
+    } catch (const RuneError& e) {
+        refused = e.getCode() == RuneError::ErrorCode::FILE_ERROR;
+    }
+    assert(refused);
+    assert(!std::filesystem::exists(output + "/a.cpp"));
+    assert(RuneDriver::planJobs({first, second}).size() == 2);
+
+    std::filesystem::remove_all(root);
+}
+
+void testCache() {
+    assert(hash64("abc", 3) == 0x44BC2CF5AD770999ull);
+
+    char root[] = "/tmp/rune_cache_XXXXXX";
+    [[maybe_unused]] const char* created = mkdtemp(root);
+    assert(created);
+    const std::string directory = std::string(root) + "/cache";
+    const std::string first = "ᛤ first ᛒ ᚠ ᛟone ᛟ ᛘ\n";
+    const std::string second = "ᛤ second ᛒ ᚠ ᛟtwo ᛟ ᛘ\n";
+    const std::string third = "ᛤ third ᛒ ᚠ ᛟthreeᛟ ᛘ\n";
+
+    RuneParser plain;
+    const std::string expected = plain.parseRuneCode(first);
+    const size_t entrySize = 32 + expected.size();
+    {
+        RuneCache cache(directory);
+        RuneParser parser;
+        parser.setCache(&cache);
+        assert(parser.parseRuneCode(first) == expected);
+        assert(parser.parseRuneCode(first) == expected);
+        assert(parser.parseRuneCode(second) == plain.parseRuneCode(second));
+
+        [[maybe_unused]] CacheStats stats = cache.stats();
+        assert(stats.hits == 1 && stats.misses == 2 && stats.stores == 2);
+        assert(stats.bytesSaved == first.size() && stats.entries == 2);
+        assert(!(RuneCache::keyFor(first) == RuneCache::keyFor(second)));
+    }
+
+    // A new cache on the same directory keeps the entries, and a corrupt
+    // entry is a miss that gets dropped
+    {
+        RuneCache cache(directory);
+        assert(cache.stats().entries == 2);
+        std::ofstream(directory + "/" + RuneCache::keyFor(second).hex() + ".rnc") << "garbage";
+        RuneParser parser;
+        parser.setCache(&cache);
+        assert(parser.parseRuneCode(first) == expected);
+        assert(parser.parseRuneCode(second) == plain.parseRuneCode(second));
+        [[maybe_unused]] CacheStats stats = cache.stats();
+        assert(stats.hits == 1 && stats.misses == 1 && stats.stores == 1 && stats.entries == 2);
+    }
+
+    // Room for two entries: using `first` makes `second` the eviction victim
+    {
+        std::filesystem::remove_all(directory);
+        RuneCache cache(directory, 2 * entrySize + 8);
+        RuneParser parser;
+        parser.setCache(&cache);
+        parser.parseRuneCode(first);
+        parser.parseRuneCode(second);
+        parser.parseRuneCode(first);
+        parser.parseRuneCode(third);
+        [[maybe_unused]] CacheStats stats = cache.stats();
+        assert(stats.evictions == 1 && stats.entries == 2 && stats.diskBytes <= 2 * entrySize + 8);
+        parser.parseRuneCode(first);
+        assert(cache.stats().hits == 2);
+        parser.parseRuneCode(second);
+        assert(cache.stats().hits == 2);
+    }
+
+    // Only finished entries are left behind
+    for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(directory)) {
+        assert(entry.path().extension() == ".rnc");
+    }
+    std::filesystem::remove_all(root);
+}
+
+std::string runToString(const std::string& source) {
+    std::string out;
+    {
+        StringSink sink(out);
+        runScript(source, sink);
+    }
+    return out;
+}
+
+void testVM() {
+    // Output items may be juxtaposed or separated by <<; integer and
+    // floating point arithmetic follow C++
+    assert(runToString("ᚠ ᛟa ᛟ 1 ᚢ 2 ᚹ 3 << \" \" << 7 ᚺ 2 << \" \" << 7.5 ᚺ 3\n") == "a 7 3 2.5");
+
+    // Variables, scopes, loops with break/continue, compound assignment
+    const std::string loops =
+        "ᛚ total ᛃ 0\n"
+        "ᚱ(ᛚ i ᛃ 0; i < 10; i++) {\n"
+        "    ᚷ(i ᛃᛃ 7) break\n"
+        "    ᚷ(i % 2 != 0) continue\n"
+        "    total += i\n"
+        "}\n"
+        "ᛚ n ᛃ 3\n"
+        "ᛉ(n > 0) { n-- }\n"
+        "ᚠ total \" \" n \" \" (total > 10 && n ᛃᛃ 0) \"\\n\"\n";
+    assert(runToString(loops) == "12 0 1\n");
+
+    // Functions may be called before their definition; main() runs last
+    const std::string functions =
+        "ᛝ greeting ᛃ ᛟhi ᛟ\n"
+        "ᚠ twice() \"\\n\"\n"
+        "ᛤ main ᛒ ᚠ ᛟmain ᛟ greeting \"\\n\" ᛘ\n"
+        "ᛚ twice ᛒ ᛏ 21 ᚹ 2 ᛘ\n";
+    assert(runToString(functions) == "42\nmain hi \n");
+
+    // Stored values take the declared type, so scripts print what the C++
+    // they compile to prints
+    assert(runToString("ᛚ x ᛃ 7\nᚠ x ᚺ 2") == "3.5");
+    assert(runToString("ᛠ d ᛃ 1\nᚠ d ᚺ 4") == "0.25");
+    assert(runToString("ᛚ f ᛃ 16777217\nᚠ f - 16777216") == "0");
+    assert(runToString("ᛡ b ᛃ 5\nᚠ b") == "1");
+    assert(runToString("ᛙ c ᛃ 65\nᚠ c \" \" c ᚢ 1") == "A 66");
+    assert(runToString("int i ᛃ 7.9\nᚠ i ᚺ 2 \" \" i ᚢ 0.5") == "3 7.5");
+    assert(runToString("int big ᛃ 4294967297\nunsigned u ᛃ -1\nᚠ big \" \" u") == "1 4294967295");
+    // Assignments, compound assignments and increments convert too, in
+    // locals as in globals
+    assert(runToString("ᛙ c ᛃ 64\nc++\nc += 1\nint n ᛃ 7\nn /= 2.0\nᚠ c \" \" n") == "B 3");
+    assert(runToString("ᛤ main ᛒ\nᛡ b ᛃ 0\nb ᛃ 7\nᛚ f\nf ᛃ 1\nᚠ b \" \" f ᚺ 4\nᛘ") == "1 0.25");
+
+    // Strings made at run time are freed once nothing refers to them
+    {
+        std::string out;
+        StringSink sink(out);
+        RuneVM vm(sink);
+        vm.run(compileScript("ᛝ s ᛃ ᛟᛟ\nᛝ t\nᚱ(int i ᛃ 0; i < 5000; i++) { s ᛃ s ᚢ ᛟxᛟ\nt ᛃ ᛟaᛟ ᚢ ᛟbᛟ }\n"
+                             "ᚠ s t"));
+        sink.flush();
+        assert(out == std::string(5000, 'x') + "ab");
+        assert(vm.heapStrings() < 2 * RuneVM::kMinCollect);
+    }
+
+    // System operations are bound straight to RuneSystem
+    assert(runToString("ᚠ ᛨgetCPUCount()") == std::to_string(RuneSystem::getCPUCount()));
+    assert(runToString("ᚷ(ᛨgetTotalMemory() > 0) ᚠ ᛟok ᛟ") == "ok ");
+
+    // File operations go through RuneFileSystem
+    const std::string path = "/tmp/rune_vm_test_" + std::to_string(getpid());
+    assert(runToString("ᚠ ᛫createFile(\"" + path + "\", \"x\") ᛫deleteFile(\"" + path + "\")") == "11");
+    assert(access(path.c_str(), F_OK) != 0);
+
+    // Unsupported or unknown code fails to compile at its location
+    try {
+        compileScript("ᛚ x ᛃ 1\nᚠ ᛨnoSuchCall()");
+        assert(false);
+    } catch (const RuneParseError& e) {
+        assert(e.getLine() == 2 && e.getColumn() == 3);
+    }
+    try {
+        compileScript("ᛥ Point { ᛚ x }");
+        assert(false);
+    } catch (const RuneParseError& e) {
+        assert(e.getLine() == 1);
+    }
+
+    // Runtime errors point at the failing operator and keep earlier output
+    std::string out;
+    try {
+        StringSink sink(out);
+        runScript("ᚠ ᛟbefore ᛟ\nint zero ᛃ 0\nᚠ 1 ᚺ zero", sink);
+        assert(false);
+    } catch (const RuneRuntimeError& e) {
+        assert(e.getLine() == 3 && e.getColumn() == 5);
+    }
+    assert(out == "before ");
+
+    // Runaway recursion is an error, not a crash
+    try {
+        runToString("ᛚ down ᛒ ᛏ down() ᛘ\nᚠ down()");
+        assert(false);
+    } catch (const RuneRuntimeError& e) {
+        assert(std::string(e.what()).find("call stack overflow") != std::string::npos);
+    }
+
+    const Script script = compileScript("ᛚ x ᛃ 2\nᚠ x ᚹ ᛨgetUptime()");
+    const std::string listing = script.disassemble();
+    assert(listing.find("CallBuiltin     RuneSystem::getUptime/0") != std::string::npos);
+    assert(listing.find("StoreGlobal") != std::string::npos);
+}
+
+void testParallelLexer() {
+    [[maybe_unused]] auto sameTokens = [](const std::vector<Token>& a, const std::vector<Token>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].kind != b[i].kind || a[i].flags != b[i].flags || a[i].rune != b[i].rune ||
+                a[i].offset != b[i].offset || a[i].text.data() != b[i].text.data() ||
+                a[i].text.size() != b[i].text.size()) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Strings spanning many lines put most piece starts inside a literal,
+    // some of them next to code that only lexes inside the string (ᚸ has
+    // no mapping but is fine as string content)
+    static const char* const fragments[] = {
+        "ᛚ x ᛃ 1 ᚢ 2\n", "ᚠ ᛟone\nᚸ two\n\nthree ᛟ x\n", "ᚠ \"a\\\"b\nᚸ \\\" c\n\" y\n",
+        "ᛞ comment with ᛟ and \" inside\n", "    \t\n\n", "ᛤ f ᛒ ᚠ ᛟxᛟ ᛘ\n", "ᚠ \"\"\n",
+        "ᚠ ᛟ\n", "\nlong ᛞ looking line\n", "ᛟ ᛞ\n",
+    };
+    uint64_t state = 12345;
+    auto next = [&state] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<size_t>(state >> 33);
+    };
+
+    RuneLexer serial;
+    RuneLexer parallel;
+    size_t identical = 0;
+    for (int round = 0; round < 200; round++) {
+        std::string source;
+        const size_t count = 1 + next() % 60;
+        for (size_t i = 0; i < count; i++) source += fragments[next() % 10];
+
+        std::vector<Token> expected;
+        std::string expectedError;
+        try {
+            serial.tokenize(source, expected);
+        } catch (const RuneSourceError& e) {
+            expectedError = std::string(e.what()) + "@" + std::to_string(e.getOffset());
+        }
+
+        for (unsigned workers : {2u, 3u, 8u}) {
+            std::vector<Token> tokens;
+            std::string error;
+            try {
+                parallel.tokenizeParallel(source, tokens, workers, 1 + next() % 64);
+            } catch (const RuneSourceError& e) {
+                error = std::string(e.what()) + "@" + std::to_string(e.getOffset());
+            }
+            assert(error == expectedError);
+            if (expectedError.empty()) {
+                assert(sameTokens(tokens, expected));
+                assert(parallel.offset() == source.size());
+                identical++;
+            }
+        }
+    }
+    assert(identical > 0);
+
+    // The parser can lex a large source on several threads
+    std::string large;
+    while (large.size() < (3 << 20)) large += "ᚠ ᛟline\nᛟ ᛨgetUptime() ᛞ note\nᛚ x ᛃ 1\n";
+    RuneParser parser;
+    const std::string expected = parser.parseRuneCode(large);
+    parser.setLexerThreads(4);
+    assert(parser.parseRuneCode(large) == expected);
+}
+
+void testTokenBuffer() {
+    // Long literals and comments cross the lexing batches
+    std::string source = "ᛤ main ᛒ\n    ᛚ x ᛃ 42 ᚢ y\n    ᚠ ᛟ" + std::string(100000, 's') +
+                         "ᛟ \"quoted\\\" text\"\n    ᛞ" + std::string(70000, 'c') + "\nᛘ\n";
+    for (int i = 0; i < 2000; i++) source += "ᚠ ᛟaᛟ x1 \"b\" ᛞ note\n";
+
+    std::vector<Token> expected;
+    RuneLexer lexer;
+    lexer.tokenize(source, expected);
+    TokenBuffer buffer;
+    buffer.lex(source);
+    assert(buffer.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        [[maybe_unused]] const Token token = buffer.token(i);
+        assert(token.kind == expected[i].kind && token.flags == expected[i].flags);
+        assert(token.rune == expected[i].rune && token.offset == expected[i].offset);
+        assert(token.text.data() == expected[i].text.data() && token.text.size() == expected[i].text.size());
+    }
+    assert(buffer.lowerBound(expected[5].offset) == 5);
+    assert(buffer.lowerBound(source.size()) == buffer.size());
+
+    TokenBuffer assigned;
+    assigned.assign(source, expected);
+    assert(assigned.size() == buffer.size() && assigned.text(7) == buffer.text(7));
+
+    // Errors are the lexer's, at the same offset
+    [[maybe_unused]] bool threw = false;
+    try {
+        buffer.lex("ᚠ ᛟnever closed");
+    } catch (const RuneSourceError& e) {
+        threw = e.getOffset() == 4;
+    }
+    assert(threw);
+
+    // Parsing from a shared lex gives the same code as parsing the source
+    RuneParser parser;
+    const std::string code = "ᛤ main ᛒ\n    ᛚ x ᛃ 42\n    ᚠ ᛟvalue: ᛟ x\nᛘ\n";
+    std::string direct;
+    std::string shared;
+    {
+        RuneArena arena;
+        StringSink out(direct);
+        CppEmitter(out).emit(*parser.parse(code, arena));
+    }
+    {
+        TokenBuffer tokens;
+        tokens.lex(code);
+        RuneArena arena;
+        StringSink out(shared);
+        CppEmitter(out).emit(*parser.parse(tokens, arena));
+    }
+    assert(!direct.empty() && direct == shared);
+
+    // Ten bytes a token, against a std::string per token
+    std::string large;
+    while (large.size() < (10u << 20)) large += "ᛚ total ᛃ count ᚢ 42 ᛞ running sum\nᚠ ᛟtotal: ᛟ total\n";
+    TokenBuffer big;
+    big.lex(large);
+    size_t stringBytes = big.size() * sizeof(std::string);
+    for (size_t i = 0; i < big.size(); i++) {
+        if (big.length(i) >= sizeof(std::string)) stringBytes += big.length(i) + 1;
+    }
+    assert(big.memoryUsage() < big.size() * 11);
+    assert(big.memoryUsage() * 3 < stringBytes);
+}
+
+void testConstantFolding() {
+    [[maybe_unused]] auto folded = [](const std::string& code) {
+        RuneParser parser;
+        parser.setOptimize(true);
+        return parser.parseRuneCode(code);
+    };
+
+    assert(folded("ᛚ blockSize ᛃ 1024 ᚹ 1024  ᛞ 1MB") == "float blockSize = 1048576 // 1MB\n");
+    assert(folded("ᚠ x ᚢ 2 ᚹ 3 ᚢ 4") == "std::cout << x + 6 + 4");
+    assert(folded("ᚠ 1 ᚢ 2 ᚼ x") == "std::cout << 3 << x");
+    assert(folded("x ᛃ f(1 ᚢ 2, 3 ᚹ 4) ᚹ (5 ᚦ 1)") == "x = f(3, 12) * (4)");
+    assert(folded("x ᛃ 0x10 ᚼ 2 ᚿ 1; y ᛃ ~0 ᚾ 255") == "x = 65; y = 255");
+    assert(folded("x ᛃ 7 ᚺ 2 ᚢ 1.5; y ᛃ 0 ᚦ 5 ᚹ 2") == "x = 4.5; y = (-10)");
+
+    // Folds that would change what C++ computes are left alone
+    for (const char* code : {"x = a - 1 + 2", "x = a == 1 | 2", "x = 65536 * 65536", "x = 1 / 0",
+                             "x = (int) 1.5 + 2.5", "x = 010 + 1", "x = 2147483647 + 1"}) {
+        std::string rune(code);
+        for (size_t at; (at = rune.find(" + ")) != std::string::npos;) rune.replace(at, 3, " ᚢ ");
+        assert(folded(rune) == code);
+    }
+
+    // A > that closes template arguments is not a comparison, and the group
+    // after it is a cast or constructor argument
+    assert(folded("x ᛃ static_cast<double>(1) ᚺ 2") == "x = static_cast<double>(1) / 2");
+    assert(folded("static_cast<int>(2) ᚹ 3") == "static_cast<int>(2) * 3");
+    assert(folded("std::vector<int>(2) ᚹ 3") == "std::vector<int>(2) * 3");
+    assert(folded("foo<a, b>(1) ᚹ 3; std::vector<std::vector<int>>(2) ᚹ 3") ==
+           "foo<a, b>(1) * 3; std::vector<std::vector<int>>(2) * 3");
+    assert(folded("x ᛃ a > (1 ᚢ 2)") == "x = a > (3)");
+
+    // Identities go only where the operand is promoted anyway
+    assert(folded("x ᛃ a ᚹ 1") == "x = a * 1");
+    assert(folded("x ᛃ c ᚹ 1 ᚢ 2") == "x = c + 2");
+    assert(folded("x ᛃ 1 ᚹ (a ᚦ b)") == "x = (a - b)");
+    assert(folded("x ᛃ a ᚢ 0 ᚢ b") == "x = a + 0 + b");
+    // One promoting operation stays when a chain reduces to its operand
+    assert(folded("ᚠ c ᚹ 1 ᚹ 1") == "std::cout << c * 1");
+    assert(folded("ᚠ c ᚹ 1 ᚺ 1") == "std::cout << c / 1");
+    assert(folded("ᚠ (c ᚹ 1) ᚹ 1") == "std::cout << (c * 1)");
+    assert(folded("ᚠ c ᚹ 1 ᚹ 1 ᚢ 2") == "std::cout << c + 2");
+
+    // Constant ᚷ conditions keep only the branch that runs
+    assert(folded("ᚷ(1 ᚦ 1) { a() } else { b() }") == "{ b() }");
+    assert(folded("ᚷ(2) { a() } else ᚷ(c) { b() } else { d() }") == "{ a() }");
+    assert(folded("ᚷ(0) { a() } else ᚷ(c) { b() }") == "if(c) { b() }");
+    assert(folded("ᚱ(;;) ᚷ(0) { a() }") == "for(;;) {}");
+    assert(folded("ᛤ main ᛒ ᚷ(0) { a() }\nᚠ 1 ᛘ") == "void main() {\nstd::cout << 1 }");
+    // A comment before else leaves the chain alone
+    assert(folded("ᚷ (0) { ᚠ a } ᛞ c\n else { ᚠ b }") == "if (0) { std::cout << a } // c\nelse { std::cout << b }");
+    assert(folded("ᚷ(1) { a() } else ᚷ(c) { b() } ᛞ c\nelse { d() }") ==
+           "if(1) { a() } else if(c) { b() } // c\nelse { d() }");
+
+    // The optimization is part of the cache key
+    const std::string dir = "/tmp/rune_fold_cache";
+    std::filesystem::remove_all(dir);
+    {
+        RuneCache cache(dir);
+        RuneParser plain;
+        plain.setCache(&cache);
+        RuneParser optimized;
+        optimized.setCache(&cache);
+        optimized.setOptimize(true);
+        assert(plain.parseRuneCode("x ᛃ 2 ᚹ 3") == "x = 2 * 3");
+        assert(optimized.parseRuneCode("x ᛃ 2 ᚹ 3") == "x = 6");
+        assert(plain.parseRuneCode("x ᛃ 2 ᚹ 3") == "x = 2 * 3");
+    }
+    std::filesystem::remove_all(dir);
+
+    // IR dumps show the tree before and after the pass
+    RuneParser parser;
+    RuneArena arena;
+    Program* program = parser.parse("ᛚ x ᛃ 2 ᚹ 3\nᛒ ᚠ ᛟhiᛟ ᛘ", arena);
+    assert(dumpProgram(*program) ==
+           "Program\n  Text \"float\" @0\n  Text \"x\" @4\n  Text \"=\" @6\n  Text \"2\" @10\n"
+           "  Text \"*\" @12\n  Text \"3\" @16\n  Block @18\n    Text \"std::cout << \" @22\n"
+           "    String \"hi\" @26\n");
+    [[maybe_unused]] const FoldStats stats = ConstantFolder(arena).fold(*program);
+    assert(stats.constants == 1 && stats.total() == 1);
+    assert(dumpProgram(*program).find("  Text \"6\" @10\n  Block @18\n") != std::string::npos);
+}
+
+void testMinimalPrologue() {
+    // Only headers for what the code uses
+    assert(prologueFor("x = 1;") == "");
+    assert(prologueFor("std::cout << std::string(\"a\")") == "#include <iostream>\n#include <string>\n\n");
+    assert(prologueFor("std::string_view s; mystd::cout << x; std::vectors") == "");
+    assert(prologueFor("std::vector<int> v; RuneFileSystem::createFile(p, c)") ==
+           "#include <vector>\n#include \"RuneSystem.hpp\"\nusing namespace RuneLang;\n\n");
+
+    RuneParser parser;
+    std::string unit;
+    {
+        StringSink sink(unit);
+        parser.compileToCpp("x ᛃ 1", sink);
+    }
+    assert(unit == "x = 1\nint main() {\n\treturn 0;\n}");
+
+    // Code that arrives in pieces gets the headers of the whole, wherever
+    // the pieces split a name
+    const std::string code = "a::std::cout; x:: std::vector<std::string_view> RuneMemory::f; std::string";
+    for (size_t i = 0; i <= code.size(); i++) {
+        for (size_t j = i; j <= code.size(); j += 7) {
+            UsedHeaders headers;
+            headers.scan(std::string_view(code).substr(0, i));
+            headers.scan(std::string_view(code).substr(i, j - i));
+            headers.scan(std::string_view(code).substr(j));
+            assert(headers.prologue() == prologueFor(code));
+        }
+    }
+    // Units streamed to a sink match ones built from the finished code,
+    // with names crossing the sink's staging buffer
+    std::string large;
+    for (int i = 0; i < 3000; i++) large += i % 500 ? "ᛟ value" + std::to_string(i) + "ᛟ\n" : "ᛚ v ᛃ 1\n";
+    large += "ᛨgetUptime()\n";
+    const std::string cppCode = parser.parseRuneCode(large);
+    unit.clear();
+    {
+        StringSink sink(unit);
+        parser.compileToCpp(large, sink);
+    }
+    assert(unit == prologueFor(cppCode) + cppCode + "\nint main() {\n\treturn 0;\n}");
+
+    // Optimized units drop definitions nothing reachable names
+    const std::string source = "ᛤ used ᛒ ᛘ\nᛤ unused ᛒ helper() ᛘ\nᛤ helper ᛒ ᛘ\n"
+                               "ᛥ Point ᛒ ᛘ\nᛥ Unused ᛒ ᛘ\nused(); Point p;";
+    RuneArena arena;
+    [[maybe_unused]] Program* program = parser.parse(source, arena);
+    assert(pruneUnreferenced(*program) == 3);
+    parser.setOptimize(true);
+    assert(parser.parseRuneCode(source) == "void used() { }\nclass Point { };\nused(); Point p;");
+    assert(parser.parseRuneCode("ᛤ main ᛒ a() ᛘ\nᛤ a ᛒ ᛘ\nᛤ b ᛒ ᛘ") == "void main() { a() }\nvoid a() { }");
+}
+
+void testWriteIfChanged() {
+    namespace fs = std::filesystem;
+    char root[] = "/tmp/rune_unchanged_XXXXXX";
+    [[maybe_unused]] const char* created = mkdtemp(root);
+    assert(created);
+    const std::string path = std::string(root) + "/unit.cpp";
+    const fs::file_time_type past = fs::file_time_type::clock::now() - std::chrono::hours(1);
+
+    RuneParser parser;
+    parser.compileToCpp("x ᛃ 1", path);
+    fs::last_write_time(path, past);
+    parser.compileToCpp("x ᛃ 1", path);
+    assert(fs::last_write_time(path) == past);
+
+    // Same size, different bytes
+    parser.compileToCpp("x ᛃ 2", path);
+    assert(fs::last_write_time(path) > past);
+    assert(readFile(path) == "x = 2\nint main() {\n\treturn 0;\n}");
+    // Created with the mode a plain create gets under the umask
+    const std::string plain = std::string(root) + "/plain.cpp";
+    std::ofstream(plain) << "x";
+    assert(fs::status(path).permissions() == fs::status(plain).permissions());
+    fs::remove(plain);
+
+    // A second build over the same sources rewrites nothing
+    const std::string source = std::string(root) + "/a.rune";
+    std::ofstream(source) << "ᛤ a ᛒ ᚠ 1 ᛘ\n";
+    const std::vector<CompileJob> jobs = RuneDriver::planJobs({source});
+    assert(RuneDriver::compile(jobs, 1).unchanged == 0);
+    assert(RuneDriver::compile(jobs, 1).unchanged == 1);
+
+    // No temporary files are left behind
+    size_t entries = 0;
+    for (const auto& entry : fs::directory_iterator(root)) entries += entry.is_regular_file();
+    assert(entries == 3);
+    fs::remove_all(root);
+}
+
+void testDaemon() {
+    char root[] = "/tmp/rune_daemon_XXXXXX";
+    [[maybe_unused]] const char* created = mkdtemp(root);
+    assert(created);
+    const std::string socketPath = std::string(root) + "/daemon.sock";
+    RuneDaemon daemon(socketPath, 2);
+    std::thread server([&daemon] { daemon.serve(); });
+
+    [[maybe_unused]] bool refused = false;
+    try {
+        RuneDaemon second(socketPath, 1);
+    } catch (const RuneError& e) {
+        refused = e.getCode() == RuneError::ErrorCode::NETWORK_ERROR;
+    }
+    assert(refused);
+
+    RuneParser parser;
+    {
+        RuneDaemonClient client(socketPath);
+        assert(client.parse("ᚠ x") == "std::cout << x");
+        assert(client.parse("ᚠ x") == "std::cout << x");
+        assert(client.parse("x ᛃ 2 ᚹ 3", DaemonOptimize) == "x = 6");
+
+        [[maybe_unused]] bool rejected = false;
+        try {
+            client.parse("ᛥ");
+        } catch (const RuneParseError& e) {
+            rejected = std::string(e.what()).find("Line 1") != std::string::npos;
+        }
+        assert(rejected);
+
+        const std::string input = std::string(root) + "/unit.rune";
+        const std::string output = std::string(root) + "/unit.cpp";
+        std::ofstream(input) << "ᛤ unit ᛒ ᚠ 1 ᛘ\n";
+        [[maybe_unused]] const bool written = client.compile(input, output);
+        [[maybe_unused]] const bool rewritten = client.compile(input, output);
+        assert(written && !rewritten);
+        parser.compileToCpp("ᛤ unit ᛒ ᚠ 1 ᛘ\n", std::string(root) + "/direct.cpp");
+        assert(readFile(output) == readFile(std::string(root) + "/direct.cpp"));
+
+        // Other connections share the warm results
+        RuneDaemonClient other(socketPath);
+        assert(other.parse("ᚠ x") == "std::cout << x");
+        [[maybe_unused]] const DaemonStats stats = daemon.stats();
+        assert(stats.requests == 7 && stats.hits == 3 && stats.misses == 4 && stats.entries == 3);
+        other.shutdown();
+    }
+    server.join();
+    std::filesystem::remove_all(root);
+}
+
 int main() {
     std::cout << "Running Rune tests..." << std::endl;
 
@@ -110,6 +1124,56 @@ int main() {
         testLogging();
         std::cout << "Logging test passed" << std::endl;
 
+        testLexer();
+        std::cout << "Lexer test passed" << std::endl;
+
+        testRuneTable();
+        std::cout << "Rune table test passed" << std::endl;
+
+        testParser();
+        std::cout << "Parser test passed" << std::endl;
+
+        testSyntaxTree();
+        std::cout << "Syntax tree test passed" << std::endl;
+
+        testOutputSinks();
+        std::cout << "Output sink test passed" << std::endl;
+
+        testStreamingParse();
+        std::cout << "Streaming parse test passed" << std::endl;
+
+        testParseFile();
+        std::cout << "Parse file test passed" << std::endl;
+
+        testScanKernels();
+        std::cout << "Scan kernel test passed" << std::endl;
+
+        testDiagnostics();
+        std::cout << "Diagnostics test passed" << std::endl;
+
+        testSymbols();
+        std::cout << "Symbol table test passed" << std::endl;
+
+        testDriver();
+        std::cout << "Driver test passed" << std::endl;
+
+        testCache();
+        std::cout << "Cache test passed" << std::endl;
+        testVM();
+        std::cout << "VM test passed" << std::endl;
+        testParallelLexer();
+        std::cout << "Parallel lexer test passed" << std::endl;
+        testTokenBuffer();
+        std::cout << "Token buffer test passed" << std::endl;
+        testConstantFolding();
+        std::cout << "Constant folding test passed" << std::endl;
+        testMinimalPrologue();
+        std::cout << "Minimal prologue test passed" << std::endl;
+        testWriteIfChanged();
+        std::cout << "Write if changed test passed" << std::endl;
+        testDaemon();
+        std::cout << "Daemon test passed" << std::endl;
+
         std::cout << "All tests passed!" << std::endl;
         return 0;
     } catch (const std::exception& e) {